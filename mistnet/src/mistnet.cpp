@@ -1,5 +1,12 @@
 #include <torch/script.h> 
+#include <cmath>
+#include <cstring>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <sys/stat.h>
 
 #ifdef _WIN32
 #define MISTNET_API __declspec(dllexport)
@@ -7,42 +14,129 @@
 #define MISTNET_API 
 #endif
 
+// TorchScript modules already loaded, by model path and modification time. Parsing
+// and initializing the model is far more expensive than running it, so modules are
+// kept for the life of the process and shared by all subsequent runs. A model file
+// replaced on disk is loaded anew, as the MistNet output cache of vol2bird also keys
+// on the modification time. The module of the replaced file is kept, as another
+// thread may still be running it, until it is freed with _mistnet_free_model.
+typedef std::pair<std::string, long long> mistnet_model_key;
+static std::map<mistnet_model_key, torch::jit::script::Module*> mistnet_models;
+static std::mutex mistnet_models_mutex;
+
 extern "C" {
-MISTNET_API int _mistnet_run_mistnet(float* tensor_in, float** tensor_out, const char* model_path, int tensor_size)
+MISTNET_API void* _mistnet_load_model(const char* model_path)
 {
-        // ***************************************************************************
-        // *************************                           ***********************
-        // ************************* the code to use the model ***********************
-        // *************************                           ***********************
-        // ***************************************************************************
-        
-        torch::jit::script::Module module;
+        std::lock_guard<std::mutex> lock(mistnet_models_mutex);
+
+        struct stat model_stat;
+        long long mtime = 0;
+        if (stat(model_path, &model_stat) == 0) mtime = (long long) model_stat.st_mtime;
+        mistnet_model_key key(model_path, mtime);
+
+        auto it = mistnet_models.find(key);
+        if (it != mistnet_models.end()) return it->second;
+
+        torch::jit::script::Module* module = new torch::jit::script::Module();
         try {
-            module = torch::jit::load(model_path);
+            *module = torch::jit::load(model_path);
+            module->eval();
         }
         catch (const c10::Error& e) {
             std::cerr << "\nError: failed to load MistNet model from file " << model_path << "\n";
-            return -1;
+            delete module;
+            return NULL;
         }
 
-        // if you already have a 1d floating point array that is the tensor of size 15 x 608 x 608
+        mistnet_models[key] = module;
+        return module;
+}
+
+// runs batch_size inputs of channels x height x width values each in a single forward pass,
+// the outputs, of the same size, are stored one after the other in the caller-owned buffer *tensor_out
+MISTNET_API int _mistnet_run_model_batch(void* model, float* tensor_in, float** tensor_out, int batch_size, int channels, int height, int width)
+{
+        if (model == NULL || batch_size < 1 || channels < 1 || height < 1 || width < 1) return -1;
+        torch::jit::script::Module* module = (torch::jit::script::Module*) model;
+
+        // if you already have a 1d floating point array that is the tensor of size batch_size x channels x height x width
         // pointed by a pointer (float*) tensor_in, you can convert it to a torch tensor by:
-        at::Tensor inputs = torch::from_blob(tensor_in, {1, 15, 608, 608}, at::kFloat);
+        at::Tensor inputs = torch::from_blob(tensor_in, {batch_size, channels, height, width}, at::kFloat);
 
         std::vector<torch::jit::IValue> inputs_;
         inputs_.push_back(inputs);
 
-        at::Tensor output = module.forward(inputs_).toTensor();
+        at::Tensor output;
+        try {
+            torch::NoGradGuard no_grad;
+            output = module->forward(inputs_).toTensor().to(at::kFloat).contiguous();
+        }
+        catch (const c10::Error& e) {
+            // typically a model trained for another number of channels or grid size
+            std::cerr << "\nError: failed to run MistNet model on input of shape " << inputs.sizes() << ": " << e.what_without_backtrace() << "\n";
+            return -1;
+        }
 
-        float *output_array = output.data_ptr<float>();
-        
-        // copy result
-        for (int i=0; i<3*5*608*608; i++) (*tensor_out)[i] = output_array[i];
+        // the model should classify every input pixel, with as many output as input channels
+        if (output.dim() < 3 || output.size(0) != batch_size || output.size(-2) != height || output.size(-1) != width ||
+            output.numel() != inputs.numel()) {
+            std::cerr << "\nError: MistNet model output of shape " << output.sizes() << " does not match input of shape " << inputs.sizes() << "\n";
+            return -1;
+        }
+
+        // a single block copy of the result into the caller's buffer
+        std::memcpy(*tensor_out, output.data_ptr<float>(), output.numel()*sizeof(float));
         
         return 0;
+}
+
+MISTNET_API int _mistnet_run_model(void* model, float* tensor_in, float** tensor_out, int channels, int height, int width)
+{
+        return _mistnet_run_model_batch(model, tensor_in, tensor_out, 1, channels, height, width);
+}
+
+// sets the size of the libtorch intra-op thread pool, which is shared by all threads
+// of the process, n <= 0 keeps the current size
+MISTNET_API void _mistnet_set_num_threads(int n)
+{
+        if (n > 0) at::set_num_threads(n);
+}
+
+MISTNET_API void _mistnet_free_model(void* model)
+{
+        std::lock_guard<std::mutex> lock(mistnet_models_mutex);
 
+        for (auto it = mistnet_models.begin(); it != mistnet_models.end(); ++it) {
+            if (it->second == model) {
+                delete it->second;
+                mistnet_models.erase(it);
+                return;
+            }
+        }
 }
 
+// entry point of the original API, which only passes the number of values. Assumes
+// the square grid and 15 channels (3 quantities at 5 elevations) of the original model.
+MISTNET_API int _mistnet_run_mistnet(float* tensor_in, float** tensor_out, const char* model_path, int tensor_size)
+{
+        // ***************************************************************************
+        // *************************                           ***********************
+        // ************************* the code to use the model ***********************
+        // *************************                           ***********************
+        // ***************************************************************************
+        
+        int channels = 15;
+        int dim = (int) std::lround(std::sqrt(tensor_size / (double) channels));
+        if ((int64_t) channels*dim*dim != tensor_size) {
+            std::cerr << "\nError: " << tensor_size << " values do not form a square grid of " << channels << " channels\n";
+            return -1;
+        }
+
+        void* model = _mistnet_load_model(model_path);
+        if (model == NULL) return -1;
+
+        return _mistnet_run_model(model, tensor_in, tensor_out, channels, dim, dim);
 }
 
+}
 
@@ -1,6 +1,9 @@
 #include <Rcpp.h>
+#include <algorithm>
 #include <memory>
+#include <vector>
 #include <string.h>
+#include <thread>
 
 extern "C" {
 //#include "libvol2bird/libvol2bird.h"
@@ -148,6 +151,13 @@ private:
     alldata->options.mistNetElevsOnly = TRUE;
     alldata->options.useMistNet = FALSE;
     strcpy(alldata->options.mistNetPath, "/opt/vol2bird/etc/mistnet_nexrad.pt");
+    alldata->options.mistNetThreads = MISTNET_THREADS;
+    alldata->options.mistNetDimension = MISTNET_DIMENSION;
+    alldata->options.mistNetResolution = MISTNET_RESOLUTION;
+    alldata->options.mistNetCache = MISTNET_CACHE;
+    strcpy(alldata->options.mistNetCacheDir, MISTNET_CACHE_DIR);
+    alldata->options.sailsProfiles = FALSE;
+    alldata->options.outputSegmentation = TRUE;
 
     // ------------------------------------------------------------- //
     //              vol2bird options from constants.h                //
@@ -180,6 +190,8 @@ private:
     alldata->misc.cellDbzMin = NAN;
 
     alldata->misc.loadConfigSuccessful = FALSE;
+    alldata->misc.scansSegmented = FALSE;
+    alldata->misc.polarizationSelected = FALSE;
   }
 
 public:
@@ -245,6 +257,13 @@ public:
     _alldata.options.mistNetElevsOnly = other._alldata.options.mistNetElevsOnly;
     _alldata.options.useMistNet = other._alldata.options.useMistNet;
     strcpy(_alldata.options.mistNetPath, other._alldata.options.mistNetPath);
+    _alldata.options.mistNetThreads = other._alldata.options.mistNetThreads;
+    _alldata.options.mistNetDimension = other._alldata.options.mistNetDimension;
+    _alldata.options.mistNetResolution = other._alldata.options.mistNetResolution;
+    _alldata.options.mistNetCache = other._alldata.options.mistNetCache;
+    strcpy(_alldata.options.mistNetCacheDir, other._alldata.options.mistNetCacheDir);
+    _alldata.options.sailsProfiles = other._alldata.options.sailsProfiles;
+    _alldata.options.outputSegmentation = other._alldata.options.outputSegmentation;
 
     // ------------------------------------------------------------- //
     //              vol2bird options from constants.h                //
@@ -639,6 +658,54 @@ public:
   void set_mistNetPath(std::string v) {
     strcpy(_alldata.options.mistNetPath, v.c_str());
   }
+  int get_mistNetThreads() {
+    return _alldata.options.mistNetThreads;
+  }
+  void set_mistNetThreads(int v) {
+    _alldata.options.mistNetThreads = v;
+  }
+  int get_mistNetDimension() {
+    return _alldata.options.mistNetDimension;
+  }
+  void set_mistNetDimension(int v) {
+    _alldata.options.mistNetDimension = v;
+  }
+  int get_mistNetResolution() {
+    return _alldata.options.mistNetResolution;
+  }
+  void set_mistNetResolution(int v) {
+    _alldata.options.mistNetResolution = v;
+  }
+  int get_mistNetCache() {
+    return _alldata.options.mistNetCache;
+  }
+  void set_mistNetCache(int v) {
+    _alldata.options.mistNetCache = v;
+  }
+  std::string get_mistNetCacheDir() {
+    return std::string(_alldata.options.mistNetCacheDir);
+  }
+  void set_mistNetCacheDir(std::string v) {
+    if (v.length() >= sizeof(_alldata.options.mistNetCacheDir)) {
+      throw std::invalid_argument("mistNetCacheDir is too long");
+    }
+    strncpy(_alldata.options.mistNetCacheDir, v.c_str(), sizeof(_alldata.options.mistNetCacheDir) - 1);
+    _alldata.options.mistNetCacheDir[sizeof(_alldata.options.mistNetCacheDir) - 1] = '\0';
+  }
+
+  void set_sailsProfiles(bool v) {
+    _alldata.options.sailsProfiles = v == true ? TRUE : FALSE;
+  }
+  bool get_sailsProfiles() {
+    return _alldata.options.sailsProfiles == TRUE ? true : false;
+  }
+
+  void set_outputSegmentation(bool v) {
+    _alldata.options.outputSegmentation = v == true ? TRUE : FALSE;
+  }
+  bool get_outputSegmentation() {
+    return _alldata.options.outputSegmentation == TRUE ? true : false;
+  }
 
   double get_constant_areaCellMin() {
     return _alldata.constants.areaCellMin;
@@ -749,11 +816,14 @@ public:
 class Vol2Bird {
 private:
   bool _verbose = false;
+  vol2birdChunks_t *_chunks = NULL;
+  std::string _chunkFile;
 public:
   Vol2Bird() : _verbose(false) {
   }
 
   virtual ~Vol2Bird() {
+    vol2birdChunksFree(_chunks);
   }
 
   bool isVerbose() {
@@ -788,56 +858,18 @@ public:
 
   }
 
-  void process(StringVector &files, Vol2BirdConfig &config, std::string vpOutName, std::string volOutName) {
-    PolarVolume_t *volume = NULL;
-    char *fileIn[INPUTFILESMAX];
-    int initSuccessful = 0;
-
-    if (files.size() == 0) {
-      throw std::invalid_argument("Must specify at least one input filename");
-    }
-    for (int i = 0; i < files.size(); i++) {
-      fileIn[i] = (char*) files(i);
-    }
-
-    volume = vol2birdGetVolume(fileIn, files.size(), 1000000, 1);
-    if (volume == NULL) {
-      throw std::runtime_error("Could not read file(s)");
-    }
-    
-    // copy input filename to misc.filename_pvol
-    strcpy(config.alldata()->misc.filename_pvol, fileIn[0]);
-
+  // calculates and writes the profile of a single volume, the caller keeps ownership of volume
+  void processVolume(PolarVolume_t *volume, Vol2BirdConfig &config, const char *fileIn, std::string vpOutName, std::string volOutName, bool appendCSV) {
     config.alldata()->misc.loadConfigSuccessful = TRUE; // Config is already loaded when we come here.
 
-    if (config.alldata()->options.useClutterMap) {
-      int clutterSuccessful = vol2birdLoadClutterMap(volume, config.alldata()->options.clutterMap, config.alldata()->misc.rCellMax) == 0;
-      if (clutterSuccessful == FALSE) {
-        RAVE_OBJECT_RELEASE(volume);
-        throw std::runtime_error(std::string("Failed to load static clutter map : ") + std::string(config.alldata()->options.clutterMap));
-      }
-    }
-
-    if (config.alldata()->options.resample) {
-      PolarVolume_t *new_volume = PolarVolume_resample(volume, config.alldata()->options.resampleRscale, config.alldata()->options.resampleNbins,
-          config.alldata()->options.resampleNrays);
-      RAVE_OBJECT_RELEASE(volume);
-      if (new_volume == NULL) {
-        RAVE_OBJECT_RELEASE(new_volume);
-        throw std::runtime_error("Failed to resample volume");
-      }
-      volume = new_volume;
-    }
-
-    initSuccessful = vol2birdSetUp(volume, config.alldata()) == 0;
+    int initSuccessful = vol2birdSetUp(volume, config.alldata()) == 0;
 
     if (initSuccessful == FALSE) {
-      RAVE_OBJECT_RELEASE(volume);
       throw std::runtime_error("Failed to initialize for processing");
     }
 
     if (!volOutName.empty()) {
-      saveToODIM((RaveCoreObject*) volume, volOutName.c_str());
+      saveVolumeToODIM(volume, volOutName.c_str(), config.alldata());
     }
 
     vol2birdCalcProfiles(config.alldata());
@@ -857,7 +889,7 @@ public:
 
       Rprintf("# vol2bird Vertical Profile of Birds (VPB)\n");
       Rprintf("# source: %s\n", source);
-      Rprintf("# polar volume input: %s\n", fileIn[0]);
+      Rprintf("# polar volume input: %s\n", fileIn);
       if (config.alldata()->misc.vcp > 0)
         Rprintf("# volume coverage pattern (VCP): %i\n", config.alldata()->misc.vcp);
       Rprintf("# date   time HGHT    u      v       w     ff    dd  sd_vvp gap dbz     eta   dens   DBZH   n   n_dbz n_all n_dbz_all\n");
@@ -912,19 +944,383 @@ public:
       int result;
 
       if (isCSV(vpOutName.c_str())) {
-          result = saveToCSV(vpOutName.c_str(), config.alldata(), volume);
+          if (appendCSV) {
+            result = appendToCSV(vpOutName.c_str(), config.alldata(), volume);
+          } else {
+            result = saveToCSV(vpOutName.c_str(), config.alldata(), volume);
+          }
       } else {
           result = saveToODIM((RaveCoreObject*)config.alldata()->vp, vpOutName.c_str());
       }
       
       if (result == FALSE) {
-        RAVE_OBJECT_RELEASE(volume);
+        vol2birdTearDown(config.alldata());
         throw std::runtime_error(std::string("Can not write : ") + vpOutName);
       }
     }
 
     vol2birdTearDown(config.alldata());
+  }
+
+
+  void process(StringVector &files, Vol2BirdConfig &config, std::string vpOutName, std::string volOutName) {
+    PolarVolume_t *volume = NULL;
+    char *fileIn[INPUTFILESMAX];
+
+    if (files.size() == 0) {
+      throw std::invalid_argument("Must specify at least one input filename");
+    }
+    for (int i = 0; i < files.size(); i++) {
+      fileIn[i] = (char*) files(i);
+    }
+
+    volume = readVolume(fileIn, files.size(), config, volOutName);
+    if (volume == NULL) {
+      throw std::runtime_error("Could not read file(s)");
+    }
+    
+    processLoaded(volume, config, fileIn[0], vpOutName, volOutName);
+  }
+
+  // reads a volume for processing with config, the full volume when it is written to volOutName
+  PolarVolume_t* readVolume(char *fileIn[], int nFiles, Vol2BirdConfig &config, const std::string &volOutName) {
+    if (volOutName.empty()) {
+      // scans outside the elevation range and gates beyond the analysis range
+      // are not used by vol2bird, skip decoding them
+      return vol2birdGetVolumeElevRange(fileIn, nFiles, vol2birdGetReadRange(config.alldata()), 1,
+          config.alldata()->options.elevMin, config.alldata()->options.elevMax, config.alldata()->options.sailsProfiles);
+    }
+    // the full volume is written to file
+    return vol2birdGetVolumeElevRange(fileIn, nFiles, 1000000, 1, -90, 90, config.alldata()->options.sailsProfiles);
+  }
+
+  // volumes of process_batch that are segmented together with MistNet
+  struct VolumeBatch {
+    int start;                                    // index of the first file
+    std::vector<PolarVolume_t*> volumes;          // owned until processed
+    std::vector<Vol2BirdConfig> configs;          // configuration of each volume
+    std::unique_ptr<Vol2BirdConfig> segmentConfig; // configuration referenced by mistnet
+#ifdef MISTNET
+    vol2birdMistnetBatch_t *mistnet = NULL;
+#endif
+
+    VolumeBatch(int start, int n, Vol2BirdConfig &config) : start(start), volumes(n, (PolarVolume_t*) NULL), configs(n, config) {}
+
+    ~VolumeBatch() {
+#ifdef MISTNET
+      vol2birdMistnetBatchFree(mistnet);
+#endif
+      for (size_t i = 0; i < volumes.size(); i++) {
+        RAVE_OBJECT_RELEASE(volumes[i]);
+      }
+    }
+  };
+
+  // reads the volumes of a batch and, with MistNet, renders the model input
+  VolumeBatch* prepareBatch(int start, StringVector &files, Vol2BirdConfig &config, StringVector &volOutNames) {
+    int n = std::min((int) files.size() - start, MISTNET_BATCH_SIZE);
+    std::unique_ptr<VolumeBatch> batch(new VolumeBatch(start, n, config));
+
+    for (int i = 0; i < n; i++) {
+      char *fileIn = (char*) files(start + i);
+      std::string volOutName = volOutNames.size() == 0 ? std::string() : std::string((char*) volOutNames(start + i));
+      batch->volumes[i] = readVolume(&fileIn, 1, batch->configs[i], volOutName);
+      if (batch->volumes[i] == NULL) {
+        throw std::runtime_error(std::string("Could not read file : ") + fileIn);
+      }
+    }
+
+#ifdef MISTNET
+    // resampling replaces the scans, the segmentation is then left for vol2birdSetUp
+    if (config.alldata()->options.useMistNet && !config.alldata()->options.resample) {
+      // selecting the model input scans may change the options of the configuration
+      batch->segmentConfig.reset(new Vol2BirdConfig(config));
+      batch->segmentConfig->alldata()->misc.loadConfigSuccessful = TRUE;
+      batch->mistnet = vol2birdMistnetBatchNew(batch->volumes.data(), n, batch->segmentConfig->alldata());
+    }
+#endif
+
+    return batch.release();
+  }
+
+  // calculates and writes the profiles of a batch
+  void processBatch(VolumeBatch &batch, StringVector &files, StringVector &vpOutNames, StringVector &volOutNames) {
+    for (size_t i = 0; i < batch.volumes.size(); i++) {
+      int iFile = batch.start + i;
+      std::string volOutName = volOutNames.size() == 0 ? std::string() : std::string((char*) volOutNames(iFile));
+      PolarVolume_t *volume = batch.volumes[i];
+      batch.volumes[i] = NULL;
+      // takes ownership of the volume
+      processLoaded(volume, batch.configs[i], (char*) files(iFile), std::string((char*) vpOutNames(iFile)), volOutName);
+    }
+  }
+
+  // calculates the profiles of several volumes, one per file, each processed with a copy of config.
+  // With MistNet, volumes are segmented MISTNET_BATCH_SIZE at a time in a single forward pass, and
+  // the stages are pipelined: while the model runs on one batch in a worker thread, the next batch
+  // is read and rendered and the profiles of the previous batch are calculated. Only the inference
+  // runs concurrently, as the RAVE objects used by all other stages are not thread-safe.
+  void process_batch(StringVector &files, Vol2BirdConfig &config, StringVector &vpOutNames, StringVector &volOutNames) {
+    int nFiles = files.size();
+
+    if (nFiles == 0) {
+      throw std::invalid_argument("Must specify at least one input filename");
+    }
+    if (vpOutNames.size() != nFiles || (volOutNames.size() != nFiles && volOutNames.size() != 0)) {
+      throw std::invalid_argument("Must specify one output filename per input filename");
+    }
+
+    std::unique_ptr<VolumeBatch> previous;
+    std::unique_ptr<VolumeBatch> current(prepareBatch(0, files, config, volOutNames));
+    std::thread inference;
+    // set by the worker thread, reported from the main thread after join()
+    std::string inferenceError;
+
+    try {
+      while (current) {
+#ifdef MISTNET
+        if (current->mistnet != NULL) {
+          vol2birdMistnetBatch_t *mistnet = current->mistnet;
+          inferenceError.clear();
+          // an exception must not leave the thread, the batch then reports the failure
+          inference = std::thread([mistnet, &inferenceError]() {
+            try {
+              vol2birdMistnetBatchRun(mistnet);
+            } catch (std::exception &e) {
+              inferenceError = e.what();
+            } catch (...) {
+              inferenceError = "unknown exception";
+            }
+          });
+        }
+#endif
+        if (previous) {
+          processBatch(*previous, files, vpOutNames, volOutNames);
+          previous.reset();
+        }
+        std::unique_ptr<VolumeBatch> next;
+        int nextStart = current->start + (int) current->volumes.size();
+        if (nextStart < nFiles) {
+          next.reset(prepareBatch(nextStart, files, config, volOutNames));
+        }
+        if (inference.joinable()) {
+          inference.join();
+        }
+#ifdef MISTNET
+        if (!inferenceError.empty()) {
+          REprintf("MistNet inference failed: %s\n", inferenceError.c_str());
+        }
+        vol2birdMistnetBatchApply(current->mistnet);
+        vol2birdMistnetBatchFree(current->mistnet);
+        current->mistnet = NULL;
+#endif
+        previous = std::move(current);
+        current = std::move(next);
+      }
+    } catch (...) {
+      if (inference.joinable()) {
+        inference.join();
+        if (!inferenceError.empty()) {
+          REprintf("MistNet inference failed: %s\n", inferenceError.c_str());
+        }
+      }
+      throw;
+    }
+
+    if (previous) {
+      processBatch(*previous, files, vpOutNames, volOutNames);
+    }
+  }
+
+  // calculates and writes the profile(s) of a volume that was read, applying the
+  // static clutter map, resampling and SAILS options; takes ownership of volume
+  void processLoaded(PolarVolume_t *volume, Vol2BirdConfig &config, const char *fileIn, std::string vpOutName, std::string volOutName) {
+    // copy input filename to misc.filename_pvol
+    strcpy(config.alldata()->misc.filename_pvol, fileIn);
+
+    if (config.alldata()->options.useClutterMap) {
+      int clutterSuccessful = vol2birdLoadClutterMap(volume, config.alldata()->options.clutterMap, config.alldata()->misc.rCellMax) == 0;
+      if (clutterSuccessful == FALSE) {
+        RAVE_OBJECT_RELEASE(volume);
+        throw std::runtime_error(std::string("Failed to load static clutter map : ") + std::string(config.alldata()->options.clutterMap));
+      }
+    }
+
+    if (config.alldata()->options.resample) {
+      PolarVolume_t *new_volume = PolarVolume_resample(volume, config.alldata()->options.resampleRscale, config.alldata()->options.resampleNbins,
+          config.alldata()->options.resampleNrays);
+      RAVE_OBJECT_RELEASE(volume);
+      if (new_volume == NULL) {
+        RAVE_OBJECT_RELEASE(new_volume);
+        throw std::runtime_error("Failed to resample volume");
+      }
+      volume = new_volume;
+    }
+
+    if (!config.alldata()->options.sailsProfiles) {
+      try {
+        processVolume(volume, config, fileIn, vpOutName, volOutName, false);
+      } catch (...) {
+        RAVE_OBJECT_RELEASE(volume);
+        throw;
+      }
+      RAVE_OBJECT_RELEASE(volume);
+      return;
+    }
+
+    // one profile for each repeat of the lowest scan (NEXRAD SAILS),
+    // the higher scans are shared and segmented only once
+    PolarVolume_t *subVolumes[SAILSMAX];
+    int nSubVolumes = PolarVolume_splitSails(volume, subVolumes, SAILSMAX);
+    if (nSubVolumes < 1) {
+      RAVE_OBJECT_RELEASE(volume);
+      throw std::runtime_error("Failed to split volume into SAILS sub-volumes");
+    }
+
+    try {
+      for (int iSub = 0; iSub < nSubVolumes; iSub++) {
+        std::string subOutName = vpOutName;
+        if (iSub > 0 && !vpOutName.empty() && !isCSV(vpOutName.c_str())) {
+          // ODIM profiles go to separate files, name_sails1.h5, name_sails2.h5, ...
+          size_t dot = vpOutName.find_last_of('.');
+          size_t slash = vpOutName.find_last_of("/\\");
+          std::string suffix = std::string("_sails") + std::to_string(iSub);
+          if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+            subOutName = vpOutName + suffix;
+          } else {
+            subOutName = vpOutName.substr(0, dot) + suffix + vpOutName.substr(dot);
+          }
+        }
+        processVolume(subVolumes[iSub], config, fileIn, subOutName, std::string(), iSub > 0);
+      }
+    } catch (...) {
+      for (int iSub = 0; iSub < nSubVolumes; iSub++) {
+        RAVE_OBJECT_RELEASE(subVolumes[iSub]);
+      }
+      RAVE_OBJECT_RELEASE(volume);
+      throw;
+    }
+
+    // the shared scans are segmented again should the volume be processed anew
+    vol2birdClearSegmented(volume);
+
+    if (!volOutName.empty()) {
+      saveVolumeToODIM(volume, volOutName.c_str(), config.alldata());
+    }
+
+    for (int iSub = 0; iSub < nSubVolumes; iSub++) {
+      RAVE_OBJECT_RELEASE(subVolumes[iSub]);
+    }
+    RAVE_OBJECT_RELEASE(volume);
+  }
+
+  // adds the next chunk file of a NEXRAD Level II volume from the real-time feed,
+  // converting and segmenting the scans it completes; returns the number of new scans
+  int add_chunk(std::string file, Vol2BirdConfig &config, bool fullVolume) {
+    if (_chunks == NULL) {
+      if (fullVolume) {
+        // the full volume is written to file
+        _chunks = vol2birdChunksNew(NULL, 1000000, 1, -90, 90, config.alldata()->options.sailsProfiles);
+      } else {
+        _chunks = vol2birdChunksNew(NULL, vol2birdGetReadRange(config.alldata()), 1,
+            config.alldata()->options.elevMin, config.alldata()->options.elevMax, config.alldata()->options.sailsProfiles);
+      }
+      if (_chunks == NULL) {
+        throw std::runtime_error("Failed to start reading chunks");
+      }
+      _chunkFile = file;
+    }
+
+    config.alldata()->misc.loadConfigSuccessful = TRUE; // Config is already loaded when we come here.
+
+    int nScans = vol2birdChunksAdd(_chunks, file.c_str(), config.alldata());
+    if (nScans < 0) {
+      throw std::runtime_error(std::string("Could not read chunk : ") + file);
+    }
+    return nScans;
+  }
+
+  bool chunks_complete() {
+    return _chunks != NULL && vol2birdChunksComplete(_chunks);
+  }
+
+  int chunks_scans() {
+    return _chunks == NULL ? 0 : vol2birdChunksNumberOfScans(_chunks);
+  }
+
+  // calculates the profile of the volume received with add_chunk, only the
+  // profile fit remains for the scans segmented while they were received
+  void process_chunks(Vol2BirdConfig &config, std::string vpOutName, std::string volOutName) {
+    PolarVolume_t *volume = NULL;
+
+    if (_chunks != NULL) {
+      volume = vol2birdChunksVolume(_chunks);
+      vol2birdChunksFree(_chunks);
+      _chunks = NULL;
+    }
+    if (volume == NULL) {
+      throw std::runtime_error("No complete scans received");
+    }
+
+    processLoaded(volume, config, _chunkFile.c_str(), vpOutName, volOutName);
+  }
+
+  // calculates the profile of a volume like process_chunks, segmenting its
+  // scans one at a time in ascending order as if each arrived in a chunk
+  void process_scanwise(StringVector &files, Vol2BirdConfig &config, std::string vpOutName) {
+    PolarVolume_t *volume = NULL;
+    PolarVolume_t *shell = NULL;
+    PolarVolume_t *received = NULL;
+    char *fileIn[INPUTFILESMAX];
+
+    if (files.size() == 0) {
+      throw std::invalid_argument("Must specify at least one input filename");
+    }
+    for (int i = 0; i < files.size(); i++) {
+      fileIn[i] = (char*) files(i);
+    }
+
+    volume = readVolume(fileIn, files.size(), config, std::string());
+    if (volume == NULL) {
+      throw std::runtime_error("Could not read file(s)");
+    }
+    PolarVolume_sortByElevations(volume, 1);
+
+    // the volume metadata without scans
+    shell = (PolarVolume_t*) RAVE_OBJECT_CLONE(volume);
+    if (shell != NULL) {
+      while (PolarVolume_getNumberOfScans(shell) > 0) {
+        PolarVolume_removeScan(shell, 0);
+      }
+      received = (PolarVolume_t*) RAVE_OBJECT_CLONE(shell);
+    }
+    if (received == NULL) {
+      RAVE_OBJECT_RELEASE(shell);
+      RAVE_OBJECT_RELEASE(volume);
+      throw std::runtime_error("Failed to copy volume");
+    }
+
+    config.alldata()->misc.loadConfigSuccessful = TRUE; // Config is already loaded when we come here.
+
+    while (PolarVolume_getNumberOfScans(volume) > 0) {
+      PolarScan_t *scan = PolarVolume_getScan(volume, 0);
+      PolarVolume_removeScan(volume, 0);
+      PolarVolume_t *fresh = (PolarVolume_t*) RAVE_OBJECT_CLONE(shell);
+      int segmented = fresh != NULL && PolarVolume_addScan(fresh, scan) && vol2birdSegmentScans(fresh, config.alldata()) >= 0;
+      PolarVolume_addScan(received, scan);
+      RAVE_OBJECT_RELEASE(scan);
+      RAVE_OBJECT_RELEASE(fresh);
+      if (!segmented) {
+        RAVE_OBJECT_RELEASE(shell);
+        RAVE_OBJECT_RELEASE(volume);
+        RAVE_OBJECT_RELEASE(received);
+        throw std::runtime_error("Failed to segment scan");
+      }
+    }
+    RAVE_OBJECT_RELEASE(shell);
     RAVE_OBJECT_RELEASE(volume);
+
+    processLoaded(received, config, fileIn[0], vpOutName, std::string());
   }
 
   void rsl2odim(StringVector &files, Vol2BirdConfig &config, std::string volOutName)
@@ -961,6 +1357,99 @@ public:
     }
     RAVE_OBJECT_RELEASE(volume);
   }
+
+  DataFrame catalog(StringVector &files)
+  {
+    int nFiles = files.size();
+    std::vector<char*> fileIn(nFiles);
+    std::vector<vol2birdCatalogEntry_t> entries(nFiles);
+
+    for (int i = 0; i < nFiles; i++) {
+      fileIn[i] = (char*) files(i);
+    }
+
+    // reads the file headers only, in parallel when OpenMP is available
+    vol2birdCatalogFiles(fileIn.data(), nFiles, entries.data());
+
+    std::vector<std::string> file, format, radar, date, time, quantities;
+    std::vector<int> scan, nrays, nbins;
+    std::vector<double> elangle, rscale;
+
+    for (int i = 0; i < nFiles; i++) {
+      const vol2birdCatalogEntry_t &entry = entries[i];
+      const char *formatName = "UNKNOWN";
+      if (entry.format == radarDataFormat_ODIM) formatName = "ODIM";
+      if (entry.format == radarDataFormat_RSL) formatName = "RSL";
+      if (entry.format == radarDataFormat_IRIS) formatName = "IRIS";
+      if (_verbose && entry.status != 0) {
+        Rcpp::message(Rcpp::wrap(std::string("Could not read the headers of ") + fileIn[i]));
+      }
+
+      // one row per scan, a single row without scan metadata for unreadable files
+      int nRows = entry.nScans > 0 ? entry.nScans : 1;
+      for (int iScan = 0; iScan < nRows; iScan++) {
+        bool haveScan = iScan < entry.nScans;
+        file.push_back(fileIn[i]);
+        format.push_back(formatName);
+        radar.push_back(entry.radar);
+        date.push_back(entry.date);
+        time.push_back(entry.time);
+        scan.push_back(haveScan ? iScan + 1 : NA_INTEGER);
+        elangle.push_back(haveScan ? entry.scans[iScan].elangle : NA_REAL);
+        nrays.push_back(haveScan ? entry.scans[iScan].nrays : NA_INTEGER);
+        nbins.push_back(haveScan ? entry.scans[iScan].nbins : NA_INTEGER);
+        rscale.push_back(haveScan ? entry.scans[iScan].rscale : NA_REAL);
+        quantities.push_back(haveScan ? entry.scans[iScan].quantities : "");
+      }
+    }
+
+    return DataFrame::create(Named("file") = file, Named("format") = format, Named("radar") = radar,
+        Named("date") = date, Named("time") = time, Named("scan") = scan, Named("elangle") = elangle,
+        Named("nrays") = nrays, Named("nbins") = nbins, Named("rscale") = rscale,
+        Named("quantities") = quantities, Named("stringsAsFactors") = false);
+  }
+
+  // renders a quantity of all scans of a volume to PPI images of dim x dim pixels of res m,
+  // in parallel when OpenMP is available
+  List ppi(StringVector &files, std::string quantity, int dim, int res)
+  {
+    int nFiles = files.size();
+    std::vector<char*> fileIn(nFiles);
+
+    if (nFiles == 0) {
+      throw std::invalid_argument("Must specify at least one input filename");
+    }
+    if (dim <= 0 || res <= 0) {
+      throw std::invalid_argument("Image dimension and resolution must be positive");
+    }
+    for (int i = 0; i < nFiles; i++) {
+      fileIn[i] = (char*) files(i);
+    }
+
+    // all quantities can be rendered, read the full set of moments
+    PolarVolume_t *volume = vol2birdGetVolume(fileIn.data(), nFiles, 1000000, 0);
+    if (volume == NULL) {
+      throw std::runtime_error("Could not read file(s)");
+    }
+
+    int nScans = PolarVolume_getNumberOfScans(volume);
+    NumericVector elangle(nScans);
+    NumericVector data((R_xlen_t) dim * dim * nScans);
+    for (int iScan = 0; iScan < nScans; iScan++) {
+      PolarScan_t *scan = PolarVolume_getScan(volume, iScan);
+      elangle[iScan] = PolarScan_getElangle(scan) * 180 / M_PI;
+      RAVE_OBJECT_RELEASE(scan);
+    }
+
+    int result = polarVolumeToPPI(volume, quantity.c_str(), dim, res, data.begin());
+    RAVE_OBJECT_RELEASE(volume);
+    if (result != 0) {
+      throw std::runtime_error("Could not render the volume");
+    }
+
+    data.attr("dim") = IntegerVector::create(dim, dim, nScans);
+    return List::create(Named("elangle") = elangle, Named("data") = data);
+  }
 };
 
 //' @rdname PolarVolume-class
@@ -1049,6 +1538,13 @@ RCPP_MODULE(Vol2BirdConfig) {
       .property("mistNetElevsOnly", &Vol2BirdConfig::get_mistNetElevsOnly, &Vol2BirdConfig::set_mistNetElevsOnly)
       .property("useMistNet", &Vol2BirdConfig::get_useMistNet, &Vol2BirdConfig::set_useMistNet)
       .property("mistNetPath", &Vol2BirdConfig::get_mistNetPath, &Vol2BirdConfig::set_mistNetPath)
+      .property("mistNetThreads", &Vol2BirdConfig::get_mistNetThreads, &Vol2BirdConfig::set_mistNetThreads)
+      .property("mistNetDimension", &Vol2BirdConfig::get_mistNetDimension, &Vol2BirdConfig::set_mistNetDimension)
+      .property("mistNetResolution", &Vol2BirdConfig::get_mistNetResolution, &Vol2BirdConfig::set_mistNetResolution)
+      .property("mistNetCache", &Vol2BirdConfig::get_mistNetCache, &Vol2BirdConfig::set_mistNetCache)
+      .property("mistNetCacheDir", &Vol2BirdConfig::get_mistNetCacheDir, &Vol2BirdConfig::set_mistNetCacheDir)
+      .property("sailsProfiles", &Vol2BirdConfig::get_sailsProfiles, &Vol2BirdConfig::set_sailsProfiles)
+      .property("outputSegmentation", &Vol2BirdConfig::get_outputSegmentation, &Vol2BirdConfig::set_outputSegmentation)
       .property("constant_areaCellMin", &Vol2BirdConfig::get_constant_areaCellMin, &Vol2BirdConfig::set_constant_areaCellMin)
       .property("constant_cellClutterFractionMax", &Vol2BirdConfig::get_constant_cellClutterFractionMax, &Vol2BirdConfig::set_constant_cellClutterFractionMax)
       .property("constant_chisqMin", &Vol2BirdConfig::get_constant_chisqMin, &Vol2BirdConfig::set_constant_chisqMin)
@@ -1076,8 +1572,16 @@ RCPP_MODULE(Vol2Bird) {
   class_<Vol2Bird>("Vol2Bird")
   .constructor("Constructor")
   .method("process", &Vol2Bird::process, "Processes the volume/scans")
+  .method("process_batch", &Vol2Bird::process_batch, "Processes several volumes, one per file")
+  .method("add_chunk", &Vol2Bird::add_chunk, "Adds the next chunk file of a NEXRAD Level II volume")
+  .method("chunks_complete", &Vol2Bird::chunks_complete, "Whether the last chunk of the volume was added")
+  .method("chunks_scans", &Vol2Bird::chunks_scans, "Number of scans received")
+  .method("process_chunks", &Vol2Bird::process_chunks, "Processes the volume received as chunks")
+  .method("process_scanwise", &Vol2Bird::process_scanwise, "Processes the volume segmenting one scan at a time, as for chunks")
   .method("rsl2odim", &Vol2Bird::rsl2odim, "Converts the file into odim format")
   .method("load_volume", &Vol2Bird::load_volume, "Loads a volume")
+  .method("catalog", &Vol2Bird::catalog, "Reads the metadata of the files without loading the data")
+  .method("ppi", &Vol2Bird::ppi, "Renders a quantity of all scans of the volume to PPI images")
   .property("verbose", &Vol2Bird::isVerbose, &Vol2Bird::setVerbose, "If processing should be verbose or not")
   ;
 }
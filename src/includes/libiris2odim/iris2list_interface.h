@@ -40,7 +40,7 @@ rayplus_s *extract_rayplus(IRISbuf **IRISbuf_pp,
                              IrisDList_t **sweeplist_pp,
                    sweep_element_s **sweep_list_element_pp,
                              SINT2 current_sweep,
-                              FILE *fp,
+                             IRISfile *fp,
                              _Bool target_is_big_endian );
 
 phd_s *extract_product_hdr(IRISbuf *IRISbuf_p,
@@ -109,7 +109,15 @@ rpb_s *extract_raw_prod_bhdr(IRISbuf *IRISbuf_p,
 csd_s *extract_color_scale_def(UINT1 *s1, _Bool target_is_big_endian);
   
 
-IRISbuf *getabuf(FILE *fp, UINT2 bytes2Copy);
+IRISfile *IRISfile_open(const char *ifile);
+
+IRISfile *IRISfile_from_memory(const UINT1 *data, size_t size);
+
+IRISfile *IRISfile_sweep(IRISfile *fp, size_t start, size_t end);
+
+void IRISfile_close(IRISfile *fp);
+
+IRISbuf *getabuf(IRISfile *fp, UINT2 bytes2Copy);
 
 ymd_s *extract_ymds_time(UINT1 *s1,
                           _Bool target_is_big_endian);
@@ -40,11 +40,20 @@ typedef struct ray_attributes {
    double *elangles; 
  } ra_s;
 
+struct sweep_element;
+
 // define structure file_element and type file_element_s
 typedef struct file_element {
   phd_s *product_header_p;  // pointer to a product header structure
   ihd_s *ingest_header_p;   // pointer to an ingest header structure
   IrisDList_t *sweep_list_p; // pointer to a doubly-linked list of sweep_element structures
+  double max_range_in_m;    // range bins beyond this range are not converted, 0 for all bins
+  // when set, called with each sweep as soon as all of its rays have been read, with the
+  // sweep that follows it (NULL for the last sweep). The sweep is freed afterwards instead
+  // of being kept in sweep_list_p.
+  void (*sweep_done)(struct file_element *file_element_p, struct sweep_element *sweep,
+                     struct sweep_element *next, void *arg);
+  void *sweep_done_arg;     // passed to sweep_done
 } file_element_s;
 
   
@@ -77,9 +86,23 @@ typedef struct sweep_element {
   IrisDList_t *types_list_p; // pointer to a doubly-linked list of data types recorded (structures that include ray data)
 } sweep_element_s;
 
+// define structure 'IRISfile' and type 'IRISfile'
+// an IRIS file image, memory mapped or held in memory, read record by record
+typedef struct IRISfile {
+  UINT1 *data;      // first byte of the file image
+  size_t size;      // size of the file image in bytes
+  size_t pos;       // offset of the next record to hand out
+  void *map;        // start of the memory mapping, NULL when not mapped
+  size_t map_size;  // length of the memory mapping
+  _Bool owns_data;  // data was allocated by IRISfile_open and is freed on close
+  size_t skip_from; // when skip_to > skip_from, the bytes [skip_from, skip_to) are
+  size_t skip_to;   // passed over, used to read the headers and a single sweep
+} IRISfile;
+
 // define structure 'IRISbuf' and type 'IRISbuf'
+// bufIRIS points into the IRIS file image, the record bytes are not copied
 typedef struct IRISbuf {
-  UINT1 bufIRIS[IRIS_BUFFER_SIZE];
+  UINT1 *bufIRIS;
   UINT2 bytesCopied;
   SINT2 errorInd;
   UINT2 numberSkipped;
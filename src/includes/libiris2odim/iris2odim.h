@@ -78,6 +78,20 @@ int Iris_exit_function(int return_code, int exit_code);
  */
 void Iris_printf(const char* fmt, ...);
 
+/**
+ * While set, the messages of Iris_printf on the calling thread are appended to
+ * *messages_p instead of being printed, as the print function may call back into
+ * R, which is only allowed from the main thread.
+ * @param[in] messages_p - string to append to (initially NULL), or NULL to print again
+ */
+void Iris_defer_printf(char** messages_p);
+
+/**
+ * Prints and frees the messages collected by Iris_defer_printf.
+ * @param[in] messages_p - the collected messages
+ */
+void Iris_print_deferred(char** messages_p);
+
 /**
  *
  * @param[in] ifile - a string containing the input IRIS file name;
@@ -87,6 +101,18 @@ void Iris_printf(const char* fmt, ...);
 int iris2list(const char* ifile,
               file_element_s **file_element_pp);
 
+/**
+ * Same as iris2list, but reads an IRIS file that is already held in memory.
+ * The records are parsed in place, so the buffer must stay valid until this
+ * function returns.
+ * @param[in] data - the contents of an IRIS file
+ * @param[in] size - the size of data in bytes
+ * @param[in] file_element_pp - an empty file_element_s structure filled by this function
+ * @return signed integer status indicator (zero means success)
+ */
+int iris2list_memory(const unsigned char* data, size_t size,
+                     file_element_s **file_element_pp);
+
 /**
 * Populates a polar scan "parameter" (aka moment, quantity, variable).
 * @param[in] param - polar scan parameter to be populated
@@ -131,6 +157,23 @@ int populateObject(RaveCoreObject* object, file_element_s *file_element_p);
  */
 file_element_s* readIRIS(const char* ifile);
 
+/**
+ * Allocates an empty file element, with its headers and an empty sweep list,
+ * to be filled by iris2list.
+ * @return file_element_s* - the file element, or NULL when an allocation failed
+ */
+file_element_s* new_IRIS(void);
+
+/**
+ * Reads an IRIS file straight into a polar volume. Each sweep is converted to
+ * a polar scan as soon as all of its rays have been read, after which its rays
+ * are released, so the rays of the whole file are never held next to the volume.
+ * @param[in] ifile - input IRIS file string
+ * @param[in] max_range_in_m - range bins beyond this range are not converted, 0 for all bins
+ * @return PolarVolume_t* - the volume, or NULL when the file could not be read
+ */
+PolarVolume_t* readIRISVolume(const char* ifile, double max_range_in_m);
+
 /**
  * Determines the Rave_ObjectType from the IRIS payload.
  * @param[in] **file_element_pp - structure representing the IRIS file contents
@@ -144,6 +187,12 @@ int objectTypeFromIRIS(file_element_s* file_element_p);
  */
 void free_IRIS(file_element_s **file_element_pp);
 
+/**
+ * Frees a single sweep, its ingest data headers and its rays
+ * @param[in] **sweep_pp - sweep that is not (or no longer) in a sweep list
+ */
+void free_IRIS_sweep(sweep_element_s **sweep_pp);
+
 /**
  * Determines whether the given path is to a regular file.
  * @param[in] file string to query
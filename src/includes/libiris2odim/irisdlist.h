@@ -70,6 +70,13 @@ IrisDListElement_t* IrisDList_addFront(IrisDList_t* list, void* data);
 
 IrisDListElement_t* IrisDList_addEnd(IrisDList_t* list, void* data);
 
+/**
+ * Removes the first element of the double linked list
+ * @param[in] list - the list the item should be removed from
+ * @return the data of the removed element, NULL if the list was empty
+ */
+void* IrisDList_removeFront(IrisDList_t* list);
+
 /* Below are some useful macros that makes it somewhat easier to read the code. If you prefer you can always
  * use the members in the structure directly */
 #define IrisDList_size(list) ((list)->size)
@@ -2,7 +2,15 @@
 extern "C" {
 #endif
 
-int run_mistnet(float* tensor_in, float** tensor_out, const char* model_path, int tensor_size);
+int run_mistnet(float* tensor_in, float** tensor_out, const char* model_path, int channels, int height, int width);
+
+int run_mistnet_batch(float* tensor_in, float** tensor_out, const char* model_path, int batch_size, int channels, int height, int width);
+
+void* load_mistnet_model(const char* model_path);
+
+void free_mistnet_model(void* model);
+
+void set_mistnet_threads(int n);
 
 #ifdef __cplusplus
 }
@@ -62,10 +62,106 @@ HOST_API int mistnet_run_mistnet(float* tensor_in, float** tensor_out, const cha
   MISTNET_HOST_HANDLER;
 }
 
-int run_mistnet(float* tensor_in, float** tensor_out, const char* model_path, int tensor_size)
+MISTNET_API void* (MISTNET_PTR _mistnet_load_model)(const char* model_path);
+HOST_API void* mistnet_load_model(const char* model_path)
 {
   MISTNET_CHECK_LOADED
-  return _mistnet_run_mistnet(tensor_in, tensor_out, model_path, tensor_size);
+  return _mistnet_load_model(model_path);
+  MISTNET_HOST_HANDLER;
+}
+
+MISTNET_API int (MISTNET_PTR _mistnet_run_model)(void* model, float* tensor_in, float** tensor_out, int channels, int height, int width);
+HOST_API int mistnet_run_model(void* model, float* tensor_in, float** tensor_out, int channels, int height, int width)
+{
+  MISTNET_CHECK_LOADED
+  return _mistnet_run_model(model, tensor_in, tensor_out, channels, height, width);
+  MISTNET_HOST_HANDLER;
+}
+
+MISTNET_API int (MISTNET_PTR _mistnet_run_model_batch)(void* model, float* tensor_in, float** tensor_out, int batch_size, int channels, int height, int width);
+HOST_API int mistnet_run_model_batch(void* model, float* tensor_in, float** tensor_out, int batch_size, int channels, int height, int width)
+{
+  MISTNET_CHECK_LOADED
+  return _mistnet_run_model_batch(model, tensor_in, tensor_out, batch_size, channels, height, width);
+  MISTNET_HOST_HANDLER;
+}
+
+MISTNET_API void (MISTNET_PTR _mistnet_set_num_threads)(int n);
+HOST_API void mistnet_set_num_threads(int n)
+{
+  MISTNET_CHECK_LOADED
+  _mistnet_set_num_threads(n);
+  MISTNET_HOST_HANDLER;
+}
+
+MISTNET_API void (MISTNET_PTR _mistnet_free_model)(void* model);
+HOST_API void mistnet_free_model(void* model)
+{
+  MISTNET_CHECK_LOADED
+  _mistnet_free_model(model);
+  MISTNET_HOST_HANDLER;
+}
+
+int run_mistnet(float* tensor_in, float** tensor_out, const char* model_path, int channels, int height, int width)
+{
+  MISTNET_CHECK_LOADED
+  // libraries built before the model handle API only provide _mistnet_run_mistnet,
+  // which loads the model from file on every call and is fixed to the original
+  // 15 x 608 x 608 input
+  if (_mistnet_load_model == NULL || _mistnet_run_model == NULL) {
+    if (channels != 15 || height != 608 || width != 608)
+      return -1;
+    return _mistnet_run_mistnet(tensor_in, tensor_out, model_path, channels * height * width);
+  }
+  void* model = _mistnet_load_model(model_path);
+  if (model == NULL)
+    return -1;
+  return _mistnet_run_model(model, tensor_in, tensor_out, channels, height, width);
+  MISTNET_HOST_HANDLER;
+}
+
+int run_mistnet_batch(float* tensor_in, float** tensor_out, const char* model_path, int batch_size, int channels, int height, int width)
+{
+  MISTNET_CHECK_LOADED
+  if (_mistnet_load_model == NULL || _mistnet_run_model_batch == NULL) {
+    // one input at a time with libraries built before the batch API
+    size_t tensor_size = (size_t) channels * height * width;
+    for (int i = 0; i < batch_size; i++) {
+      float* tensor_out_i = *tensor_out + i * tensor_size;
+      if (run_mistnet(tensor_in + i * tensor_size, &tensor_out_i, model_path, channels, height, width) < 0)
+        return -1;
+    }
+    return 0;
+  }
+  void* model = _mistnet_load_model(model_path);
+  if (model == NULL)
+    return -1;
+  return _mistnet_run_model_batch(model, tensor_in, tensor_out, batch_size, channels, height, width);
+  MISTNET_HOST_HANDLER;
+}
+
+void* load_mistnet_model(const char* model_path)
+{
+  MISTNET_CHECK_LOADED
+  if (_mistnet_load_model == NULL)
+    return NULL;
+  return _mistnet_load_model(model_path);
+  MISTNET_HOST_HANDLER;
+}
+
+void set_mistnet_threads(int n)
+{
+  MISTNET_CHECK_LOADED
+  if (_mistnet_set_num_threads != NULL)
+    _mistnet_set_num_threads(n);
+  MISTNET_HOST_HANDLER;
+}
+
+void free_mistnet_model(void* model)
+{
+  MISTNET_CHECK_LOADED
+  if (_mistnet_free_model != NULL && model != NULL)
+    _mistnet_free_model(model);
   MISTNET_HOST_HANDLER;
 }
 
@@ -106,6 +202,13 @@ void *pLibrary = NULL;
   if (!mistnetLoadSymbol(pLibrary, #name, (void **)&name, pError))  \
     return false;
 
+// symbols that older builds of the library may lack; left NULL when missing
+#define LOAD_OPTIONAL_SYMBOL(name)                                \
+  {                                                               \
+    std::string optionalError;                                    \
+    mistnetLoadSymbol(pLibrary, #name, (void **)&name, &optionalError); \
+  }
+
 void mistnetLoadError(std::string *pError)
 {
 #ifdef _WIN32
@@ -235,6 +338,11 @@ bool mistnetInit(const std::string &libPath, std::string *pError)
     return false;
   mistnet_loaded = true;
   LOAD_SYMBOL(_mistnet_run_mistnet);
+  LOAD_OPTIONAL_SYMBOL(_mistnet_load_model);
+  LOAD_OPTIONAL_SYMBOL(_mistnet_run_model);
+  LOAD_OPTIONAL_SYMBOL(_mistnet_run_model_batch);
+  LOAD_OPTIONAL_SYMBOL(_mistnet_free_model);
+  LOAD_OPTIONAL_SYMBOL(_mistnet_set_num_threads);
 
   return true;
 }
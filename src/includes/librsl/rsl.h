@@ -405,6 +405,25 @@ typedef struct {
 
 } Radar;
 
+/* Per-call selection of the sweeps to decode.  Readers that support it
+ * (WSR88D message 31) skip the radials of sweeps whose fixed elevation
+ * angle is outside [elev_min, elev_max] before decoding their moments,
+ * and do not decode gates beyond max_range.  Unlike RSL_read_these_sweeps,
+ * no global state is involved.  A NULL filter selects all sweeps.
+ */
+typedef struct {
+  float elev_min;  /* Lowest elevation angle to decode (degrees). */
+  float elev_max;  /* Highest elevation angle to decode (degrees). */
+  float max_range; /* Range of the last gate to decode (meters), 0 for all. */
+  int keep_sails;  /* Keep the SAILS sweeps of WSR-88D VCPs 12 and 212, as
+                      RSL_wsr88d_keep_sails does for all subsequent reads. */
+} RSL_sweep_filter;
+
+/* A WSR-88D message 31 volume assembled from the chunk files of the
+ * real-time Level II feed, see RSL_wsr88d_chunks_new.
+ */
+typedef struct Wsr88d_chunks Wsr88d_chunks;
+
 /*
  * DZ     Reflectivity (dBZ), may contain some     DZ_INDEX
  *        signal-processor level QC and/or      
@@ -552,6 +571,8 @@ typedef struct {
 
 Radar *RSL_africa_to_radar(char *infile);
 Radar *RSL_anyformat_to_radar(char *infile, ...);
+Radar *RSL_filetype_to_radar(enum File_type type, char *infile,
+                             char *callid_or_file, RSL_sweep_filter *filter);
 Radar *RSL_dorade_to_radar(char *infile);
 Radar *RSL_fix_radar_header(Radar *radar);
 Radar *RSL_get_window_from_radar(Radar *r, float min_range, float max_range,float low_azim, float hi_azim);
@@ -573,6 +594,15 @@ Radar *RSL_toga_to_radar(char *infile);
 Radar *RSL_uf_to_radar(char *infile);
 Radar *RSL_uf_to_radar_fp(FILE *fp);
 Radar *RSL_wsr88d_to_radar(char *infile, char *call_or_first_tape_file);
+Radar *RSL_wsr88d_to_radar_filtered(char *infile, char *call_or_first_tape_file,
+                                    RSL_sweep_filter *filter);
+Radar *RSL_wsr88d_chunks_radar(Wsr88d_chunks *chunks);
+
+Wsr88d_chunks *RSL_wsr88d_chunks_new(char *callid, RSL_sweep_filter *filter);
+int RSL_wsr88d_chunks_add(Wsr88d_chunks *chunks, char *filename);
+int RSL_wsr88d_chunks_nsweeps(Wsr88d_chunks *chunks);
+int RSL_wsr88d_chunks_complete(Wsr88d_chunks *chunks);
+void RSL_wsr88d_chunks_free(Wsr88d_chunks *chunks);
 
 Volume *RSL_clear_volume(Volume *v);
 Volume *RSL_copy_volume(Volume *v);
@@ -759,7 +789,10 @@ FILE* create_temporary_file(void);
 FILE *uncompress_pipe (FILE *fp);
 FILE *compress_pipe (FILE *fp);
 int rsl_pclose(FILE *fp);
+size_t rsl_gunzip_peek(const unsigned char *in, size_t inlen,
+                       unsigned char *out, size_t outlen);
 enum File_type RSL_filetype(char *infile);
+enum File_type RSL_filetype_from_buffer(const unsigned char *buf, size_t len);
 
 /* Carpi image generation functions. These are modified clones of the
      corresponding sweep image generation functions.
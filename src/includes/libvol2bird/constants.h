@@ -86,9 +86,9 @@
 //-------------------------------------------------------//
 //            MistNet hard-coded options                 //
 //-------------------------------------------------------//
-// resolution of the Cartesian grid in meter for Mistnet
+// default resolution of the Cartesian grid in meter for Mistnet
 #define MISTNET_RESOLUTION 500
-// X and Y dimension of the Cartesian grid for Mistnet,
+// default X and Y dimension of the Cartesian grid for Mistnet,
 // including a 4 pixel padding around the image, i.e. 8
 // additional pixels.
 #define MISTNET_DIMENSION 608
@@ -96,6 +96,8 @@
 #define MISTNET_BLEED 8
 // number of MistNet elevation scans expected
 #define MISTNET_N_ELEV 5
+// number of volumes segmented in one MistNet forward pass by segmentVolumesUsingMistnet()
+#define MISTNET_BATCH_SIZE 4
 // predict a pixel as rain if the class probability for rain exceeds this threshold
 #define MISTNET_WEATHER_THRESHOLD 0.45
 // predict a pixel as rain if the average class probability for rain across
@@ -123,8 +125,21 @@
 #define TEXNAME "VTEX"
 // name under which the calculated raincell masking quantity will be stored
 #define CELLNAME "CELL"
+// RAVE data types of the texture and raincell masking quantities; the cell
+// label map is accessed directly as a short array
+#define TEXTYPE RaveDataType_FLOAT
+#define CELLTYPE RaveDataType_SHORT
+// highest cell index stored in the cell label map, leaving room for the
+// temporary renumbering of cells in updateMap()
+#define CELLMAX 32000
 // name of the parameter containing the static cluttermap
 #define CLUTNAME "OCCULT"
+// scan attribute marking that texture and cell masks were already calculated (SAILS profiles)
+#define SEGMENTED_ATTRIBUTE "how/vol2bird_segmented"
+// scan attribute marking MistNet input scans segmented earlier in the run (MistNet batches)
+#define MISTNET_SEGMENTED_ATTRIBUTE "how/vol2bird_mistnet_segmented"
+// maximum number of SAILS repeats of the lowest scan, i.e. profiles per volume
+#define SAILSMAX 8
 // Name of the program, to be stored as task attribute in ODIM
 #define PROGRAM "vol2bird"
 // Version of the program, to be stored as task_version attribute in ODIM
@@ -250,6 +265,16 @@
 #define MISTNET_ELEVS_ONLY 1
 // location of mistnet model in pytorch format
 #define MISTNET_PATH "/MistNet/mistnet_nexrad.pt"
+// number of libtorch intra-op threads running mistnet, 0 for the libtorch default
+#define MISTNET_THREADS 0
+// number of MistNet outputs kept in memory for reuse on identical input, 0 to disable
+#define MISTNET_CACHE 0
+// directory where MistNet outputs are stored for reuse on identical input, empty to disable
+#define MISTNET_CACHE_DIR ""
+// calculate a profile for each repeat of the lowest elevation scan (NEXRAD SAILS)
+#define SAILS_PROFILES 0
+// include the texture and raincell masking quantities in polar volume output files
+#define OUTPUT_SEGMENTATION 1
 // initializing value of mistnet tensor
 #define MISTNET_INIT 0
 // require that radial velocity and spectrum width pixels rendered as mistnet input
@@ -0,0 +1,37 @@
+/** Metadata-only catalog of radar input files
+ * @file libcatalog.h
+ *
+ * Requires libvol2bird.h to be included first (radarDataFormat).
+ */
+#ifndef LIBCATALOG_H
+#define LIBCATALOG_H
+
+// maximum number of scans (sweeps / elevation cuts) listed per file
+#define CATALOG_MAX_SCANS 64
+
+// length of the comma separated list of quantities of a scan
+#define CATALOG_QUANTITIES_SIZE 80
+
+typedef struct vol2birdCatalogScan {
+    float elangle;     // elevation angle in degrees
+    int nrays;         // number of rays (azimuths)
+    int nbins;         // number of range bins
+    float rscale;      // range bin size in m
+    char quantities[CATALOG_QUANTITIES_SIZE]; // comma separated ODIM quantity names
+} vol2birdCatalogScan_t;
+
+typedef struct vol2birdCatalogEntry {
+    radarDataFormat format;
+    int status;        // 0 when the headers were read, -1 otherwise
+    char radar[64];    // radar identifier (ODIM NOD/WMO, NEXRAD ICAO, IRIS site name)
+    char date[9];      // nominal date YYYYMMDD
+    char time[7];      // nominal time HHMMSS
+    int nScans;
+    vol2birdCatalogScan_t scans[CATALOG_MAX_SCANS];
+} vol2birdCatalogEntry_t;
+
+int vol2birdCatalogFile(const char* filename, vol2birdCatalogEntry_t* entry);
+
+int vol2birdCatalogFiles(char* filenames[], int nFiles, vol2birdCatalogEntry_t* entries);
+
+#endif
@@ -3,6 +3,8 @@
 
 Cartesian_t* polarVolumeToCartesian(PolarVolume_t* pvol, long dim, long res, double init);
 
+int polarVolumeToPPI(PolarVolume_t* pvol, const char* quantity, long dim, long res, double* ppi);
+
 double distance2height(double distance,double elev);
 
 double distance2range(double distance,double elev);
@@ -27,9 +29,17 @@ float* flatten3DTensor(double ***tensor, int dim1, int dim2, int dim3);
 
 void free3DTensor(double ***tensor, int dim1, int dim2);
 
+float* newTensor(size_t size);
+
+void freeTensor(float* tensor);
+
+int polarVolumeToTensor(PolarVolume_t* pvol, float* tensor, long dim, long res, int nChannels);
+
 void free4DTensor(float ****tensor, int dim1, int dim2, int dim3);
 
 #ifdef MISTNET 
 int segmentScansUsingMistnet(PolarVolume_t* volume, vol2birdScanUse_t *scanUse, vol2bird_t* alldata);
+
+vol2birdMistnetBatch_t* mistnetBatchNew(PolarVolume_t* volumes[], vol2birdScanUse_t *scanUse[], int nVolumes, vol2bird_t* alldata);
 #endif
 
@@ -2,6 +2,6 @@
 
 #include "rsl.h"
 
-PolarVolume_t* vol2birdGetRSLVolume(char* filename, float rangeMax, int small);
+PolarVolume_t* vol2birdGetRSLVolume(char* filename, enum File_type filetype, float rangeMax, int small, float elevMin, float elevMax, int keepSails);
 
 #endif
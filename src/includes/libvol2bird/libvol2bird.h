@@ -49,6 +49,9 @@
 #define FALSE 0
 #endif
 
+// number of leading file bytes read to determine the input format
+#define VOL2BIRD_PROBE_SIZE 4096
+
 // ****************************************************************************
 //  Structure for containing SCAN metadata:
 // ****************************************************************************
@@ -145,6 +148,13 @@ struct vol2birdOptions {
                                     /* otherwise, use all available elevation scans*/
     int useMistNet;                 /* whether to use MistNet segmentation model */
     char mistNetPath[1000];         /* path and filename of the MistNet segmentation model to use, expects libtorch format */
+    int mistNetThreads;             /* number of libtorch intra-op threads running MistNet, 0 for the libtorch default */
+    int mistNetDimension;           /* X and Y dimension of the Cartesian grid of the MistNet model, including the bleed */
+    int mistNetResolution;          /* resolution of the Cartesian grid of the MistNet model in meter */
+    int mistNetCache;               /* number of MistNet outputs kept in memory for reuse on identical input, 0 to disable */
+    char mistNetCacheDir[1000];     /* directory where MistNet outputs are stored for reuse on identical input, empty to disable */
+    int sailsProfiles;              /* calculate a profile for each repeat of the lowest scan (NEXRAD SAILS) if TRUE */
+    int outputSegmentation;         /* include the texture and cell quantities in polar volume output files if TRUE */
 
 };
 typedef struct vol2birdOptions vol2birdOptions_t;
@@ -358,6 +368,13 @@ struct vol2birdMisc {
     int vcp;
     // the radar name extracted from the source string
     char radarName[100];
+    // whether vol2birdSegmentScans marked scans as segmented in this run
+    int scansSegmented;
+    // whether vol2birdSegmentScans selected the polarization mode of this run,
+    // and the singlePol and dualPol options it selected
+    int polarizationSelected;
+    int singlePolSelected;
+    int dualPolSelected;
 };
 typedef struct vol2birdMisc vol2birdMisc_t;
 
@@ -397,6 +414,9 @@ struct vol2bird {
 };
 typedef struct vol2bird vol2bird_t;
 
+// NEXRAD Level II volume received as chunk files of the real-time feed
+typedef struct vol2birdChunks vol2birdChunks_t;
+
 typedef void(*vol2bird_printfun)(const char* msg);
 
 void vol2bird_set_printf(vol2bird_printfun fun);
@@ -446,6 +466,8 @@ typedef struct {
 
 radarDataFormat determineRadarFormat(char* filename);
 
+radarDataFormat vol2birdProbeFormat(const char* filename, int* rslFileType);
+
 int isRegularFile(const char *path);
 
 void vol2birdCalcProfiles(vol2bird_t* alldata);
@@ -454,8 +476,14 @@ float* vol2birdGetProfile(int iProfileType, vol2bird_t* alldata);
 
 PolarVolume_t* vol2birdGetVolume(char* filenames[], int nInputFiles, float rangeMax, int small);
 
+float vol2birdGetReadRange(vol2bird_t* alldata);
+
+PolarVolume_t* vol2birdGetVolumeElevRange(char* filenames[], int nInputFiles, float rangeMax, int small, float elevMin, float elevMax, int keepSails);
+
 PolarVolume_t* PolarVolume_resample(PolarVolume_t* volume, double rscale_proj, long nbins_proj, long nrays_proj);
 
+int PolarVolume_splitSails(PolarVolume_t* pvol, PolarVolume_t** subVolumes, int maxSubVolumes);
+
 PolarScanParam_t* PolarScanParam_project_on_scan(PolarScanParam_t* param, PolarScan_t* scan, double rscale);
 
 PolarScanParam_t* PolarScan_newParam(PolarScan_t *scan, const char *quantity, RaveDataType type);
@@ -478,6 +506,36 @@ int vol2birdLoadConfig(vol2bird_t* alldata, const char* optionsFile);
 
 int vol2birdSetUp(PolarVolume_t* volume, vol2bird_t* alldata);
 
+int vol2birdSegmentScans(PolarVolume_t* volume, vol2bird_t* alldata);
+
+void vol2birdClearSegmented(PolarVolume_t* volume);
+
+#ifdef MISTNET
+typedef struct vol2birdMistnetBatch vol2birdMistnetBatch_t;
+
+int vol2birdSegmentVolumesUsingMistnet(PolarVolume_t* volumes[], int nVolumes, vol2bird_t* alldata);
+
+vol2birdMistnetBatch_t* vol2birdMistnetBatchNew(PolarVolume_t* volumes[], int nVolumes, vol2bird_t* alldata);
+
+int vol2birdMistnetBatchRun(vol2birdMistnetBatch_t* batch);
+
+int vol2birdMistnetBatchApply(vol2birdMistnetBatch_t* batch);
+
+void vol2birdMistnetBatchFree(vol2birdMistnetBatch_t* batch);
+#endif
+
+vol2birdChunks_t* vol2birdChunksNew(const char* callid, float rangeMax, int small, float elevMin, float elevMax, int keepSails);
+
+int vol2birdChunksAdd(vol2birdChunks_t* chunks, const char* filename, vol2bird_t* alldata);
+
+int vol2birdChunksComplete(vol2birdChunks_t* chunks);
+
+int vol2birdChunksNumberOfScans(vol2birdChunks_t* chunks);
+
+PolarVolume_t* vol2birdChunksVolume(vol2birdChunks_t* chunks);
+
+void vol2birdChunksFree(vol2birdChunks_t* chunks);
+
 int get_radar_name(const char* source, char* radarName, size_t radarNameLength);
 
 void vol2birdTearDown(vol2bird_t* alldata);
@@ -503,8 +561,12 @@ void write_line_vpts_profile(char* printbuffer, int buflen,
 
 int saveToODIM(RaveCoreObject* object, const char* filename);
 
+int saveVolumeToODIM(PolarVolume_t* volume, const char* filename, vol2bird_t* alldata);
+
 int saveToCSV(const char *filename, vol2bird_t* alldata, PolarVolume_t* pvol);
 
+int appendToCSV(const char *filename, vol2bird_t* alldata, PolarVolume_t* pvol);
+
 int isCSV(const char *filename);
 
 const char* libvol2bird_version(void);
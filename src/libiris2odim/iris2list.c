@@ -36,6 +36,12 @@ along with RAVE.  If not, see <http://www.gnu.org/licenses/>.
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include "iris2odim.h" // this includes rave_alloc and other rave related
 #include "iris2list_listobj.h"
 #include "iris2list_sigmet.h"
@@ -57,8 +63,266 @@ along with RAVE.  If not, see <http://www.gnu.org/licenses/>.
 * input file                                                                 *
 *                                                                            *
 *****************************************************************************/
+static int iris2list_read(IRISfile *fpIn,
+                          file_element_s **file_element_pp);
+
+static int iris2list_sweeps(IRISfile *fpIn,
+                            file_element_s **file_element_pp);
+
 int iris2list(const char *ifile,
               file_element_s **file_element_pp) {
+   IRISfile *fpIn = IRISfile_open( ifile );
+   if( fpIn == NULL) {        /* if failed to open file, tell the user */
+      Iris_printf("Failed to open IRIS file %s.\n",ifile);
+      free_IRIS(file_element_pp);
+      return -1;
+   }
+   return iris2list_sweeps(fpIn, file_element_pp);
+}
+
+/*****************************************************************************
+*                                                                            *
+*  --------------------------- iris2list_memory ---------------------------  *
+* As iris2list, but the IRIS file is read from a caller supplied buffer that *
+* must remain valid until this function returns.                             *
+*                                                                            *
+*****************************************************************************/
+int iris2list_memory(const unsigned char *data, size_t size,
+                     file_element_s **file_element_pp) {
+   IRISfile *fpIn = IRISfile_from_memory( data, size );
+   if( fpIn == NULL) {
+      Iris_printf("Failed to allocate an IRIS file structure.\n");
+      free_IRIS(file_element_pp);
+      return -1;
+   }
+   return iris2list_sweeps(fpIn, file_element_pp);
+}
+
+/*
+ * hands every completed sweep in the sweep list to the sweep_done callback of
+ * the file element, if any, and frees it. 'next' is the sweep being read
+ * after them, or NULL at the end of the file.
+ */
+static void flush_sweeps(file_element_s *file_element_p,
+                         sweep_element_s *next) {
+   IrisDList_t *sweeplist = file_element_p->sweep_list_p;
+   sweep_element_s *sweep = NULL;
+   sweep_element_s *following = NULL;
+   if(file_element_p->sweep_done == NULL) return;
+   while(IrisDList_size(sweeplist) > 0) {
+      sweep = (sweep_element_s *) IrisDList_removeFront(sweeplist);
+      if(IrisDList_size(sweeplist) > 0) {
+         following = (sweep_element_s *) IrisDList_head(sweeplist)->data;
+      }
+      else {
+         following = next;
+      }
+      file_element_p->sweep_done(file_element_p, sweep, following,
+                                 file_element_p->sweep_done_arg);
+      free_IRIS_sweep(&sweep);
+   }
+}
+
+/*
+ * returns 1 when the bytes of the IRIS file image have to be swapped
+ * (target_is_big_endian), 0 when they do not and -1 when the image does not
+ * start with a structure header (id 27)
+ */
+static int iris_byte_order(IRISfile *fp) {
+   UINT2 structID = 0;
+   if( fp->size < 2) return -1;
+   memcpy(&structID, fp->data, 2);
+   if( structID == 27) return 0;
+   if( Swap2Bytes(structID) == 27) return 1;
+   return -1;
+}
+
+/*
+ * returns 1 when the ingest_data_header structures that follow the
+ * raw_prod_bhdr of the record at the start of a sweep lie within the bytes
+ * of the record, 0 when the record was cut short. Records are views into
+ * the file image, so a truncated last record must not be read in full.
+ */
+static int ingest_data_headers_fit(IRISbuf *IRISbuf_p,
+                                   _Bool target_is_big_endian) {
+   size_t byte_offset = RAW_PROD_BHDR_SIZE;
+   int nheaders = 0;
+   UINT2 structID;
+   while( byte_offset + 2 <= IRISbuf_p->bytesCopied ) {
+      memcpy(&structID, IRISbuf_p->bufIRIS + byte_offset, 2);
+      if( target_is_big_endian) structID = Swap2Bytes(structID);
+      if( structID != 24) return 1;
+      if( byte_offset + INGEST_DATA_HEADER_SIZE > IRISbuf_p->bytesCopied) {
+         return 0;
+      }
+      byte_offset += INGEST_DATA_HEADER_SIZE;
+      nheaders++;
+   }
+   /* the record ends after the headers, at least one has to be complete */
+   return nheaders > 0;
+}
+
+/*
+ * hands the sweeps decoded from one part of the file to the file element:
+ * each sweep goes to the sweep_done callback once its successor is known, or
+ * is appended to the sweep list when there is no callback. *pending_pp holds
+ * the sweep still waiting for its successor, NULL after the last part.
+ */
+static void merge_sweeps(file_element_s *file_element_p,
+                         sweep_element_s **pending_pp,
+                         IrisDList_t *sweeps) {
+   sweep_element_s *sweep = NULL;
+   while(1) {
+      sweep = (sweeps != NULL && IrisDList_size(sweeps) > 0) ?
+         (sweep_element_s *) IrisDList_removeFront(sweeps) : NULL;
+      if(*pending_pp != NULL) {
+         if(file_element_p->sweep_done != NULL) {
+            file_element_p->sweep_done(file_element_p, *pending_pp, sweep,
+                                       file_element_p->sweep_done_arg);
+            free_IRIS_sweep(pending_pp);
+         }
+         else {
+            (void)IrisDList_addEnd(file_element_p->sweep_list_p, *pending_pp);
+         }
+         *pending_pp = NULL;
+      }
+      if(sweep == NULL) break;
+      *pending_pp = sweep;
+   }
+}
+
+/*****************************************************************************
+*                                                                            *
+*  --------------------------- iris2list_sweeps ---------------------------  *
+* Reads the IRIS file image fpIn into *file_element_pp like iris2list_read,  *
+* but decodes the sweeps of a RAW volume in parallel. Every sweep starts on  *
+* a new record, so the records are first indexed by the sweep number in      *
+* their raw_prod_bhdr, after which each sweep is read from a view holding    *
+* the two header records and its own records. The sweeps are decoded in     *
+* batches of one per thread and handed over in sweep order, so the file      *
+* element ends up as it would after a sequential read. Falls back to the     *
+* sequential read without OpenMP or when the records cannot be indexed.      *
+* Closes fpIn.                                                               *
+*                                                                            *
+*****************************************************************************/
+static int iris2list_sweeps(IRISfile *fpIn,
+                            file_element_s **file_element_pp) {
+   int nthreads = 1;
+#ifdef _OPENMP
+   nthreads = omp_get_max_threads();
+#endif
+   int byte_order = iris_byte_order(fpIn);
+   size_t nrecords = fpIn->size / IRIS_BUFFER_SIZE;
+   if(nthreads < 2 || byte_order < 0 || nrecords < 3 ||
+      fpIn->size % IRIS_BUFFER_SIZE != 0) {
+      return iris2list_read(fpIn, file_element_pp);
+   }
+   /* only RAW products are made of sweeps */
+   UINT2 product_type_code;
+   memcpy(&product_type_code, fpIn->data + STRUCT_HEADER_SIZE + 12, 2);
+   if(byte_order) product_type_code = Swap2Bytes(product_type_code);
+   if(product_type_code != 15) {
+      return iris2list_read(fpIn, file_element_pp);
+   }
+   /* 
+    * index the first record of each sweep, sweep_starts[nsweeps] is the
+    * end of the file
+    */
+   size_t *sweep_starts = RAVE_MALLOC((nrecords + 1) * sizeof(size_t));
+   if(sweep_starts == NULL) {
+      return iris2list_read(fpIn, file_element_pp);
+   }
+   int nsweeps = 0;
+   SINT2 current_sweep = 0;
+   for(size_t rec = 2; rec < nrecords; rec++) {
+      UINT2 sweep_number;
+      memcpy(&sweep_number, fpIn->data + rec * IRIS_BUFFER_SIZE + 2, 2);
+      if(byte_order) sweep_number = Swap2Bytes(sweep_number);
+      if((SINT2) sweep_number < current_sweep || (SINT2) sweep_number < 1) {
+         /* not a regular sequence of sweeps, let the sequential read cope */
+         nsweeps = 0;
+         break;
+      }
+      if((SINT2) sweep_number > current_sweep) {
+         sweep_starts[nsweeps++] = rec * IRIS_BUFFER_SIZE;
+         current_sweep = (SINT2) sweep_number;
+      }
+   }
+   if(nsweeps < 2) {
+      RAVE_FREE(sweep_starts);
+      return iris2list_read(fpIn, file_element_pp);
+   }
+   sweep_starts[nsweeps] = fpIn->size;
+
+   int ret = 0;
+   int batch = (nthreads < nsweeps) ? nthreads : nsweeps;
+   file_element_s **parts = RAVE_CALLOC((size_t) batch, sizeof *parts);
+   char **messages = RAVE_CALLOC((size_t) batch, sizeof *messages);
+   sweep_element_s *pending = NULL;
+   if(parts == NULL || messages == NULL) {
+      Iris_printf("Error! Unable to allocate sweep arrays in"
+                  " function 'iris2list_sweeps'.\n");
+      ret = -1;
+      goto done;
+   }
+   for(int first = 0; first < nsweeps && ret == 0; first += batch) {
+      int n = (nsweeps - first < batch) ? nsweeps - first : batch;
+      int k;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+      for(k = 0; k < n; k++) {
+         /*
+          * Iris_printf may call back into R, hold on to the messages
+          * of this sweep and print them after the parallel region
+          */
+         Iris_defer_printf(&messages[k]);
+         IRISfile *view = IRISfile_sweep(fpIn, sweep_starts[first+k],
+                                         sweep_starts[first+k+1]);
+         parts[k] = (view != NULL) ? new_IRIS() : NULL;
+         if(parts[k] != NULL) {
+            /* closes the view, and frees parts[k] when failing */
+            (void)iris2list_read(view, &parts[k]);
+         }
+         else {
+            IRISfile_close(view);
+         }
+         Iris_defer_printf(NULL);
+      }
+      for(k = 0; k < n; k++) {
+         Iris_print_deferred(&messages[k]);
+         if(parts[k] == NULL) {
+            Iris_printf("Failed to read sweep %d of the IRIS file.\n",
+                        first + k + 1);
+            ret = -1;
+            continue;
+         }
+         if(ret == 0) {
+            if(first == 0 && k == 0) {
+               /* the headers are the same in every part */
+               *(*file_element_pp)->product_header_p = *parts[k]->product_header_p;
+               *(*file_element_pp)->ingest_header_p = *parts[k]->ingest_header_p;
+            }
+            merge_sweeps(*file_element_pp, &pending, parts[k]->sweep_list_p);
+         }
+         free_IRIS(&parts[k]);
+      }
+   }
+   if(ret == 0) merge_sweeps(*file_element_pp, &pending, NULL);
+
+done:
+   free_IRIS_sweep(&pending);
+   RAVE_FREE(parts);
+   RAVE_FREE(messages);
+   RAVE_FREE(sweep_starts);
+   IRISfile_close(fpIn);
+   if(ret != 0) free_IRIS(file_element_pp);
+   return ret;
+}
+
+/* reads the IRIS file image fpIn into *file_element_pp, closes fpIn */
+static int iris2list_read(IRISfile *fpIn,
+                          file_element_s **file_element_pp) {
    IrisDList_t *sweeplist = (*file_element_pp)->sweep_list_p;
    sweep_element_s *sweep_list_element = NULL;
    sweep_element_s *sweep_list_element_new = NULL;
@@ -74,50 +338,25 @@ int iris2list(const char *ifile,
    SINT2 recNum;
    UINT1 myRecNumBytes[2], b1,b2;
    SINT2* rn_p = NULL;
-   FILE *fpIn = NULL;
    rn_p = (SINT2*) &myRecNumBytes[0];
    int ray_count[MAX_DATA_TYPES_IN_FILE];
    for(int nnn=0; nnn < (MAX_DATA_TYPES_IN_FILE); nnn++) ray_count[nnn] = 0;
    int type_index = 0;
    /*****************************************************************************
-    *                                                                           *
-    * open an input file for reading,  abort the program if unable to open file.*
     *                                                                           *
     * try to ascertain if the file is big_endian or little_endian               *
     *                                                                           *
     ****************************************************************************/
-   fpIn = fopen( ifile, "rb" );
-   if( fpIn == NULL) {        /* if failed to open file, tell the user */
-      Iris_printf("Failed to open IRIS file %s.\n",ifile);
+   int byte_order = iris_byte_order(fpIn);
+   if( byte_order < 0) {
+      Iris_printf(
+      "Failed to establish endian status of input file.\n"
+      "Likely this is because the input file is NOT an IRIS file.\n");
       free_IRIS(file_element_pp);
+      if (fpIn != NULL) IRISfile_close(fpIn);
       return -1;
    }
-   char c[2];
-   c[0] = fgetc(fpIn);
-   c[1] = fgetc(fpIn);
-   short *structID_p;
-   structID_p= (short *) &c;
-   if( *structID_p != 27) {
-      char dummyc;
-      dummyc = c[0];
-      c[0] = c[1];
-      c[1] = dummyc;
-      if( *structID_p != 27) {
-         Iris_printf(
-         "Failed to establish endian status of input file.\n"
-         "Likely this is because the input file is NOT an IRIS file.\n");
-         free_IRIS(file_element_pp);
-         if (fpIn != NULL) fclose(fpIn);
-         return -1;
-      }
-      else {
-         target_is_big_endian = 1;
-      }
-   }
-   else {
-      target_is_big_endian = 0;
-   }
-   rewind(fpIn);
+   target_is_big_endian = (_Bool) byte_order;
   
    /* make sure that the pointer to a sweep is NULL at this point */
    sweep_list_element = NULL;
@@ -152,7 +391,7 @@ int iris2list(const char *ifile,
          *file_element_pp = NULL;
       }
       if(fpIn != NULL) {
-         fclose(fpIn);
+         IRISfile_close(fpIn);
          fpIn = NULL;
       }
       return -1;
@@ -165,7 +404,7 @@ int iris2list(const char *ifile,
          *file_element_pp = NULL;
       }
       if(fpIn != NULL) {
-         fclose(fpIn);
+         IRISfile_close(fpIn);
          fpIn = NULL;
       }
       if( IRISbuf_p != NULL) {
@@ -182,7 +421,7 @@ int iris2list(const char *ifile,
          *file_element_pp = NULL;
       }
       if(fpIn != NULL) {
-         fclose(fpIn);
+         IRISfile_close(fpIn);
          fpIn = NULL;
       }
       if( IRISbuf_p != NULL) {
@@ -206,7 +445,7 @@ int iris2list(const char *ifile,
          *file_element_pp = NULL;
       }
       if(fpIn != NULL) {
-         fclose(fpIn);
+         IRISfile_close(fpIn);
          fpIn = NULL;
       }
       if( IRISbuf_p != NULL) {
@@ -237,7 +476,7 @@ int iris2list(const char *ifile,
             *file_element_pp = NULL;
          }
          if(fpIn != NULL) {
-            fclose(fpIn);
+            IRISfile_close(fpIn);
             fpIn = NULL;
          }
          return -1;
@@ -250,7 +489,7 @@ int iris2list(const char *ifile,
             *file_element_pp = NULL;
          }
          if(fpIn != NULL) {
-            fclose(fpIn);
+            IRISfile_close(fpIn);
             fpIn = NULL;
          }
          if( IRISbuf_p != NULL) {
@@ -268,7 +507,7 @@ int iris2list(const char *ifile,
             *file_element_pp = NULL;
          }
          if(fpIn != NULL) {
-            fclose(fpIn);
+            IRISfile_close(fpIn);
             fpIn = NULL;
          }
          if( IRISbuf_p != NULL) {
@@ -308,7 +547,7 @@ int iris2list(const char *ifile,
          Iris_printf("Second call to 'getabuf' "
                  "returned no ingest_header structure.\n");
          if(fpIn != NULL) {
-            fclose(fpIn);
+            IRISfile_close(fpIn);
             fpIn = NULL;
          }
          if(*file_element_pp != NULL) {
@@ -325,7 +564,7 @@ int iris2list(const char *ifile,
             IRISbuf_p = NULL;
          }
          if(fpIn != NULL) {
-            fclose(fpIn);
+            IRISfile_close(fpIn);
             fpIn = NULL;
          }
          if(*file_element_pp != NULL) {
@@ -346,7 +585,7 @@ int iris2list(const char *ifile,
             *file_element_pp = NULL;
          }
          if(fpIn != NULL) {
-            fclose(fpIn);
+            IRISfile_close(fpIn);
             fpIn = NULL;
          }
          return -1;
@@ -369,7 +608,7 @@ int iris2list(const char *ifile,
             *file_element_pp = NULL;
          }
          if(fpIn != NULL) {
-            fclose(fpIn);
+            IRISfile_close(fpIn);
             fpIn = NULL;
          }
          return -1;
@@ -402,7 +641,7 @@ int iris2list(const char *ifile,
             *file_element_pp = NULL;
          }
          if(fpIn != NULL) {
-            fclose(fpIn);
+            IRISfile_close(fpIn);
             fpIn = NULL;
          }
          return -1;
@@ -421,7 +660,7 @@ int iris2list(const char *ifile,
             *file_element_pp = NULL;
          }
          if(fpIn != NULL) {
-            fclose(fpIn);
+            IRISfile_close(fpIn);
             fpIn = NULL;
          }
          return -1;
@@ -431,7 +670,8 @@ int iris2list(const char *ifile,
           * Hit EOF while extracting a regular sized IRIS buffer
           * Exit the while loop if there's nothing in this ray to work with.
           */
-         if(IRISbuf_p->bytesCopied < 2 || IRISbuf_p->numberSkipped > 0) {
+         if(IRISbuf_p->bytesCopied < RAW_PROD_BHDR_SIZE ||
+            IRISbuf_p->numberSkipped > 0) {
             save_and_exit = 1;
             goto se;
          }
@@ -486,7 +726,7 @@ int iris2list(const char *ifile,
             *file_element_pp = NULL;
          }
          if(fpIn != NULL) {
-            fclose(fpIn);
+            IRISfile_close(fpIn);
             fpIn = NULL;
          }
          return -1;
@@ -503,6 +743,14 @@ int iris2list(const char *ifile,
        * type) and save those in the new sweep. Type lists and rays lists that are 
        * part of the new sweep element are also allocated in the function.
        ****************************************************************************/
+      if( rpb_p->sweep_number > current_sweep &&
+          !ingest_data_headers_fit(IRISbuf_p, target_is_big_endian)) {
+         /* the file ends within the headers of a new sweep */
+         RAVE_FREE(rpb_p);
+         rpb_p = NULL;
+         save_and_exit = 1;
+         goto se;
+      }
       if( rpb_p->sweep_number > current_sweep ) {
          sweep_list_element_new =
             handle_ingest_data_headers(&sweeplist,
@@ -515,12 +763,14 @@ int iris2list(const char *ifile,
             Iris_printf("It usually means the program was unable to allocate"
                            " a sweep_list_element structure.\n");
             free_IRIS(file_element_pp);
-            if (fpIn != NULL) fclose(fpIn);
+            if (fpIn != NULL) IRISfile_close(fpIn);
             return -1;
          }
          /* set a pointer to the current sweep element */
          sweep_list_element = sweep_list_element_new;
          sweep_list_element_new = NULL;
+         /* the previous sweep is complete */
+         flush_sweeps(*file_element_pp, sweep_list_element);
          /* update the current_sweep */
          current_sweep = rpb_p->sweep_number;
          /* point to the type list for this sweep */
@@ -540,7 +790,14 @@ int iris2list(const char *ifile,
        * offset = -1 means no rays in this record, so skip the rest and read the 
        * next record
        ****************************************************************************/
-      if(rpb_p->offset_of_first_ray_in_record == -1 ) continue;
+      if(rpb_p->offset_of_first_ray_in_record == -1 ) {
+         RAVE_FREE(rpb_p);
+         rpb_p = NULL;
+         bufIRIS_p = NULL;
+         RAVE_FREE(IRISbuf_p);
+         IRISbuf_p = NULL;
+         continue;
+      }
       /*****************************************************************************
        * copy the byte offset into the input array to a separate variable
        * (ie initialize b_offset)
@@ -578,7 +835,7 @@ int iris2list(const char *ifile,
                *file_element_pp = NULL;
             }
             if (fpIn != NULL) {
-               fclose(fpIn);
+               IRISfile_close(fpIn);
                fpIn = NULL;
             }
             return -1;
@@ -650,7 +907,6 @@ int iris2list(const char *ifile,
             rayplus_p->new_IRISbuf_p = NULL;  // null this pointer so we can free rayplus_p later
             /*
              * set a pointer to the buffer/byte-array inside the IRISbuf structure 
-             * NOTE! IRISbuf_p->bufIRIS is an array, not a pointer
              */
             bufIRIS_p = &IRISbuf_p->bufIRIS[0];
             /*
@@ -676,12 +932,14 @@ int iris2list(const char *ifile,
                Iris_printf("It usually means the program was unable to allocate"
                               " a sweep_element_s structure.\n");
                free_IRIS(file_element_pp);
-               if (fpIn != NULL) fclose(fpIn);
+               if (fpIn != NULL) IRISfile_close(fpIn);
                return -1;
             }
             /* set a pointer to the current sweep element */
             sweep_list_element = rayplus_p->new_sweep_element_p;
             rayplus_p->new_sweep_element_p = NULL;
+            /* the previous sweep is complete */
+            flush_sweeps(*file_element_pp, sweep_list_element);
             /* update the current_sweep counter */
             current_sweep = rpb_p->sweep_number;
             /* point to the type list for this sweep */
@@ -755,7 +1013,7 @@ int iris2list(const char *ifile,
                Iris_printf("IrisDList_head(datatypelist) == NULL? "
                               "Should never happen. \n");
                free_IRIS(file_element_pp);
-               if (fpIn != NULL) fclose(fpIn);
+               if (fpIn != NULL) IRISfile_close(fpIn);
                return -1;
             }
          }
@@ -865,7 +1123,8 @@ se:   if(IRISbuf_p == NULL) break;
          (void)IrisDList_addEnd(sweeplist, sweep_list_element);
       }
    }
-   if (fpIn != NULL) fclose(fpIn);
+   flush_sweeps(*file_element_pp, NULL);
+   if (fpIn != NULL) IRISfile_close(fpIn);
    return 0;
 }
 
@@ -1003,6 +1262,8 @@ sweep_element_s  *handle_ingest_data_headers(
        * the next Structure identifier' = 24 (Ingest_data_header)
        */
       byte_offset += INGEST_DATA_HEADER_SIZE;
+      /* the record may end right after the last header */
+      if( byte_offset + 2 > IRISbuf_p->bytesCopied) break;
       memcpy( &myPeakBytes, (bufIRIS_p+byte_offset), 2);
       if(target_is_big_endian) {
          b1 = myPeakBytes[0];
@@ -1037,7 +1298,7 @@ rayplus_s *extract_rayplus(IRISbuf **IRISbuf_pp,
                              IrisDList_t **sweeplist_pp,
                              sweep_element_s **sweep_list_element_pp,
                              SINT2 current_sweep,
-                             FILE *fp,
+                             IRISfile *fp,
                              _Bool target_is_big_endian ) {
    UINT1 *ptr_s1;
    UINT1 my12bytes[12];
@@ -1205,6 +1466,13 @@ rayplus_s *extract_rayplus(IRISbuf **IRISbuf_pp,
          }
          current_offset = RAW_PROD_BHDR_SIZE;
          ptr_s1 = bufIRIS_p + current_offset;
+         if( rpb_p->sweep_number > current_sweep &&
+             !ingest_data_headers_fit(IRISbuf_p, target_is_big_endian)) {
+            /* the file ends within the headers of a new sweep */
+            out->ray->abandon_buf = 2;
+            out->ray->abandon_ray = 1;
+            return out;
+         }
          /* 
           * if the sweep number (in the raw_prod_bhdr structure) has increased then
           * a new sweep has started and a set of ingest_data_header structure(s)
@@ -1479,6 +1747,13 @@ rayplus_s *extract_rayplus(IRISbuf **IRISbuf_pp,
                }
                current_offset = RAW_PROD_BHDR_SIZE;
                ptr_s1 = bufIRIS_p + current_offset;
+               if( out->new_rpb_p->sweep_number > current_sweep &&
+                   !ingest_data_headers_fit(IRISbuf_p, target_is_big_endian)) {
+                  /* the file ends within the headers of a new sweep */
+                  out->ray->abandon_buf = 2;
+                  out->ray->abandon_ray = 1;
+                  return out;
+               }
                /*
                 * if the sweep number (in the raw_prod_bhdr structure) 
                 * has increased then a new sweep has started and a set 
@@ -3584,21 +3859,148 @@ dsp_data_mask *extract_dsp_data_mask(UINT1 *s1,
   return out;
 }
 
+/*****************************************************************************
+*                                                                            *
+*  ------------------------------ IRISfile_open ---------------------------  *
+*                                                                            *
+*****************************************************************************/
+/* A function to open an IRIS file for reading with getabuf.
+ * The file is memory mapped where the platform supports
+ * it, otherwise it is read into memory in one go.
+ * Returns NULL if the file cannot be opened or read. */
+/* ======================================================================== */
+IRISfile *IRISfile_open(const char *ifile) {
+   IRISfile *out = NULL;
+   FILE *fp = NULL;
+   struct stat st;
+   fp = fopen( ifile, "rb" );
+   if( fp == NULL) return NULL;
+   if( fstat(fileno(fp), &st) != 0 || !S_ISREG(st.st_mode) ) {
+      fclose(fp);
+      return NULL;
+   }
+   out = RAVE_CALLOC( 1, sizeof *out );
+   if( !out ) {
+      Iris_printf(
+          "Error! Unable to allocate 'IRISfile' structure in"
+          " function 'IRISfile_open'.\n");
+      fclose(fp);
+      return NULL;
+   }
+   out->size = (size_t) st.st_size;
+   if( out->size == 0 ) {
+      fclose(fp);
+      return out;
+   }
+#ifndef _WIN32
+   void *map = mmap(NULL, out->size, PROT_READ, MAP_PRIVATE, fileno(fp), 0);
+   if( map != MAP_FAILED ) {
+      out->map = map;
+      out->map_size = out->size;
+      out->data = (UINT1 *) map;
+      fclose(fp);
+      return out;
+   }
+#endif
+   /* no mapping available, read the whole file instead */
+   out->data = RAVE_MALLOC( out->size );
+   if( out->data == NULL || fread(out->data, 1, out->size, fp) != out->size ) {
+      Iris_printf("Error while reading input file.\n");
+      RAVE_FREE(out->data);
+      RAVE_FREE(out);
+      fclose(fp);
+      return NULL;
+   }
+   out->owns_data = 1;
+   fclose(fp);
+   return out;
+}
+
+/*****************************************************************************
+*                                                                            *
+*  --------------------------- IRISfile_from_memory -----------------------  *
+*                                                                            *
+*****************************************************************************/
+/* A function to read an IRIS file with getabuf from a
+ * caller supplied buffer. The buffer is not copied and
+ * must outlive the returned structure. */
+/* ======================================================================== */
+IRISfile *IRISfile_from_memory(const UINT1 *data, size_t size) {
+   IRISfile *out = NULL;
+   out = RAVE_CALLOC( 1, sizeof *out );
+   if( !out ) {
+      Iris_printf(
+          "Error! Unable to allocate 'IRISfile' structure in"
+          " function 'IRISfile_from_memory'.\n");
+      return NULL;
+   }
+   out->data = (UINT1 *) data;
+   out->size = size;
+   return out;
+}
+
+/*****************************************************************************
+*                                                                            *
+*  ------------------------------ IRISfile_sweep --------------------------  *
+*                                                                            *
+*****************************************************************************/
+/* A function to read a single sweep of an IRIS RAW
+ * file: the returned view hands out the two header
+ * records of fp followed by the records [start, end).
+ * The view shares the file image of fp and must be
+ * closed before fp. Returns NULL on allocation failure */
+/* ======================================================================== */
+IRISfile *IRISfile_sweep(IRISfile *fp, size_t start, size_t end) {
+   IRISfile *out = NULL;
+   out = RAVE_CALLOC( 1, sizeof *out );
+   if( !out ) {
+      Iris_printf(
+          "Error! Unable to allocate 'IRISfile' structure in"
+          " function 'IRISfile_sweep'.\n");
+      return NULL;
+   }
+   out->data = fp->data;
+   out->size = (end < fp->size) ? end : fp->size;
+   out->skip_from = 2 * IRIS_BUFFER_SIZE;
+   out->skip_to = start;
+   return out;
+}
+
+/*****************************************************************************
+*                                                                            *
+*  ------------------------------ IRISfile_close --------------------------  *
+*                                                                            *
+*****************************************************************************/
+/* A function to release an IRIS file opened with
+ * IRISfile_open, IRISfile_from_memory or
+ * IRISfile_sweep. Buffers
+ * returned by getabuf point into the file image and
+ * must not be used after this call. */
+/* ======================================================================== */
+void IRISfile_close(IRISfile *fp) {
+   if( fp == NULL ) return;
+#ifndef _WIN32
+   if( fp->map != NULL ) munmap(fp->map, fp->map_size);
+#endif
+   if( fp->owns_data ) RAVE_FREE(fp->data);
+   RAVE_FREE(fp);
+}
+
 /*****************************************************************************
 *                                                                            *
 *  ---------------------------------- getabuf -----------------------------  *
 *                                                                            *
 *****************************************************************************/
-/* A function to transfer bytes from a previously
- * opened input file to a byte array. The byte array
- * is completely filled unless we hit end of file.
- * The byte array itself and the number of bytes
- * transferred are members of a structure that is
- * returned.  This function returns a pointer to the
- * structure and that pointer is NULL if we are unable
- * to allocate the structure  */
+/* A function to hand out the next record of a previously
+ * opened input file. The byte array is a view into the
+ * file image, no bytes are copied. It holds bytes2Copy
+ * bytes unless we hit end of file, in which case errorInd
+ * is set to 2 and bytesCopied holds the bytes remaining.
+ * This function returns a pointer to the structure and
+ * that pointer is NULL if we are unable to allocate the
+ * structure  */
 /* ======================================================================== */
-IRISbuf *getabuf(FILE *fp, UINT2 bytes2Copy ) {
+IRISbuf *getabuf(IRISfile *fp, UINT2 bytes2Copy ) {
    /* allocate an 'IRISbuf' structure and call it 'out' */
    IRISbuf *out;
    out = RAVE_MALLOC( sizeof *out );
@@ -3611,26 +4013,20 @@ IRISbuf *getabuf(FILE *fp, UINT2 bytes2Copy ) {
    out->bytesCopied = 0;
    out->errorInd = 0;
    out->numberSkipped = 0;
-   /* fill the output structure */
-   int b1;
-   for(out->bytesCopied = 0; out->bytesCopied < bytes2Copy;) {
-      if( ( b1 = fgetc(fp) ) == EOF ) { /* Was there an error on reading? */
-         if( feof(fp) ) {
-            out->errorInd = 2;
-            clearerr(fp);  /* clear file's error or EOF flag */
-            return out;
-         }
-         if( ferror(fp) ) {
-            /* tell the client that there was an error reading before eof */
-            Iris_printf("Error while reading input file.\n");
-            out->errorInd = 1;
-            return out;
-         }
-      }
-      /* b1 is an int, so cast it as a signed 1-byte integer */
-      out->bufIRIS[out->bytesCopied] = (UINT1) b1;
-      out->bytesCopied++;
+   if( fp->skip_to > fp->skip_from && fp->pos == fp->skip_from ) {
+      fp->pos = fp->skip_to;
+   }
+   out->bufIRIS = fp->data + fp->pos;
+   /* point the output structure at the next record */
+   size_t remaining = fp->size - fp->pos;
+   if( remaining < bytes2Copy ) {
+      out->bytesCopied = (UINT2) remaining;
+      out->errorInd = 2;
+   }
+   else {
+      out->bytesCopied = bytes2Copy;
    }
+   fp->pos += out->bytesCopied;
    return out;
 }
 
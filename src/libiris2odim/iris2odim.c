@@ -43,11 +43,30 @@ along with RAVE.  If not, see <http://www.gnu.org/licenses/>.
 #include "irisdlist.h"
 #include "rave_alloc.h"
 
+static int setSweepRayAttributes(PolarScan_t* scan, 
+                                 file_element_s* file_element_p,
+                                 cci_s *cci_p,
+                                 int sweep_index,
+                                 int last_sweep,
+                                 ra_s **ra_pp);
+
+static void check_sweep_consistency(cci_s *cci_p,
+                                    size_t mm,
+                                    sweep_element_s *sweep_data_p);
+
 /**
  * print function used by Iris_printf
  */
 static iris_printfun iris_internal_printf_fun = Iris_default_printf;
 
+/**
+ * messages of Iris_printf held back on this thread, see Iris_defer_printf
+ */
+static char** iris_deferred_messages_p = NULL;
+#ifdef _OPENMP
+#pragma omp threadprivate(iris_deferred_messages_p)
+#endif
+
 /**
  * Default printf function.
  */
@@ -92,9 +111,31 @@ void Iris_printf(const char* fmt, ...)
   if (n < 0 || n >= 1024) {
     return;
   }
+  if (iris_deferred_messages_p != NULL) {
+    size_t len = (*iris_deferred_messages_p != NULL) ? strlen(*iris_deferred_messages_p) : 0;
+    char* messages = RAVE_REALLOC(*iris_deferred_messages_p, len + n + 1);
+    if (messages != NULL) {
+      memcpy(messages + len, msgbuff, n + 1);
+      *iris_deferred_messages_p = messages;
+    }
+    return;
+  }
   iris_internal_printf_fun(msgbuff);
 }
 
+void Iris_defer_printf(char** messages_p)
+{
+  iris_deferred_messages_p = messages_p;
+}
+
+void Iris_print_deferred(char** messages_p)
+{
+  if (messages_p != NULL && *messages_p != NULL) {
+    iris_internal_printf_fun(*messages_p);
+    RAVE_FREE(*messages_p);
+  }
+}
+
 /**
  * Sets the print function to where printouts should be done. Default behaviour is to use
  * Iris_default_printf.
@@ -107,6 +148,21 @@ void Iris_set_printf(iris_printfun fun)
   }
 }
 
+/**
+ * Function name: createParamData
+ * Intent: allocate the data array of a parameter so that rays can be decoded
+ * straight into it
+ * Output:
+ * (1) a pointer to the nbins x nrays array owned by param, NULL on failure
+ */
+static void* createParamData(PolarScanParam_t* param, int nbins, int nrays, RaveDataType type) {
+   if(!PolarScanParam_createData(param, nbins, nrays, type)) {
+      Iris_printf("Error allocating %d x %d parameter data array.\n", nrays, nbins);
+      return NULL;
+   }
+   return PolarScanParam_getData(param);
+}
+
 /**
  * Function name: populateParam
  * Intent: A function to transfer info to RAVE objects for eventual output
@@ -173,6 +229,19 @@ int populateParam(PolarScanParam_t* param,
       nbins = (int) this_ray_structure->ray_head.actual_number_of_bins_in_ray;
       if( max_nbins < nbins ) max_nbins = nbins;
    }
+   /* 
+    * do not convert range bins beyond the maximum range requested by the
+    * client, rays are truncated by the ibin < max_nbins loops below
+    */
+   if(file_element_p->max_range_in_m > 0.0) {
+      double step_between_output_bins_in_m = (double)
+         file_element_p->ingest_header_p->tcf.rng.step_between_output_bins_in_cm / 100.0;
+      if(step_between_output_bins_in_m > 0.0) {
+         int range_nbins = (int) ceil(file_element_p->max_range_in_m /
+                                      step_between_output_bins_in_m);
+         if( max_nbins > range_nbins ) max_nbins = range_nbins;
+      }
+   }
    max_nelements = max_nrays * max_nbins;
    /*
     * allocate and partially fill ray attributes structure
@@ -372,8 +441,9 @@ int populateParam(PolarScanParam_t* param,
          break;
       } /*end inner-switch */
 
-      /* assume malloc always succeeds */
-      arr2d_uchar_data = RAVE_MALLOC(max_nelements * sizeof(*arr2d_uchar_data));
+      /* moment data is written straight into the parameter */
+      arr2d_uchar_data = createParamData(param, max_nbins, max_nrays, type);
+      if(arr2d_uchar_data == NULL) break;
       /* fill all array elements with the 'nodata' value to handle missing rays */
       uint8_t nodata_uint8_t = (uint8_t) nodata;
       for(int lv=0; lv < max_nelements; ++lv) {
@@ -496,8 +566,9 @@ int populateParam(PolarScanParam_t* param,
          undetect = 0.0;
          break;
       } /* end inner-switch */
-      /* assume malloc always succeeds */
-      arr2d_ushort_data = RAVE_MALLOC(max_nelements * sizeof(*arr2d_ushort_data));
+      /* moment data is written straight into the parameter */
+      arr2d_ushort_data = createParamData(param, max_nbins, max_nrays, type);
+      if(arr2d_ushort_data == NULL) break;
       /* fill all array elements with the 'nodata' value to handle missing rays */
       uint16_t nodata_uint16_t = (uint16_t) nodata;
       for(int lv=0; lv < max_nelements; ++lv) {
@@ -586,8 +657,9 @@ int populateParam(PolarScanParam_t* param,
          undetect = 32767.0;
          break;
       } /* end of inner-switch */
-      /* assume malloc always succeeds */
-      arr2d_short_data = RAVE_MALLOC(max_nelements * sizeof(*arr2d_short_data));
+      /* moment data is written straight into the parameter */
+      arr2d_short_data = createParamData(param, max_nbins, max_nrays, type);
+      if(arr2d_short_data == NULL) break;
       /* fill all array elements with the 'nodata' value to handle missing rays */
       int16_t nodata_int16_t = (int16_t) nodata;
       for(int lv=0; lv < max_nelements; ++lv) {
@@ -647,8 +719,9 @@ int populateParam(PolarScanParam_t* param,
       offset = -128.0/127.0*nyquist_velocity;
       nodata = 256.0;
       undetect = 0.0;
-      /* assume malloc always succeeds */
-      arr2d_ushort_data = RAVE_MALLOC(max_nelements * sizeof(*arr2d_ushort_data));
+      /* moment data is written straight into the parameter */
+      arr2d_ushort_data = createParamData(param, max_nbins, max_nrays, type);
+      if(arr2d_ushort_data == NULL) break;
       /* fill all array elements with the 'nodata' value to handle missing rays */
       nodata_uint16_t = (uint16_t) nodata;
       for(int lv=0; lv < max_nelements; ++lv) {
@@ -700,8 +773,9 @@ int populateParam(PolarScanParam_t* param,
       offset = 0.0;
       nodata = 256.0;
       undetect = 0.0;
-      /* assume malloc always succeeds */
-      arr2d_ushort_data = RAVE_MALLOC(max_nelements * sizeof(*arr2d_ushort_data));
+      /* moment data is written straight into the parameter */
+      arr2d_ushort_data = createParamData(param, max_nbins, max_nrays, type);
+      if(arr2d_ushort_data == NULL) break;
       /* fill all array elements with the 'nodata' value to handle missing rays */
       nodata_uint16_t = (uint16_t) nodata;
       for(int lv=0; lv < max_nelements; ++lv) {
@@ -753,8 +827,9 @@ int populateParam(PolarScanParam_t* param,
       offset = 0.0;
       nodata = -MY_FILL_DOUBLE;
       undetect = MY_FILL_DOUBLE;
-      /* assume malloc always succeeds ? */
-      arr2d_double_data = RAVE_MALLOC(max_nelements * sizeof(*arr2d_double_data));
+      /* moment data is written straight into the parameter */
+      arr2d_double_data = createParamData(param, max_nbins, max_nrays, type);
+      if(arr2d_double_data == NULL) break;
       /* fill all array elements with the 'nodata' value to handle missing rays */
       for(int lv=0; lv < max_nelements; ++lv) {
          arr2d_double_data[lv] = nodata;
@@ -833,8 +908,9 @@ int populateParam(PolarScanParam_t* param,
       offset = 0.0;
       nodata = -MY_FILL_DOUBLE;
       undetect = MY_FILL_DOUBLE;
-      /* assume malloc always succeeds ? */
-      arr2d_double_data = RAVE_MALLOC(max_nelements * sizeof(*arr2d_double_data));
+      /* moment data is written straight into the parameter */
+      arr2d_double_data = createParamData(param, max_nbins, max_nrays, type);
+      if(arr2d_double_data == NULL) break;
       /* fill all array elements with the 'nodata' value to handle missing rays */
       for(int lv=0; lv < max_nelements; ++lv) {
          arr2d_double_data[lv] = nodata;
@@ -923,33 +999,27 @@ int populateParam(PolarScanParam_t* param,
     */
    PolarScanParam_setUndetect(param, undetect);
    /* 
-    * Set the data in the Toolbox object 
+    * The data was decoded into the Toolbox object itself, 
+    * no copy is needed 
     */
-   ret = PolarScanParam_setData(param, max_nbins, max_nrays, data, type);
+   ret = (data != NULL);
    /* 
-    * deallocate 2D arrays allocated above 
+    * deallocate the row pointers allocated above, 
+    * the data itself belongs to the parameter 
     */
    if(arr2d_uchar != NULL) {
-      RAVE_FREE(arr2d_uchar_data);
-      arr2d_uchar_data = NULL;
       RAVE_FREE(arr2d_uchar);
       arr2d_uchar = NULL;
    }
    else if(arr2d_ushort != NULL) {
-      RAVE_FREE(arr2d_ushort_data);
-      arr2d_ushort_data = NULL;
       RAVE_FREE(arr2d_ushort);
       arr2d_ushort = NULL;
    }
    else if(arr2d_short != NULL) {
-      RAVE_FREE(arr2d_short_data);
-      arr2d_short_data = NULL;
       RAVE_FREE(arr2d_short);
       arr2d_short = NULL;
    }
    else if(arr2d_double != NULL) {
-      RAVE_FREE(arr2d_double_data);
-      arr2d_double_data = NULL;
       RAVE_FREE(arr2d_double);
       arr2d_double = NULL;
    }
@@ -958,28 +1028,23 @@ int populateParam(PolarScanParam_t* param,
 } /* End function populateParam */
 
 /**
- * Function name: polpulateScan
- * Intent: A function to transfer info to RAVE objects for eventual output
- * to an HDF-5 structured output file 
- * Input:
- * (1) a pointer to an empty Toolbox polar scan object
- * (2) a pointer to a structure holding IRIS RAW-file data
- * (3) a signed integer, the scan/sweep that this function call is handling
- * Note! The origin of this sweep index is zero, not 1
- * Output:
- * (1) a signed integer, a function status index where zero means 'no errors'
+ * Function name: populateSweep
+ * Intent: the part of populateScan that fills a scan from a single sweep,
+ * given consistency check arrays that hold this sweep at index 'sweep_index'
+ * and, unless it is the last sweep, the start time of the next sweep at
+ * index 'sweep_index'+1.
  */
-int populateScan(PolarScan_t* scan, 
-                 file_element_s* file_element_p, 
-                 int sweep_index) {
+static int populateSweep(PolarScan_t* scan, 
+                         file_element_s* file_element_p, 
+                         sweep_element_s* sweep_data,
+                         cci_s* cci_p,
+                         int sweep_index,
+                         int last_sweep) {
    char sdate[9];
    char etime[7];
    UINT4 sfm = 0;
    int ret = 0;
    int ncopied = 0;
-   IrisDList_t *sweep_list = NULL;
-   IrisDListElement_t *a_sweep_element = NULL;
-   sweep_element_s *sweep_data = NULL;
    IrisDList_t *types_list = NULL;
    IrisDListElement_t *this_type_element = NULL;
    datatype_element_s* this_type = NULL;
@@ -999,20 +1064,6 @@ int populateScan(PolarScan_t* scan,
     */
    int np;
    RaveCoreObject* object = (RaveCoreObject*)scan;
-   sweep_list = file_element_p->sweep_list_p;
-   int ns = sweep_list->size;
-   size_t n_sweeps_in_volume = (size_t) ns;
-   /* point to the current sweep */
-   for (int jj=0; jj <= sweep_index; jj++) {
-      /* set a pointer to point to the current scan/sweep */
-      if(jj==0) {
-         a_sweep_element = IrisDList_head(sweep_list);
-      }
-      else {
-         a_sweep_element = IrisDListElement_next(a_sweep_element);
-      }
-   }
-   sweep_data = (sweep_element_s *) a_sweep_element->data;
    /* here 'types' refers to moments or scanned-parameters */ 
    types_list = sweep_data->types_list_p;
    np = IrisDList_size(types_list);
@@ -1032,31 +1083,6 @@ int populateScan(PolarScan_t* scan,
     */
    product_generation_ymd_p =
       &(file_element_p->product_header_p->pcf.product_GenTime_UTC);
-   /***********************************************************************
-    *                                                                     *
-    * the function 'create_consistency_check_arrays' allocates            *
-    * both structure and arrays.  Integer arrays are initialised          *
-    * to zero.                                                            *
-    *                                                                     *
-    **********************************************************************/
-   cci_s* cci_p = create_consistency_check_arrays(n_sweeps_in_volume);
-   /***********************************************************************
-    *                                                                     *
-    * Note! The function 'do_consistency_check' returns nothing but       *
-    * does change the contents of variables which are pointed to by       *
-    * members of the cci_s structure pointed to by cci_p                  *
-    * (ie this function has side-effects).                                *
-    *                                                                     *
-    **********************************************************************/
-   do_consistency_check(cci_p, n_sweeps_in_volume, file_element_p);
-   /*
-    * Current contents of cci_s:
-    * 
-    * UINT2 *index_of_first_ray_timewise_p;  [number_of_sweeps]
-    * UINT2 *ray_highest_integral_seconds_p; [number_of_sweeps]
-    * mtv_s *(*sweep_start_times_mtv_p); [MAX_SWEEPS]
-    * 
-    */
    if(cci_p->sweep_start_times_mtv_p[sweep_index] != NULL) {
       my_mtv_p->isdst = cci_p->sweep_start_times_mtv_p[sweep_index]->isdst;
       sweep_start_ymd_p = mtv_to_ymd(cci_p->sweep_start_times_mtv_p[sweep_index]);
@@ -1094,7 +1120,7 @@ int populateScan(PolarScan_t* scan,
         (double) cci_p->sweep_start_times_mtv_p[sweep_index]->tv_usec / 1.0E6;
    }
    double sweep_stop_time = 0.0;
-   if( sweep_index == ns-1) { /* if this is the last sweep */
+   if( last_sweep ) { /* if this is the last sweep */
       /* the product generation time is recorded after the last sweep */
       if(product_generation_ymd_p != NULL) {
          product_generation_mtv_p = ymd_to_mtv(product_generation_ymd_p);
@@ -1248,12 +1274,12 @@ int populateScan(PolarScan_t* scan,
     * Detailed ray readout az and el angles and acquisition times. 
     * Helper function below. 
     */
-   ret = setRayAttributes(scan, 
-                          file_element_p,
-                          cci_p,
-                          sweep_index,
-                          &ra_p);
-   destroy_consistency_check_arrays(cci_p, n_sweeps_in_volume);
+   ret = setSweepRayAttributes(scan, 
+                               file_element_p,
+                               cci_p,
+                               sweep_index,
+                               last_sweep,
+                               &ra_p);
    /* 
     * free all ray attribute related arrays and the ra structure itself
     * if any are non-null
@@ -1268,30 +1294,84 @@ int populateScan(PolarScan_t* scan,
       ra_p = NULL;
    }
    return ret;
-} /* end of populateScan */
+} /* end of populateSweep */
 
 /**
- * Function name: polpulateObject
+ * Function name: polpulateScan
  * Intent: A function to transfer info to RAVE objects for eventual output
  * to an HDF-5 structured output file 
  * Input:
- * (1) a pointer to an empty Toolbox core object (object type to be determined below)
+ * (1) a pointer to an empty Toolbox polar scan object
  * (2) a pointer to a structure holding IRIS RAW-file data
+ * (3) a signed integer, the scan/sweep that this function call is handling
+ * Note! The origin of this sweep index is zero, not 1
  * Output:
  * (1) a signed integer, a function status index where zero means 'no errors'
  */
-int populateObject(RaveCoreObject* object, file_element_s* file_element_p) {
+int populateScan(PolarScan_t* scan, 
+                 file_element_s* file_element_p, 
+                 int sweep_index) {
    int ret = 0;
-   int nscans = 0;
-   int i, ncopied;
    IrisDList_t *sweep_list = NULL;
    IrisDListElement_t *a_sweep_element = NULL;
-   sweep_element_s *this_sweep_data = NULL;
-   IrisDList_t *types_list = NULL;
-   IrisDListElement_t *a_type_element = NULL;
-   datatype_element_s* this_type = NULL;
-   struct ymds_time *sweep_start_ymd_p = NULL;
-   struct ymds_time *product_generation_ymd_p = NULL;
+   sweep_element_s *sweep_data = NULL;
+   sweep_list = file_element_p->sweep_list_p;
+   int ns = sweep_list->size;
+   size_t n_sweeps_in_volume = (size_t) ns;
+   /* point to the current sweep */
+   for (int jj=0; jj <= sweep_index; jj++) {
+      /* set a pointer to point to the current scan/sweep */
+      if(jj==0) {
+         a_sweep_element = IrisDList_head(sweep_list);
+      }
+      else {
+         a_sweep_element = IrisDListElement_next(a_sweep_element);
+      }
+   }
+   sweep_data = (sweep_element_s *) a_sweep_element->data;
+   /***********************************************************************
+    *                                                                     *
+    * the function 'create_consistency_check_arrays' allocates            *
+    * both structure and arrays.  Integer arrays are initialised          *
+    * to zero.                                                            *
+    *                                                                     *
+    **********************************************************************/
+   cci_s* cci_p = create_consistency_check_arrays(n_sweeps_in_volume);
+   /***********************************************************************
+    *                                                                     *
+    * Note! The function 'do_consistency_check' returns nothing but       *
+    * does change the contents of variables which are pointed to by       *
+    * members of the cci_s structure pointed to by cci_p                  *
+    * (ie this function has side-effects).                                *
+    *                                                                     *
+    **********************************************************************/
+   do_consistency_check(cci_p, n_sweeps_in_volume, file_element_p);
+   /*
+    * Current contents of cci_s:
+    * 
+    * UINT2 *index_of_first_ray_timewise_p;  [number_of_sweeps]
+    * UINT2 *ray_highest_integral_seconds_p; [number_of_sweeps]
+    * mtv_s *(*sweep_start_times_mtv_p); [MAX_SWEEPS]
+    * 
+    */
+   ret = populateSweep(scan, file_element_p, sweep_data, cci_p, 
+                       sweep_index, sweep_index == ns-1);
+   destroy_consistency_check_arrays(cci_p, n_sweeps_in_volume);
+   return ret;
+} /* end of populateScan */
+
+/**
+ * Function name: populateObjectAttributes
+ * Intent: the part of populateObject that sets the top level what, where and
+ * how attributes, with the nominal time rounded from 'nominal_ymd_p'
+ * Output:
+ * (1) a signed integer, a function status index where zero means 'no errors'
+ */
+static int populateObjectAttributes(RaveCoreObject* object,
+                                    file_element_s* file_element_p,
+                                    ymd_s* nominal_ymd_p) {
+   int ret = 0;
+   int ncopied;
    int last_day[12] = {31,28,30,30,31,28,31,31,30,31,30,31};
    char *source;
    /* here to prepare the radar 'source' (ie the radar site name)
@@ -1337,30 +1417,10 @@ int populateObject(RaveCoreObject* object, file_element_s* file_element_p) {
    double time_in_seconds = 0.0;
    double time_in_minutes = 0.0;
    double nominal_time_in_minutes;
-   sweep_list = file_element_p->sweep_list_p;
-   nscans = sweep_list->size;
-   if(RAVE_OBJECT_CHECK_TYPE(object, &PolarVolume_TYPE)) {
-      /* the product generation time is recorded after the last sweep */
-      product_generation_ymd_p =
-         &(file_element_p->product_header_p->pcf.product_GenTime_UTC);
-      time_in_seconds = (double) 
-         product_generation_ymd_p->seconds_since_midnight;
-      yearz = (int) product_generation_ymd_p->year;
-      monthz = (int) product_generation_ymd_p->month;
-      dayz = (int) product_generation_ymd_p->day;
-   }
-   else if(RAVE_OBJECT_CHECK_TYPE(object, &PolarScan_TYPE)) {
-      a_sweep_element = sweep_list->head;
-      this_sweep_data =  (sweep_element_s *) a_sweep_element->data;
-      types_list = this_sweep_data->types_list_p;;
-      a_type_element = types_list->head;
-      this_type = (datatype_element_s *) a_type_element->data;
-      sweep_start_ymd_p = &(this_type->ingest_data_header_p->sweep_start_time);
-      time_in_seconds = (double) sweep_start_ymd_p->seconds_since_midnight;
-      yearz = (int) sweep_start_ymd_p->year;
-      monthz = (int) sweep_start_ymd_p->month;
-      dayz = (int) sweep_start_ymd_p->day;
-   }
+   time_in_seconds = (double) nominal_ymd_p->seconds_since_midnight;
+   yearz = (int) nominal_ymd_p->year;
+   monthz = (int) nominal_ymd_p->month;
+   dayz = (int) nominal_ymd_p->day;
    
    time_in_minutes = time_in_seconds / 60.0;
    nominal_time_in_minutes = round(time_in_minutes/10.)*10.;
@@ -1698,6 +1758,49 @@ int populateObject(RaveCoreObject* object, file_element_s* file_element_p) {
    double transmitP = (double) file_element_p->ingest_header_p->
         tcf.misc.transmit_power_in_watts;
    ret = addDoubleAttribute(object, "how/avgpwr", transmitP);
+   return ret;
+} /* end function populateObjectAttributes */
+
+/**
+ * Function name: polpulateObject
+ * Intent: A function to transfer info to RAVE objects for eventual output
+ * to an HDF-5 structured output file 
+ * Input:
+ * (1) a pointer to an empty Toolbox core object (object type to be determined below)
+ * (2) a pointer to a structure holding IRIS RAW-file data
+ * Output:
+ * (1) a signed integer, a function status index where zero means 'no errors'
+ */
+int populateObject(RaveCoreObject* object, file_element_s* file_element_p) {
+   int ret = 0;
+   int nscans = 0;
+   int i;
+   IrisDList_t *sweep_list = NULL;
+   IrisDListElement_t *a_sweep_element = NULL;
+   sweep_element_s *this_sweep_data = NULL;
+   IrisDList_t *types_list = NULL;
+   IrisDListElement_t *a_type_element = NULL;
+   datatype_element_s* this_type = NULL;
+   struct ymds_time *nominal_ymd_p = NULL;
+   sweep_list = file_element_p->sweep_list_p;
+   nscans = sweep_list->size;
+   if(RAVE_OBJECT_CHECK_TYPE(object, &PolarVolume_TYPE)) {
+      /* the product generation time is recorded after the last sweep */
+      nominal_ymd_p =
+         &(file_element_p->product_header_p->pcf.product_GenTime_UTC);
+   }
+   else if(RAVE_OBJECT_CHECK_TYPE(object, &PolarScan_TYPE)) {
+      a_sweep_element = sweep_list->head;
+      this_sweep_data =  (sweep_element_s *) a_sweep_element->data;
+      types_list = this_sweep_data->types_list_p;;
+      a_type_element = types_list->head;
+      this_type = (datatype_element_s *) a_type_element->data;
+      nominal_ymd_p = &(this_type->ingest_data_header_p->sweep_start_time);
+   }
+   else {
+      return -1;
+   }
+   ret = populateObjectAttributes(object, file_element_p, nominal_ymd_p);
    int sweep_ind = 0;
    if(nscans > 1) {
       /* Populate each scan of a PVOL */
@@ -1741,26 +1844,13 @@ int populateObject(RaveCoreObject* object, file_element_s* file_element_p) {
 } /* end function populateObject */
 
 /**
- * Function name: readIRIS
- * Intent: This function alocates a structure that will hold all data from 
- * an input file. First it allocates the structure itself (which contains
- * pointers only), then allocates the structures corresponding to each pointer
- * in the main structure.  Then the top level structure allocated in this 
- * function and the file to be read are passed to a function that reads the 
- * input file and fills the top level structure.  The top level structure
- * is then passed back to the calling program.
- * 
- * Input:
- * (1) a pointer to a string of characters holding the input file name to read
- * Output:
- * (1) a pointer to a structure that holds the contents of an input file
+ * Function name: new_IRIS
+ * Intent: allocates an empty file element structure with its product header,
+ * ingest header and (empty) sweep list, ready to be filled by iris2list.
+ * Returns NULL when an allocation fails.
  */
-file_element_s* readIRIS(const char* ifile) {
-   int ret = -1;
+file_element_s* new_IRIS(void) {
    file_element_s* file_element_p = NULL;
-   if (!is_regular_file(ifile)) {
-     return NULL;
-   }
    /*****************************************************************************
     *                                                                           *
     * allocate space for a file element structure, the file space pointed to by *
@@ -1776,6 +1866,9 @@ file_element_s* readIRIS(const char* ifile) {
    file_element_p->product_header_p = NULL;
    file_element_p->ingest_header_p = NULL;
    file_element_p->sweep_list_p = NULL;
+   file_element_p->max_range_in_m = 0.0;
+   file_element_p->sweep_done = NULL;
+   file_element_p->sweep_done_arg = NULL;
    /*****************************************************************************
     *                                                                           *
     * allocate space for a file product_header structure inside the             *
@@ -1814,6 +1907,32 @@ file_element_s* readIRIS(const char* ifile) {
       free_IRIS(&file_element_p);
       return NULL;
    }
+   return file_element_p;
+} /* end Function new_IRIS */
+
+/**
+ * Function name: readIRIS
+ * Intent: This function alocates a structure that will hold all data from 
+ * an input file. First it allocates the structure itself (which contains
+ * pointers only), then allocates the structures corresponding to each pointer
+ * in the main structure.  Then the top level structure allocated in this 
+ * function and the file to be read are passed to a function that reads the 
+ * input file and fills the top level structure.  The top level structure
+ * is then passed back to the calling program.
+ * 
+ * Input:
+ * (1) a pointer to a string of characters holding the input file name to read
+ * Output:
+ * (1) a pointer to a structure that holds the contents of an input file
+ */
+file_element_s* readIRIS(const char* ifile) {
+   int ret = -1;
+   file_element_s* file_element_p = NULL;
+   if (!is_regular_file(ifile)) {
+     return NULL;
+   }
+   file_element_p = new_IRIS();
+   if(file_element_p == NULL) return NULL;
 
    /*****************************************************************************
     * Read IRIS file and put all file contents into a doubly-linked list        *
@@ -1828,6 +1947,134 @@ file_element_s* readIRIS(const char* ifile) {
    else return NULL;
 } /* end Function readIRIS */
 
+/* state shared by readIRISVolume and its sweep_done callback */
+typedef struct {
+   PolarVolume_t* volume;  /* volume being filled */
+   int nscans;             /* scans added to the volume so far */
+   int failed;             /* set when a sweep could not be converted */
+   ymd_s first_sweep_start;/* start time of the first sweep */
+} iris_volume_reader_s;
+
+/**
+ * Function name: readIRISVolumeSweep
+ * Intent: sweep_done callback of readIRISVolume. Converts one complete sweep
+ * into a polar scan and adds it to the volume. The top-level attributes are
+ * set before the first scan is added, so that the scans inherit the volume's
+ * source, date and time like they do in populateObject.
+ */
+static void readIRISVolumeSweep(file_element_s* file_element_p,
+                                sweep_element_s* sweep,
+                                sweep_element_s* next,
+                                void* arg) {
+   iris_volume_reader_s* reader = (iris_volume_reader_s*) arg;
+   datatype_element_s* this_type = NULL;
+   PolarScan_t* scan = NULL;
+   cci_s* cci_p = NULL;
+   mtv_s* next_start_mtv_p = NULL;
+   int have_next = 0;
+   int ret = 0;
+   if(reader->failed) return;
+   if(sweep->types_list_p == NULL || IrisDList_size(sweep->types_list_p) == 0) {
+      Iris_printf("Skipping IRIS sweep without data types.\n");
+      return;
+   }
+   if(reader->nscans == 0) {
+      this_type = (datatype_element_s*) IrisDList_head(sweep->types_list_p)->data;
+      reader->first_sweep_start = this_type->ingest_data_header_p->sweep_start_time;
+      /* the product generation time is recorded after the last sweep */
+      populateObjectAttributes((RaveCoreObject*) reader->volume, file_element_p,
+         &(file_element_p->product_header_p->pcf.product_GenTime_UTC));
+   }
+   /* 
+    * consistency information of this sweep, and the start time of
+    * the next one which is used to estimate the end time of this sweep
+    */
+   cci_p = create_consistency_check_arrays(2);
+   if(cci_p == NULL) {
+      reader->failed = 1;
+      return;
+   }
+   check_sweep_consistency(cci_p, 0, sweep);
+   if(next != NULL && next->types_list_p != NULL &&
+      IrisDList_size(next->types_list_p) > 0) {
+      this_type = (datatype_element_s*) IrisDList_head(next->types_list_p)->data;
+      next_start_mtv_p = ymd_to_mtv(&this_type->ingest_data_header_p->sweep_start_time);
+      if(next_start_mtv_p != NULL) {
+         cci_p->sweep_start_times_mtv_p[1]->tv_sec = next_start_mtv_p->tv_sec;
+         cci_p->sweep_start_times_mtv_p[1]->tv_usec = next_start_mtv_p->tv_usec;
+         cci_p->sweep_start_times_mtv_p[1]->isdst = next_start_mtv_p->isdst;
+         RAVE_FREE(next_start_mtv_p);
+         have_next = 1;
+      }
+   }
+   scan = RAVE_OBJECT_NEW(&PolarScan_TYPE);
+   if(scan == NULL) {
+      Iris_printf("Error allocating a polar scan.\n");
+      reader->failed = 1;
+   }
+   else {
+      ret = populateSweep(scan, file_element_p, sweep, cci_p, 0, !have_next);
+      if(ret != 0 || !PolarVolume_addScan(reader->volume, scan)) {
+         reader->failed = 1;
+      }
+      else {
+         reader->nscans++;
+      }
+   }
+   RAVE_OBJECT_RELEASE(scan);
+   destroy_consistency_check_arrays(cci_p, 2);
+} /* end function readIRISVolumeSweep */
+
+/**
+ * Function name: readIRISVolume
+ * Intent: reads an IRIS RAW file directly into a polar volume. Each sweep is
+ * handed to readIRISVolumeSweep as soon as it is complete and is freed after
+ * conversion, so the ray lists of at most a sweep or two are held at once.
+ * A file with a single sweep gets the nominal time of its sweep start, as 
+ * populateObject does for a scan.
+ */
+PolarVolume_t* readIRISVolume(const char* ifile, double max_range_in_m) {
+   PolarVolume_t* result = NULL;
+   PolarScan_t* scan = NULL;
+   file_element_s* file_element_p = NULL;
+   iris_volume_reader_s reader;
+   if (!is_regular_file(ifile)) {
+     return NULL;
+   }
+   reader.volume = RAVE_OBJECT_NEW(&PolarVolume_TYPE);
+   reader.nscans = 0;
+   reader.failed = 0;
+   if(reader.volume == NULL) {
+      Iris_printf("Error allocating a polar volume.\n");
+      return NULL;
+   }
+   file_element_p = new_IRIS();
+   if(file_element_p == NULL) goto done;
+   file_element_p->max_range_in_m = max_range_in_m;
+   file_element_p->sweep_done = readIRISVolumeSweep;
+   file_element_p->sweep_done_arg = &reader;
+
+   /* iris2list frees the file element when it fails */
+   if(iris2list(ifile, &file_element_p) != 0) goto done;
+   if(reader.failed || reader.nscans == 0) goto done;
+
+   if(reader.nscans == 1) {
+      populateObjectAttributes((RaveCoreObject*) reader.volume, file_element_p,
+                               &reader.first_sweep_start);
+      scan = PolarVolume_getScan(reader.volume, 0);
+      if(scan != NULL) {
+         PolarScan_setDate(scan, PolarVolume_getDate(reader.volume));
+         PolarScan_setTime(scan, PolarVolume_getTime(reader.volume));
+      }
+      RAVE_OBJECT_RELEASE(scan);
+   }
+   result = RAVE_OBJECT_COPY(reader.volume);
+done:
+   free_IRIS(&file_element_p);
+   RAVE_OBJECT_RELEASE(reader.volume);
+   return result;
+} /* end Function readIRISVolume */
+
 /**
  * Function name: objectTypeFromIRIS
  * Intent: Based on number of scans in the payload, return the corresponding RAVE ObjectType enum
@@ -2186,6 +2433,36 @@ x: if(*file_element_pp != NULL) {
    return;
 } /* end function free_IRIS */
 
+/**
+ * Function name: free_IRIS_sweep
+ * Intent: frees a single sweep that is not (or no longer) part of a sweep list,
+ * including its ingest data headers and rays
+ */
+void free_IRIS_sweep(sweep_element_s **sweep_pp) {
+   IrisDList_t *types_list = NULL;
+   datatype_element_s *this_type = NULL;
+   if(*sweep_pp == NULL) return;
+   types_list = (*sweep_pp)->types_list_p;
+   if(types_list != NULL) {
+      while(IrisDList_size(types_list) > 0) {
+         this_type = (datatype_element_s *) IrisDList_removeFront(types_list);
+         if(this_type == NULL) continue;
+         RAVE_FREE(this_type->ingest_data_header_p);
+         if(this_type->ray_list_p != NULL) {
+            while(IrisDList_size(this_type->ray_list_p) > 0) {
+               ray_s *ray_structure_p =
+                  (ray_s *) IrisDList_removeFront(this_type->ray_list_p);
+               RAVE_FREE(ray_structure_p);
+            }
+            RAVE_FREE(this_type->ray_list_p);
+         }
+         RAVE_FREE(this_type);
+      }
+      RAVE_FREE(types_list);
+   }
+   RAVE_FREE(*sweep_pp);
+} /* end function free_IRIS_sweep */
+
 /**
  * Function name: is_regular_file
  * Intent: determines whether the given path is to a regular file
@@ -2248,9 +2525,24 @@ int setRayAttributes(PolarScan_t* scan,
                      cci_s *cci_p,
                      int sweep_index,
                      ra_s **ra_pp) {
-   ra_s *ra_p = *ra_pp;
    IrisDList_t *sweep_list = file_element_p->sweep_list_p;
    int n_sweeps_in_volume = IrisDList_size(sweep_list);
+   return setSweepRayAttributes(scan, file_element_p, cci_p, sweep_index,
+                                sweep_index == n_sweeps_in_volume-1, ra_pp);
+}
+
+/**
+ * Function name: setSweepRayAttributes
+ * Intent: as setRayAttributes, with the last sweep of the volume flagged by
+ * the caller instead of derived from the sweep list
+ */
+static int setSweepRayAttributes(PolarScan_t* scan, 
+                                 file_element_s* file_element_p,
+                                 cci_s *cci_p,
+                                 int sweep_index,
+                                 int last_sweep,
+                                 ra_s **ra_pp) {
+   ra_s *ra_p = *ra_pp;
    long max_nrays = ra_p->expected_nrays;
    double istartazT, istopazT;
    /* fill the ray start and stop times */
@@ -2270,7 +2562,7 @@ int setRayAttributes(PolarScan_t* scan,
     * OR if there use no next sweep
     * set the stop time to the product generation time
     */
-   if( sweep_index == n_sweeps_in_volume-1) {
+   if( last_sweep ) {
       /* the product generation time is recorded after the last sweep */
       ymd_s *product_generation_ymd_p =
               &(file_element_p->product_header_p->pcf.product_GenTime_UTC);
@@ -2921,6 +3213,96 @@ mtv_s *ymd_to_mtv( ymd_s *ymd_p ) {
    return mtv_p;
 }
 
+/**
+ * Function name: check_sweep_consistency
+ * Intent: the part of 'do_consistency_check' that handles a single sweep,
+ * fills element 'mm' of the arrays of the cci structure from the rays of 
+ * that sweep.
+ */
+static void check_sweep_consistency(cci_s *cci_p,
+                                    size_t mm,
+                                    sweep_element_s *sweep_data_p) {
+   IrisDList_t *ray_list = NULL;
+   IrisDListElement_t *datatype_element = NULL;
+   IrisDListElement_t *this_ray_element = NULL;
+   datatype_element_s *datatype_current = NULL;
+   ray_s *this_ray_structure = NULL;
+   ymd_s *sweep_start_ymd_p = NULL;
+   UINT2 rays_in_this_sweep = 0;
+   mtv_s *dummy_mtv_p = NULL;
+   IrisDList_t *types_list = NULL;
+   types_list = sweep_data_p->types_list_p;
+   /* 
+    * point to the first data-type structure in the datatype list
+    * for this sweep 
+    */
+   datatype_element = IrisDList_head(types_list);
+   datatype_current = (datatype_element_s *) datatype_element->data;
+   ray_list = datatype_current->ray_list_p;
+
+   rays_in_this_sweep = (UINT2) IrisDList_size(ray_list);
+   /* sfs is seconds-from-start   (of current sweep) */
+   UINT2 sfs_this_ray = 0;
+   UINT2 sfs_last_ray = 0;
+   /*
+    * when seconds from start is zero at k=0
+    * then ray_highest_integral_seconds[mm]
+    * never gets assigned in the loop below
+    * so  index_of_first_ray_timewise[mm] = 0
+    * is correct
+    */
+   cci_p->index_of_first_ray_timewise_p[mm] = 0;
+   /*
+    * ray_highest_integral_seconds[mm] is just
+    * the maximum value of sfs_this_ray encountered
+    * in this sweep
+    */
+   cci_p->ray_highest_integral_seconds_p[mm] = 0;    
+   /* loop through the rays in this sweep */
+   for(UINT2 k = 0; k < rays_in_this_sweep; k++) {
+      if( k == 0) {
+         this_ray_element = IrisDList_head(ray_list);
+      }
+      else {
+         this_ray_element = IrisDListElement_next(this_ray_element);
+      }
+
+      this_ray_structure = (ray_s *) this_ray_element->data;
+      if( k > 0 ) {
+         sfs_last_ray = sfs_this_ray;
+      }
+      sfs_this_ray = this_ray_structure->
+         ray_head.time_in_seconds_from_start_of_sweep;
+      if(sfs_this_ray == 0) {
+         if(sfs_last_ray > 0) {
+            cci_p->index_of_first_ray_timewise_p[mm]=k;
+         }
+      }
+      else {
+         if(sfs_this_ray > cci_p->ray_highest_integral_seconds_p[mm]) {
+            cci_p->ray_highest_integral_seconds_p[mm] = sfs_this_ray;
+         }
+      }  
+   } /* end-for-loop rays */
+   /*
+    * save pointers to mtv structures that hold sweep start times
+    * Note! Each mtv structure is allocated inside the 'ymd_to_mtv'
+    * function and a pointer to the structure is returned by the
+    * function.
+    */
+   sweep_start_ymd_p =
+      &datatype_current->ingest_data_header_p->sweep_start_time;
+   dummy_mtv_p = ymd_to_mtv(sweep_start_ymd_p);
+   /* copy the structure content */
+   if(dummy_mtv_p != NULL) {
+      cci_p->sweep_start_times_mtv_p[mm]->tv_sec = dummy_mtv_p->tv_sec;
+      cci_p->sweep_start_times_mtv_p[mm]->tv_usec = dummy_mtv_p->tv_usec;
+      cci_p->sweep_start_times_mtv_p[mm]->isdst = dummy_mtv_p->isdst;
+      RAVE_FREE(dummy_mtv_p);
+   }
+   return;
+} /* end function check_sweep_consistency */
+
 /**
  * Function name: do_consistency_check
  * Intent: A function to check that the number of moments and rays received 
@@ -2939,16 +3321,7 @@ mtv_s *ymd_to_mtv( ymd_s *ymd_p ) {
 void do_consistency_check(cci_s *cci_p, // <-- structure to fill
                           size_t nsweeps,
                           file_element_s *file_element_p) {
-   IrisDList_t *ray_list = NULL;
-   IrisDListElement_t *datatype_element = NULL;
-   IrisDListElement_t *this_ray_element = NULL;
-   datatype_element_s *datatype_current = NULL;
-   ray_s *this_ray_structure = NULL;
-   ymd_s *sweep_start_ymd_p = NULL;
-   UINT2 rays_in_this_sweep = 0;
-   mtv_s *dummy_mtv_p = NULL;
    IrisDListElement_t *this_sweep_element = NULL;
-   IrisDList_t *types_list = NULL;
    IrisDList_t *sweep_list = file_element_p->sweep_list_p;
    sweep_element_s *sweep_data_p = NULL;
    /* 
@@ -2962,75 +3335,7 @@ void do_consistency_check(cci_s *cci_p, // <-- structure to fill
          this_sweep_element = IrisDListElement_next(this_sweep_element);
       }
       sweep_data_p = (sweep_element_s *) this_sweep_element->data;
-      types_list = sweep_data_p->types_list_p;
-      /* 
-       * point to the first data-type structure in the datatype list
-       * for this sweep 
-       */
-      datatype_element = IrisDList_head(types_list);
-      datatype_current = (datatype_element_s *) datatype_element->data;
-      ray_list = datatype_current->ray_list_p;
-
-      rays_in_this_sweep = (UINT2) IrisDList_size(ray_list);
-      /* sfs is seconds-from-start   (of current sweep) */
-      UINT2 sfs_this_ray = 0;
-      UINT2 sfs_last_ray = 0;
-      /*
-       * when seconds from start is zero at k=0
-       * then ray_highest_integral_seconds[mm]
-       * never gets assigned in the loop below
-       * so  index_of_first_ray_timewise[mm] = 0
-       * is correct
-       */
-      cci_p->index_of_first_ray_timewise_p[mm] = 0;
-      /*
-       * ray_highest_integral_seconds[mm] is just
-       * the maximum value of sfs_this_ray encountered
-       * in this sweep
-       */
-      cci_p->ray_highest_integral_seconds_p[mm] = 0;    
-      /* loop through the rays in this sweep */
-      for(UINT2 k = 0; k < rays_in_this_sweep; k++) {
-         if( k == 0) {
-            this_ray_element = IrisDList_head(ray_list);
-         }
-         else {
-            this_ray_element = IrisDListElement_next(this_ray_element);
-         }
-
-         this_ray_structure = (ray_s *) this_ray_element->data;
-         if( k > 0 ) {
-            sfs_last_ray = sfs_this_ray;
-         }
-         sfs_this_ray = this_ray_structure->
-            ray_head.time_in_seconds_from_start_of_sweep;
-         if(sfs_this_ray == 0) {
-            if(sfs_last_ray > 0) {
-               cci_p->index_of_first_ray_timewise_p[mm]=k;
-            }
-         }
-         else {
-            if(sfs_this_ray > cci_p->ray_highest_integral_seconds_p[mm]) {
-               cci_p->ray_highest_integral_seconds_p[mm] = sfs_this_ray;
-            }
-         }  
-      } /* end-for-loop rays */
-      /*
-       * save pointers to mtv structures that hold sweep start times
-       * Note! Each mtv structure is allocated inside the 'ymd_to_mtv'
-       * function and a pointer to the structure is returned by the
-       * function.
-       */
-      sweep_start_ymd_p =
-         &datatype_current->ingest_data_header_p->sweep_start_time;
-      dummy_mtv_p = ymd_to_mtv(sweep_start_ymd_p);
-      /* copy the structure content */
-      if(dummy_mtv_p != NULL) {
-         cci_p->sweep_start_times_mtv_p[mm]->tv_sec = dummy_mtv_p->tv_sec;
-         cci_p->sweep_start_times_mtv_p[mm]->tv_usec = dummy_mtv_p->tv_usec;
-         cci_p->sweep_start_times_mtv_p[mm]->isdst = dummy_mtv_p->isdst;
-         RAVE_FREE(dummy_mtv_p);
-      }
+      check_sweep_consistency(cci_p, mm, sweep_data_p);
    } /* end for-loop sweeps */
    return;
 } /* end function do_consistency_check */
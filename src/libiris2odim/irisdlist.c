@@ -87,3 +87,23 @@ IrisDListElement_t* IrisDList_addEnd(IrisDList_t* list, void* data)
   }
   return el;
 }
+
+void* IrisDList_removeFront(IrisDList_t* list)
+{
+  IrisDListElement_t* el = NULL;
+  void* data = NULL;
+  RAVE_ASSERT((list != NULL), "list == NULL");
+  el = list->head;
+  if (el != NULL) {
+    data = el->data;
+    list->head = el->next;
+    if (list->head == NULL) {
+      list->tail = NULL;
+    } else {
+      list->head->prev = NULL;
+    }
+    list->size--;
+    RAVE_FREE(el);
+  }
+  return data;
+}
@@ -10,6 +10,8 @@ extern "C" {
 #include "polarvolume.h"
 #include "hlhdf.h"
 #include "libvol2bird/libvol2bird.h"
+#include "libvol2bird/libcatalog.h"
+#include "libvol2bird/librender.h"
 }
 namespace vol2birdR {
 namespace librave {
@@ -412,8 +412,8 @@ int RaveData2D_setValueUnchecked(RaveData2D_t* self, long x, long y, double v)
     float *a = (float *) self->data;
     if (v > FLT_MAX)
       v = FLT_MAX;
-    if (v < FLT_MIN)
-      v = FLT_MIN;
+    if (v < -FLT_MAX)
+      v = -FLT_MAX;
     a[y * self->xsize + x] = v;
     break;
   }
@@ -31,6 +31,72 @@
 #include <stdlib.h>
 #include "rsl.h"
 void rsl_readflush(FILE *fp);
+/* Number of leading bytes read when probing a file. Large enough to
+ * hold a gzip header with file name and comment plus the first
+ * deflate block that covers the magic bytes.
+ */
+#define RSL_PROBE_SIZE 4096
+
+static enum File_type RSL_filetype_from_magic(const char *magic)
+{
+  if (strncmp("ARCHIVE2.", magic, 9) == 0) return WSR88D_FILE;
+  if (strncmp("AR2V000", magic, 7) == 0) return WSR88D_FILE;
+  if (strncmp("UF", magic, 2) == 0) return UF_FILE;
+  if (strncmp("UF", &magic[2], 2) == 0) return UF_FILE;
+  if (strncmp("UF", &magic[4], 2) == 0) return UF_FILE;
+  if ((int)magic[0] == 0x0e &&
+	  (int)magic[1] == 0x03 &&
+	  (int)magic[2] == 0x13 &&
+	  (int)magic[3] == 0x01
+	  ) return HDF_FILE;
+  if (strncmp("RSL", magic, 3) == 0) return RSL_FILE;
+  if ((int)magic[0] == 7) return NSIG_FILE_V1;
+  if ((int)magic[1] == 7) return NSIG_FILE_V1;
+  if ((int)magic[0] == 27) return NSIG_FILE_V2;
+  if ((int)magic[1] == 27) return NSIG_FILE_V2;
+  if (strncmp("/IMAGE:", magic, 7) == 0) return RAPIC_FILE;
+  if ((int)magic[0] == 0x40 &&
+	  (int)magic[1] == 0x01
+	  ) return RADTEC_FILE;
+  if ((int)magic[0] == 0x01 && magic[1] == 'H') return RAINBOW_FILE;
+
+  if (strncmp("SUNRISE", &magic[4], 7) == 0) return LASSEN_FILE;
+/* The 'P A B' is just too specific to be a true magic number, but that's all
+ * I've got.
+ */
+  if (strncmp("P A B ", magic, 6) == 0) return MCGILL_FILE;
+  /* Byte swapped ? */
+  if (strncmp(" P A B", magic, 6) == 0) return MCGILL_FILE;
+  if (strncmp("SSWB", magic, 4) == 0) return DORADE_FILE;
+  if (strncmp("VOLD", magic, 4) == 0) return DORADE_FILE;
+
+  return UNKNOWN;
+}
+
+/*********************************************************************/
+/*                                                                   */
+/*                   RSL_filetype_from_buffer                        */
+/*                                                                   */
+/*********************************************************************/
+enum File_type RSL_filetype_from_buffer(const unsigned char *buf, size_t len)
+{
+  /* Classify a file from its leading bytes, as read from disk.
+   * gzip compressed input is inflated just far enough to see the
+   * magic bytes of the payload.
+   */
+  char magic[11];
+
+  if (len >= 2 && buf[0] == 0x1f && buf[1] == 0x8b) {
+	if (rsl_gunzip_peek(buf, len, (unsigned char *)magic, sizeof(magic)) != sizeof(magic))
+	  return UNKNOWN;
+	return RSL_filetype_from_magic(magic);
+  }
+
+  if (len < sizeof(magic)) return UNKNOWN;
+  memcpy(magic, buf, sizeof(magic));
+  return RSL_filetype_from_magic(magic);
+}
+
 /*********************************************************************/
 /*                                                                   */
 /*                   RSL_filetype                                    */
@@ -57,95 +123,45 @@ enum File_type RSL_filetype(char *infile)
    * RAINBOW - First two bytes: decimal 1, followed by 'H'
    */
   FILE *fp;
-  char magic[11];
+  unsigned char buf[RSL_PROBE_SIZE];
+  size_t len;
 
   if ((fp = fopen(infile, "rb")) == NULL) {
     perror(infile);
     return UNKNOWN;
   }
 
-  /* Read the magic bytes. */
-  fp = uncompress_pipe(fp); /* If gzip available. */
-  if (fread(magic, sizeof(magic), 1, fp) != 1) {
-	char *magic_str = (char *)calloc(sizeof(magic)+1, sizeof(char));
-	memcpy(magic_str, magic, sizeof(magic));
-	RSL_printf("Error fread: Magic is %s\n", magic_str);
-	free (magic_str);
-	perror("RSL_filetype");
-        /* Thanks to Thiago Biscaro for fixing defunct process problem. */
-        rsl_pclose(fp);
+  len = fread(buf, 1, sizeof(buf), fp);
+  fclose(fp);
+
+  if (len < 11) {
+	RSL_printf("Error fread: file %s is too short to determine its type\n", infile);
 	return UNKNOWN;
   }
 
-  /*
-  Closes the stream and wait for associated processes to terminate
-  (just like wait() ) to avoid defunct processes. The old rsl_readflush
-  function wasn't doing this, N calls to anyformat_to_radar would
-  generate N defunct processes associated with the main program
-  --Thiago Biscaro
-  */
-
-  rsl_pclose(fp);
-  
-  if (strncmp("ARCHIVE2.", magic, 9) == 0) return WSR88D_FILE;
-  if (strncmp("AR2V000", magic, 7) == 0) return WSR88D_FILE;
-  if (strncmp("UF", magic, 2) == 0) return UF_FILE;
-  if (strncmp("UF", &magic[2], 2) == 0) return UF_FILE;
-  if (strncmp("UF", &magic[4], 2) == 0) return UF_FILE;
-  if ((int)magic[0] == 0x0e &&
-	  (int)magic[1] == 0x03 &&
-	  (int)magic[2] == 0x13 &&
-	  (int)magic[3] == 0x01
-	  ) return HDF_FILE;
-  if (strncmp("RSL", magic, 3) == 0) return RSL_FILE;
-  if ((int)magic[0] == 7) return NSIG_FILE_V1;
-  if ((int)magic[1] == 7) return NSIG_FILE_V1;
-  if ((int)magic[0] == 27) return NSIG_FILE_V2;
-  if ((int)magic[1] == 27) return NSIG_FILE_V2;
-  if (strncmp("/IMAGE:", magic, 7) == 0) return RAPIC_FILE;
-  if ((int)magic[0] == 0x40 &&
-	  (int)magic[1] == 0x01
-	  ) return RADTEC_FILE;
-  if ((int)magic[0] == 0x01 && magic[1] == 'H') return RAINBOW_FILE;
-
-  if (strncmp("SUNRISE", &magic[4], 7) == 0) return LASSEN_FILE;
-/* The 'P A B' is just too specific to be a true magic number, but that's all
- * I've got.
- */
-  if (strncmp("P A B ", magic, 6) == 0) return MCGILL_FILE;
-  /* Byte swapped ? */
-  if (strncmp(" P A B", magic, 6) == 0) return MCGILL_FILE;
-  if (strncmp("SSWB", magic, 4) == 0) return DORADE_FILE;
-  if (strncmp("VOLD", magic, 4) == 0) return DORADE_FILE;
-
-  return UNKNOWN;
+  return RSL_filetype_from_buffer(buf, len);
 }
 
 /*********************************************************************/
 /*                                                                   */
-/*                   RSL_anyformat_to_radar                          */
+/*                   RSL_filetype_to_radar                           */
 /*                                                                   */
 /*********************************************************************/
 
-Radar *RSL_anyformat_to_radar(char *infile, ...)
+Radar *RSL_filetype_to_radar(enum File_type type, char *infile,
+                             char *callid_or_file, RSL_sweep_filter *filter)
 {
-  va_list ap;
-  char *callid_or_file;
+/* Read 'infile' with the reader for 'type', as previously determined
+ * by RSL_filetype or RSL_filetype_from_buffer. This avoids probing the
+ * file a second time when the caller already knows its type.
+ * The sweep 'filter' (may be NULL) is honored by the WSR88D reader only.
+ */
   Radar *radar;
 
-/* If it is detected that the input file is WSR88D, use the second argument
- * as the call id of the site, or the file name of the tape header file.
- *
- * Assumption: Input files are seekable.
- */
   radar = NULL;
-  switch (RSL_filetype(infile)) {
+  switch (type) {
   case WSR88D_FILE:
-	callid_or_file = NULL;
-	va_start(ap, infile);
-	callid_or_file = va_arg(ap, char *);
-	va_end(ap);
-	radar = RSL_wsr88d_to_radar(infile, callid_or_file);
+	radar = RSL_wsr88d_to_radar_filtered(infile, callid_or_file, filter);
 	break;
   case      UF_FILE: radar = RSL_uf_to_radar(infile);     break;
 #ifdef NOT_USED
@@ -170,4 +186,29 @@ Radar *RSL_anyformat_to_radar(char *infile, ...)
   return radar;
 }
 
+/*********************************************************************/
+/*                                                                   */
+/*                   RSL_anyformat_to_radar                          */
+/*                                                                   */
+/*********************************************************************/
 
+Radar *RSL_anyformat_to_radar(char *infile, ...)
+{
+  va_list ap;
+  char *callid_or_file;
+  enum File_type type;
+
+/* If it is detected that the input file is WSR88D, use the second argument
+ * as the call id of the site, or the file name of the tape header file.
+ *
+ * Assumption: Input files are seekable.
+ */
+  callid_or_file = NULL;
+  type = RSL_filetype(infile);
+  if (type == WSR88D_FILE) {
+	va_start(ap, infile);
+	callid_or_file = va_arg(ap, char *);
+	va_end(ap);
+  }
+  return RSL_filetype_to_radar(type, infile, callid_or_file, NULL);
+}
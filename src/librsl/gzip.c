@@ -20,6 +20,9 @@
     License along with this library; if not, write to the Free
     Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
 */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* fopencookie */
+#endif
 #include <stdio.h>
 #include <unistd.h>
 #include <stdlib.h>
@@ -35,6 +38,9 @@
 
 #define CHUNK 16384
 
+/* Input chunk size of the in-memory decompression */
+#define INFLATE_CHUNK 262144
+
 /* Instead of fprintf */
 void RSL_printf(const char* fmt, ...);
 
@@ -127,12 +133,234 @@ int no_command (char *cmd)
   else return !0;
 }
 
+/* Inflate at most 'outlen' leading bytes of the gzip stream held in 'in'.
+ * Used to peek at the magic bytes of a compressed file without
+ * decompressing all of it. Returns the number of bytes produced,
+ * 0 when 'in' is not gzip data or cannot be inflated.
+ */
+size_t rsl_gunzip_peek(const unsigned char *in, size_t inlen,
+                       unsigned char *out, size_t outlen)
+{
+  z_stream strm;
+  size_t produced;
+  int ret;
+
+  if (inlen < 2 || in[0] != 0x1f || in[1] != 0x8b) return 0;
+
+  memset(&strm, 0, sizeof(strm));
+  if (inflateInit2(&strm, 15+16) != Z_OK) return 0;
+
+  strm.next_in = (Bytef *)in;
+  strm.avail_in = (uInt)inlen;
+  strm.next_out = out;
+  strm.avail_out = (uInt)outlen;
+  ret = inflate(&strm, Z_SYNC_FLUSH);
+  produced = outlen - strm.avail_out;
+  inflateEnd(&strm);
+
+  if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) return 0;
+  return produced;
+}
+
 #ifdef NO_UNZIP_PIPE
-FILE *uncompress_pipe (FILE *fp)
+/*
+ * In-memory gunzip. The inflated data is kept in a memory buffer that is
+ * read through a FILE* facade, so that gzip'd files do not need a round
+ * trip through a temporary file. Where the platform has no way of wrapping
+ * a memory buffer in a FILE*, the buffer is written to a temporary file.
+ */
+typedef struct {
+  unsigned char *data;
+  size_t size;
+  size_t pos;
+} rsl_membuf;
+
+#if defined(__GLIBC__) || defined(__APPLE__) || defined(__FreeBSD__)
+#define RSL_HAVE_MEMBUF_FILE
+#endif
+
+#ifdef RSL_HAVE_MEMBUF_FILE
+static int rsl_membuf_seekpos(rsl_membuf *buf, long long offset, int whence)
+{
+  long long pos;
+  switch (whence) {
+  case SEEK_SET: pos = offset; break;
+  case SEEK_CUR: pos = (long long)buf->pos + offset; break;
+  case SEEK_END: pos = (long long)buf->size + offset; break;
+  default: return -1;
+  }
+  if (pos < 0 || pos > (long long)buf->size) return -1;
+  buf->pos = (size_t)pos;
+  return 0;
+}
+
+static size_t rsl_membuf_readbytes(rsl_membuf *buf, char *out, size_t n)
+{
+  if (n > buf->size - buf->pos) n = buf->size - buf->pos;
+  memcpy(out, buf->data + buf->pos, n);
+  buf->pos += n;
+  return n;
+}
+
+static int rsl_membuf_close(void *cookie)
+{
+  rsl_membuf *buf = (rsl_membuf *)cookie;
+  free(buf->data);
+  free(buf);
+  return 0;
+}
+
+#ifdef __GLIBC__
+static ssize_t rsl_membuf_read(void *cookie, char *out, size_t n)
+{
+  return (ssize_t)rsl_membuf_readbytes((rsl_membuf *)cookie, out, n);
+}
+
+static int rsl_membuf_seek(void *cookie, off64_t *offset, int whence)
+{
+  rsl_membuf *buf = (rsl_membuf *)cookie;
+  if (rsl_membuf_seekpos(buf, (long long)*offset, whence) != 0) return -1;
+  *offset = (off64_t)buf->pos;
+  return 0;
+}
+#else
+static int rsl_membuf_read(void *cookie, char *out, int n)
+{
+  return (int)rsl_membuf_readbytes((rsl_membuf *)cookie, out, (size_t)n);
+}
+
+static fpos_t rsl_membuf_seek(void *cookie, fpos_t offset, int whence)
+{
+  rsl_membuf *buf = (rsl_membuf *)cookie;
+  if (rsl_membuf_seekpos(buf, (long long)offset, whence) != 0) return -1;
+  return (fpos_t)buf->pos;
+}
+#endif
+
+/* Wraps buf in a read-only stream. On success the stream owns buf. */
+static FILE *rsl_membuf_fopen(rsl_membuf *buf)
+{
+#ifdef __GLIBC__
+  cookie_io_functions_t funcs;
+  funcs.read = rsl_membuf_read;
+  funcs.write = NULL;
+  funcs.seek = rsl_membuf_seek;
+  funcs.close = rsl_membuf_close;
+  return fopencookie(buf, "rb", funcs);
+#else
+  return funopen(buf, rsl_membuf_read, NULL, rsl_membuf_seek, rsl_membuf_close);
+#endif
+}
+#endif
+
+/*
+ * Inflates the gzip stream fp into buf->data. The output buffer is sized
+ * from the uncompressed size stored in the gzip trailer, and grows
+ * geometrically when that estimate is too small (e.g. for multi-member
+ * files or files larger than 4 GB). Returns 1 on success, 0 on failure.
+ */
+static int rsl_gunzip_to_membuf(FILE *fp, rsl_membuf *buf)
 {
-  FILE *retfp = NULL, *result = NULL;
+  z_stream strm;
+  unsigned char *in = NULL;
+  size_t capacity = 0;
+  long insize;
+  int ret = Z_OK;
+  int eof = 0;
+  int pending = 1;
+  int result = 0;
+
+  buf->data = NULL;
+  buf->size = 0;
+  buf->pos = 0;
+
+  /* The last four bytes of a gzip file hold the uncompressed size modulo 2^32 */
+  if (fseek(fp, -4, SEEK_END) == 0) {
+    unsigned char isize[4];
+    insize = ftell(fp) + 4;
+    if (fread(isize, 1, 4, fp) == 4) {
+      capacity = (size_t)isize[0] | ((size_t)isize[1] << 8) |
+                 ((size_t)isize[2] << 16) | ((size_t)isize[3] << 24);
+    }
+    if (capacity < (size_t)insize) capacity = 4 * (size_t)insize;
+  }
+  if (capacity == 0) capacity = 4 * INFLATE_CHUNK;
+  if (fseek(fp, 0, SEEK_SET) != 0) return 0;
+
+  in = (unsigned char *)malloc(INFLATE_CHUNK);
+  buf->data = (unsigned char *)malloc(capacity);
+  if (in == NULL || buf->data == NULL) {
+    RSL_printf("Couldn't allocate buffer for gzip decompression\n");
+    goto done;
+  }
+
+  memset(&strm, 0, sizeof(strm));
+  /* 15+32: zlib window size with automatic gzip/zlib header detection */
+  if (inflateInit2(&strm, 15 + 32) != Z_OK) {
+    goto done;
+  }
+
+  for (;;) {
+    if (strm.avail_in == 0 && !eof) {
+      strm.avail_in = (uInt)fread(in, 1, INFLATE_CHUNK, fp);
+      strm.next_in = in;
+      if (strm.avail_in == 0) eof = 1;
+    }
+    if (ret == Z_STREAM_END) {
+      /* concatenated gzip members are decompressed as one stream,
+       * anything else trailing the first member is ignored */
+      if (strm.avail_in == 0 || strm.next_in[0] != 0x1f || inflateReset(&strm) != Z_OK) break;
+      ret = Z_OK;
+    } else if (eof && !pending) {
+      /* input exhausted and inflate had room to spare: nothing left to flush */
+      break;
+    }
+    if (buf->size == capacity) {
+      unsigned char *data = (unsigned char *)realloc(buf->data, 2 * capacity);
+      if (data == NULL) {
+        RSL_printf("Couldn't allocate buffer for gzip decompression\n");
+        inflateEnd(&strm);
+        goto done;
+      }
+      buf->data = data;
+      capacity *= 2;
+    }
+    strm.next_out = buf->data + buf->size;
+    strm.avail_out = (uInt)((capacity - buf->size) > INFLATE_CHUNK * 64 ? INFLATE_CHUNK * 64 : capacity - buf->size);
+    uInt avail_out = strm.avail_out;
+    ret = inflate(&strm, Z_NO_FLUSH);
+    buf->size += avail_out - strm.avail_out;
+    /* a full output buffer may leave output pending without new input */
+    pending = strm.avail_out == 0;
+    if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+      RSL_printf("gzip decompression error - %d\n", ret);
+      inflateEnd(&strm);
+      goto done;
+    }
+  }
+  inflateEnd(&strm);
+  if (ret != Z_STREAM_END) {
+    RSL_printf("gzip data truncated or corrupt\n");
+    goto done;
+  }
+  result = 1;
+
+done:
+  free(in);
+  if (!result) {
+    free(buf->data);
+    buf->data = NULL;
+    buf->size = 0;
+  }
+  return result;
+}
+
+/* Streams fp through zlib into a temporary file. Also used for input
+ * that is not seekable. */
+static FILE *uncompress_to_temporary_file (FILE *fp)
+{
+  FILE *retfp = NULL;
   char buffer[CHUNK];
-  int totallen = 0;
   gzFile gzfp = gzdopen(dup(fileno(fp)), "r");
 
   if (gzfp == Z_NULL) {
@@ -151,21 +379,60 @@ FILE *uncompress_pipe (FILE *fp)
     int len = gzread(gzfp, buffer, sizeof(buffer));
     if (len <= 0)
       break;
-    totallen += len;
     fwrite(buffer, 1, len, retfp);
   }
 
   fseek(retfp, 0, SEEK_SET);
-  result = retfp;
-  retfp = NULL;
+  fclose(fp);
+  gzclose(gzfp);
+  return retfp;
+}
 
-done:
+FILE *uncompress_pipe (FILE *fp)
+{
+  FILE *retfp = NULL;
+  unsigned char magic[2];
+  rsl_membuf *buf = NULL;
+
+  if (ftell(fp) < 0) {
+    return uncompress_to_temporary_file(fp);
+  }
+
+  /* Files that are not gzip'd are read directly */
+  if (fread(magic, 1, 2, fp) != 2 || magic[0] != 0x1f || magic[1] != 0x8b) {
+    fseek(fp, 0, SEEK_SET);
+    return fp;
+  }
+
+  buf = (rsl_membuf *)calloc(1, sizeof(rsl_membuf));
+  if (buf == NULL || !rsl_gunzip_to_membuf(fp, buf)) {
+    free(buf);
+    fseek(fp, 0, SEEK_SET);
+    return uncompress_to_temporary_file(fp);
+  }
+
+#ifdef RSL_HAVE_MEMBUF_FILE
+  retfp = rsl_membuf_fopen(buf);
   if (retfp != NULL) {
-    fclose(retfp);
+    fclose(fp);
+    return retfp;
   }
+#endif
+
+  retfp = create_temporary_file();
+  if (retfp == NULL) {
+    RSL_printf("Couldn't create temporary file\n");
+    free(buf->data);
+    free(buf);
+    fseek(fp, 0, SEEK_SET);
+    return fp;
+  }
+  fwrite(buf->data, 1, buf->size, retfp);
+  fseek(retfp, 0, SEEK_SET);
+  free(buf->data);
+  free(buf);
   fclose(fp);
-  gzclose(gzfp);
-  return result;
+  return retfp;
 }
 #else
 FILE *uncompress_pipe (FILE *fp)
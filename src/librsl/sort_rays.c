@@ -109,6 +109,12 @@ static int sweep_sort_compare(Sweep **s1, Sweep **s2)
 
    if ((*s1)->h.elev < (*s2)->h.elev) return -1;
    if ((*s1)->h.elev > (*s2)->h.elev) return 1;
+
+   /* Sweeps repeating an elevation (e.g. WSR-88D SAILS) stay in scan order,
+    * so that they keep the same index in every volume.
+    */
+   if ((*s1)->h.sweep_num < (*s2)->h.sweep_num) return -1;
+   if ((*s1)->h.sweep_num > (*s2)->h.sweep_num) return 1;
    return 0;
    }
 
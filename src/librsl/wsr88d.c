@@ -69,6 +69,9 @@
 #include <fcntl.h>
 #include <sys/types.h>
 #include <bzlib.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include "wsr88d.h"
 void RSL_printf(const char* fmt, ...);
@@ -229,23 +232,112 @@ void wsr88d_print_sweep_info(Wsr88d_sweep *s)
   }
 }
 
+/* Compressed LDM records of an AR2V file. Records are independent
+ * bzip2 streams, so a batch of them is read sequentially and then
+ * decompressed concurrently. Output is written in record order.
+ */
+typedef struct {
+  char *block;          /* compressed record */
+  int length;           /* length of compressed record */
+  int isize;            /* allocated size of block */
+  char *oblock;         /* decompressed record */
+  unsigned int osize;   /* allocated size of oblock */
+  unsigned int olength; /* length of decompressed record */
+  int error;            /* bzip2 error code */
+} Ar2v_record;
+
+#define AR2V_RECORDS_PER_THREAD 4
+
+static int decompressAr2vRecord(Ar2v_record *rec)
+{
+  int error;
+
+  if (rec->oblock == NULL) {
+    rec->osize = 262144;
+    if ((rec->oblock = (char*) malloc(rec->osize)) == NULL) {
+      return BZ_MEM_ERROR;
+    }
+  }
+  for (;;) {
+    rec->olength = rec->osize;
+#ifdef BZ_CONFIG_ERROR
+    error = BZ2_bzBuffToBuffDecompress(rec->oblock, &rec->olength, rec->block, rec->length, 0, 0);
+#else
+    error = bzBuffToBuffDecompress(rec->oblock, &rec->olength, rec->block, rec->length, 0, 0);
+#endif
+    if (error != BZ_OUTBUFF_FULL) {
+      return error;
+    }
+    rec->osize += 262144;
+    char *oblock = (char*) realloc(rec->oblock, rec->osize);
+    if (oblock == NULL) {
+      return BZ_MEM_ERROR;
+    }
+    rec->oblock = oblock;
+  }
+}
+
+/* Decompresses nrec records in parallel and writes them in order to fdout.
+ * Returns 1 on success, 0 on failure. */
+static int flushAr2vRecords(Ar2v_record *recs, int nrec, int fdout)
+{
+  int i;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+  for (i = 0; i < nrec; i++) {
+    recs[i].error = decompressAr2vRecord(&recs[i]);
+  }
+
+  /* Error reporting is done here rather than in the parallel region above,
+   * since RSL_printf may call back into R. */
+  for (i = 0; i < nrec; i++) {
+    if (recs[i].error != BZ_OK) {
+      if (recs[i].error == BZ_MEM_ERROR) {
+        RSL_printf("Cannot allocate output buffer\n");
+      } else {
+        RSL_printf("decompress error - %d\n", recs[i].error);
+      }
+      return 0;
+    }
+    if (write(fdout, recs[i].oblock, recs[i].olength) != recs[i].olength) {
+      RSL_printf("Failed to write outblock\n");
+      return 0;
+    }
+  }
+  return 1;
+}
+
 int uncompressAr2v(FILE* fpin, FILE* fpout) {
   char clength[4];
-  char *block = (char*) malloc(8192), *oblock = (char*) malloc(262144);
-  unsigned isize = 8192, osize = 262144, olength;
+  char header[24];
   char stid[5] = { 0 }; /* station id: not used */
   int fdin = fileno(fpin);
   int fdout = fileno(fpout);
   int result = 0;
+  int nthreads = 1;
+  int maxrec, nrec = 0, i;
+  Ar2v_record *recs = NULL;
+
+#ifdef _OPENMP
+  nthreads = omp_get_max_threads();
+#endif
+  maxrec = nthreads * AR2V_RECORDS_PER_THREAD;
+  recs = (Ar2v_record*) calloc(maxrec, sizeof(Ar2v_record));
+  if (recs == NULL) {
+    RSL_printf("Cannot allocate record index\n");
+    return 0;
+  }
 
   /*
-   * Loop through the blocks
+   * Loop through the blocks, collecting batches of compressed records
    */
   int go = 1;
   while (go) {
-    ssize_t i = read(fdin, clength, 4);
-    if (i != 4) {
-      if (i > 0) {
+    ssize_t n = read(fdin, clength, 4);
+    if (n != 4) {
+      if (n > 0) {
         RSL_printf("RSL: Short block length\n");
       } else {
         RSL_printf("RSL: Can't read file identifier string\n");
@@ -258,16 +350,16 @@ int uncompressAr2v(FILE* fpin, FILE* fpout) {
      * header and continue
      */
     if ((memcmp(clength, "ARCH", 4) == 0) || (memcmp(clength, "AR2V", 4) == 0)) {
-      memcpy(block, clength, 4);
-      i = read(fdin, block + 4, 20);
-      if (i != 20) {
+      memcpy(header, clength, 4);
+      n = read(fdin, header + 4, 20);
+      if (n != 20) {
         RSL_printf("Missing header\n");
         goto done;
       }
       if (stid[0] != 0)
-        memcpy(block + 20, stid, 4);
+        memcpy(header + 20, stid, 4);
       lseek(fdout, 0, SEEK_SET);
-      if (write(fdout, block, 24) != 24) {
+      if (write(fdout, header, 24) != 24) {
         // Failure to write...
         RSL_printf( "Failed to write block\n");
         goto done;
@@ -287,62 +379,44 @@ int uncompressAr2v(FILE* fpin, FILE* fpout) {
       go = 0;
     }
 
-    if (length > isize) {
-      isize = length;
-      if ((block = (char*) realloc(block, isize)) == NULL) {
+    Ar2v_record *rec = &recs[nrec];
+    if (length > rec->isize || rec->block == NULL) {
+      char *block = (char*) realloc(rec->block, length > 0 ? length : 1);
+      if (block == NULL) {
         RSL_printf("Cannot re-allocate input buffer\n");
         goto done;
       }
+      rec->block = block;
+      rec->isize = length;
     }
+    rec->length = length;
 
-    /*
-     * Read, uncompress, and write
-     */
-
-    i = read(fdin, block, length);
-    if (i != length) {
+    n = read(fdin, rec->block, length);
+    if (n != length) {
       RSL_printf("Short block read!\n");
       goto done;
     }
 
+    /* very short records contain no compressed data */
     if (length > 10) {
-      int error;
-tryagain:
-      olength = osize;
-#ifdef BZ_CONFIG_ERROR
-      error = BZ2_bzBuffToBuffDecompress(oblock, &olength, block, length, 0, 0);
-#else
-    error = bzBuffToBuffDecompress(oblock, &olength,block, length, 0, 0);
-#endif
+      nrec++;
+    }
 
-      if (error) {
-        if (error == BZ_OUTBUFF_FULL) {
-          osize += 262144;
-          if ((oblock = (char*) realloc(oblock, osize)) == NULL) {
-            RSL_printf( "Cannot allocate output buffer\n");
-            goto done;
-          }
-          goto tryagain;
-        }
-
-        RSL_printf( "decompress error - %d\n", error);
-        goto done;
-      }
-      if (write(fdout, oblock, olength) != olength) {
-        RSL_printf( "Failed to write outblock\n");
+    if (nrec == maxrec || (!go && nrec > 0)) {
+      if (!flushAr2vRecords(recs, nrec, fdout)) {
         goto done;
       }
+      nrec = 0;
     }
   }
 
   result = 1;
 done:
-  if (oblock != NULL) {
-    free(oblock);
-  }
-  if (block != NULL) {
-    free(block);
+  for (i = 0; i < maxrec; i++) {
+    free(recs[i].block);
+    free(recs[i].oblock);
   }
+  free(recs);
   return result;
 }
 
@@ -435,13 +509,13 @@ Wsr88d_file *wsr88d_open(char *filename)
   // test for bzip2 magic.
   if (strncmp("BZ",bzmagic,2) == 0) ar2v6bzip = 1;
 
-  fclose(wf->fptr);
-
-  // reopen the file
+  // rewind to the start of the file; stdin cannot seek, so reopen it
   if ( strcmp(filename, "stdin") == 0 ) {
+     fclose(wf->fptr);
      save_fd = dup(0);
      wf->fptr = fdopen(save_fd,"rb");
-  } else {
+  } else if (fsetpos(wf->fptr, &pos) != 0) {
+     fclose(wf->fptr);
      wf->fptr = fopen(filename, "rb");
   }
 
@@ -33,6 +33,13 @@
 #include "rsl.h"
 #include "wsr88d.h"
 #include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <bzlib.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 /* Data descriptions in the following data structures are from the "Interface
  * Control Document for the RDA/RPG", Build 10.0 Draft, WSR-88D Radar
@@ -100,7 +107,9 @@ typedef struct {
     Ray_header_m31 ray_hdr;
     float unamb_rng;
     float nyq_vel;
-    unsigned char data[MAX_RADIAL_LENGTH];
+    unsigned char *data; /* Data header block and data moments, either read
+			    into a buffer or in place in a mapped file. */
+    int data_size;       /* Number of valid bytes at data. */
 } Wsr88d_ray_m31;
 
 
@@ -240,6 +249,15 @@ void wsr88d_get_vcp_data(short *msgtype5)
 }
 
 
+static int wsr88d_is_rrad_block(Wsr88d_ray_m31 *wsr88d_ray, unsigned int dindex)
+{
+    /* The radial data constant block holds at least 18 bytes. */
+    if (dindex > (unsigned int) wsr88d_ray->data_size ||
+	    wsr88d_ray->data_size - dindex < 18) return 0;
+    return strncmp((char *) &wsr88d_ray->data[dindex], "RRAD", 4) == 0;
+}
+
+
 void get_wsr88d_unamb_and_nyq_vel(Wsr88d_ray_m31 *wsr88d_ray, float *unamb_rng,
 	float *nyq_vel)
 {
@@ -248,14 +266,14 @@ void get_wsr88d_unamb_and_nyq_vel(Wsr88d_ray_m31 *wsr88d_ray, float *unamb_rng,
 
     found = 0;
     dindex = wsr88d_ray->ray_hdr.radial_const;
-    if (strncmp((char *) &wsr88d_ray->data[dindex], "RRAD", 4) == 0) found = 1;
+    if (wsr88d_is_rrad_block(wsr88d_ray, dindex)) found = 1;
     else {
 	dindex = wsr88d_ray->ray_hdr.elev_const;
-	if (strncmp((char *) &wsr88d_ray->data[dindex], "RRAD", 4) == 0)
+	if (wsr88d_is_rrad_block(wsr88d_ray, dindex))
 	    found = 1;
 	else {
 	    dindex = wsr88d_ray->ray_hdr.vol_const;
-	    if (strncmp((char *) &wsr88d_ray->data[dindex], "RRAD", 4) == 0)
+	    if (wsr88d_is_rrad_block(wsr88d_ray, dindex))
 		found = 1;
 	}
     }
@@ -275,25 +293,77 @@ void get_wsr88d_unamb_and_nyq_vel(Wsr88d_ray_m31 *wsr88d_ray, float *unamb_rng,
 }
 
 
-int read_wsr88d_ray_m31(Wsr88d_file *wf, int msg_size,
+int read_wsr88d_ray_hdr_m31(Wsr88d_file *wf, int msg_size,
 	Wsr88d_ray_m31 *wsr88d_ray)
 {
     int n;
-    float nyq_vel, unamb_rng;
 
-    /* Read wsr88d ray. */
+    /* Read only the data header block of the wsr88d ray, so that the
+     * radial can still be skipped before its data moments are read.
+     */
 
-    n = fread(wsr88d_ray->data, msg_size, 1, wf->fptr);
+    if (msg_size < (int) sizeof(Ray_header_m31)) {
+	RSL_printf("read_wsr88d_ray_hdr_m31: Invalid message size %d.\n", msg_size);
+	return 0;
+    }
+    n = fread(wsr88d_ray->data, sizeof(Ray_header_m31), 1, wf->fptr);
     if (n < 1) {
-	RSL_printf("read_wsr88d_ray_m31: Read failed.\n");
+	RSL_printf("read_wsr88d_ray_hdr_m31: Read failed.\n");
 	return 0;
     }
 
     /* Copy data header block to ray header structure. */
-    memcpy(&wsr88d_ray->ray_hdr, &wsr88d_ray->data, sizeof(Ray_header_m31));
+    memcpy(&wsr88d_ray->ray_hdr, wsr88d_ray->data, sizeof(Ray_header_m31));
 
     if (little_endian()) wsr88d_swap_m31_ray_hdr(&wsr88d_ray->ray_hdr);
 
+    return 1;
+}
+
+
+int skip_wsr88d_ray_m31(Wsr88d_file *wf, int msg_size,
+	Wsr88d_ray_m31 *wsr88d_ray)
+{
+    /* Skip the data moments following the data header block. */
+
+    long remainder = msg_size - sizeof(Ray_header_m31);
+
+    if (remainder == 0) return 1;
+    if (fseek(wf->fptr, remainder, SEEK_CUR) == 0) return 1;
+    /* Not seekable, read and discard instead. */
+    if (fread(&wsr88d_ray->data[sizeof(Ray_header_m31)], remainder, 1,
+		wf->fptr) < 1) {
+	RSL_printf("skip_wsr88d_ray_m31: Read failed.\n");
+	return 0;
+    }
+    return 1;
+}
+
+
+int read_wsr88d_ray_m31(Wsr88d_file *wf, int msg_size,
+	Wsr88d_ray_m31 *wsr88d_ray)
+{
+    int n;
+    float nyq_vel, unamb_rng;
+
+    /* Read the remainder of the wsr88d ray, after its header block was
+     * read by read_wsr88d_ray_hdr_m31.
+     */
+
+    if (msg_size > MAX_RADIAL_LENGTH) {
+	RSL_printf("read_wsr88d_ray_m31: Invalid message size %d.\n", msg_size);
+	return 0;
+    }
+    if (msg_size > (int) sizeof(Ray_header_m31)) {
+	n = fread(&wsr88d_ray->data[sizeof(Ray_header_m31)],
+		msg_size - sizeof(Ray_header_m31), 1, wf->fptr);
+	if (n < 1) {
+	    RSL_printf("read_wsr88d_ray_m31: Read failed.\n");
+	    return 0;
+	}
+    }
+    wsr88d_ray->data_size = msg_size;
+
     /* Retrieve unambiguous range and Nyquist velocity here so that we don't
      * have to do it for each data moment later.
      */
@@ -316,6 +386,10 @@ void wsr88d_load_ray_hdr(Wsr88d_ray_m31 *wsr88d_ray, Ray *ray)
     m1_ray.ray_date = ray_hdr.ray_date;
     m1_ray.ray_time = ray_hdr.ray_time;
 
+    /* wsr88d_get_date uses gmtime, which is not reentrant. */
+#ifdef _OPENMP
+#pragma omp critical(wsr88d_m31_static)
+#endif
     wsr88d_get_date(&m1_ray, &month, &day, &year);
     wsr88d_get_time(&m1_ray, &hour, &minute, &sec, &fsec);
     ray->h.year = year + 1900;
@@ -346,8 +420,14 @@ void wsr88d_load_ray_hdr(Wsr88d_ray_m31 *wsr88d_ray, Ray *ray)
     m1_ray.nyq_vel = (short) wsr88d_ray->nyq_vel;
     /* Get values from message type 1 routines. */
     ray->h.frequency = wsr88d_get_frequency(&m1_ray);
-    ray->h.pulse_width = wsr88d_get_pulse_width(&m1_ray);
-    ray->h.pulse_count = wsr88d_get_pulse_count(&m1_ray);
+    /* These return values from the static array of wsr88d_get_vcp_info. */
+#ifdef _OPENMP
+#pragma omp critical(wsr88d_m31_static)
+#endif
+    {
+	ray->h.pulse_width = wsr88d_get_pulse_width(&m1_ray);
+	ray->h.pulse_count = wsr88d_get_pulse_count(&m1_ray);
+    }
     ray->h.prf = (int) wsr88d_get_prf(&m1_ray);
     ray->h.wavelength = 0.1071;
 }
@@ -370,10 +450,14 @@ int wsr88d_get_vol_index(char* dataname)
 #define MAXRAYS_M31 800
 #define MAXSWEEPS 30
 
-void wsr88d_load_ray_into_radar(Wsr88d_ray_m31 *wsr88d_ray, int isweep,
-	Radar *radar)
+int wsr88d_load_ray_into_radar(Wsr88d_ray_m31 *wsr88d_ray, int isweep,
+	Radar *radar, RSL_sweep_filter *filter)
 {
-    /* Load data into ray structure for each data field. */
+    /* Load data into ray structure for each data field.  Returns 0 when a
+     * data block is unknown or lies outside the radial, 1 otherwise.  Rays
+     * of different sweeps may be loaded concurrently, so nothing is printed
+     * here.
+     */
 
     int data_index;
     int *field_offset;
@@ -382,7 +466,7 @@ void wsr88d_load_ray_into_radar(Wsr88d_ray_m31 *wsr88d_ray, int isweep,
     const short nconstblocks = 3;
 
     Data_moment_hdr data_hdr;
-    int ngates, do_swap;
+    int ngates, do_swap, avail_gates;
     int i, hdr_size;
     unsigned short item;
     float value, scale, offset;
@@ -390,6 +474,7 @@ void wsr88d_load_ray_into_radar(Wsr88d_ray_m31 *wsr88d_ray, int isweep,
     Range (*invf)(float x) = DZ_INVF;
     float (*f)(Range x) = DZ_F;
     Ray *ray;
+    Sweep *sweep;
     int vol_index, waveform;
 
     extern int rsl_qfield[]; /* See RSL_select_fields in volume.c */
@@ -411,17 +496,14 @@ void wsr88d_load_ray_into_radar(Wsr88d_ray_m31 *wsr88d_ray, int isweep,
 	data_index = *field_offset;
 	/* Get data moment header. */
 	hdr_size = sizeof(data_hdr);
+	if (data_index < 0 || data_index > wsr88d_ray->data_size - hdr_size)
+	    return 0;
 	memcpy(&data_hdr, &wsr88d_ray->data[data_index], hdr_size);
 	if (do_swap) wsr88d_swap_data_hdr(&data_hdr);
 	data_index += hdr_size;
 
 	vol_index = wsr88d_get_vol_index(data_hdr.dataname);
-	if (vol_index < 0) {
-	    RSL_printf("wsr88d_load_ray_into_radar: Unknown dataname %s.  "
-		    "isweep = %d, iray = %d.\n", data_hdr.dataname, isweep,
-		    iray);
-	    return;
-	}
+	if (vol_index < 0) return 0;
 
 	/* Is this field in the selected fields list? */
 	if (!rsl_qfield[vol_index]) continue;
@@ -450,7 +532,13 @@ void wsr88d_load_ray_into_radar(Wsr88d_ray_m31 *wsr88d_ray, int isweep,
 		    merging_split_cuts))
 	    continue;
 
-	/* Load the data for this field. */
+	/* Load the data for this field.  Volumes are shared between the
+	 * sweeps, and RSL_new_sweep registers the sweep in a global list.
+	 */
+#ifdef _OPENMP
+#pragma omp critical(wsr88d_m31_alloc)
+#endif
+	{
 	if (radar->v[vol_index] == NULL) {
 	    radar->v[vol_index] = RSL_new_volume(MAXSWEEPS);
 	    radar->v[vol_index]->h.f = f;
@@ -489,7 +577,21 @@ void wsr88d_load_ray_into_radar(Wsr88d_ray_m31 *wsr88d_ray, int isweep,
 	    radar->v[vol_index]->sweep[isweep]->h.f = f;
 	    radar->v[vol_index]->sweep[isweep]->h.invf = invf;
 	}
+	sweep = radar->v[vol_index]->sweep[isweep];
+	}
 	ngates = data_hdr.ngates;
+	/* Do not read past the end of the radial. */
+	avail_gates = wsr88d_ray->data_size - data_index;
+	if (data_hdr.datasize_bits == 16) avail_gates /= 2;
+	if (ngates > avail_gates) ngates = avail_gates;
+	/* Do not decode gates beyond the maximum range of the filter. */
+	if (filter != NULL && filter->max_range > 0 &&
+		data_hdr.range_samp_interval > 0) {
+	    int range_gates = (int) ceil((filter->max_range -
+		    data_hdr.range_first_gate) / data_hdr.range_samp_interval) + 1;
+	    if (range_gates < 1) range_gates = 1;
+	    if (ngates > range_gates) ngates = range_gates;
+	}
 	ray = RSL_new_ray(ngates);
 
 	/* Convert data to float, then use range function to store in ray.
@@ -521,9 +623,10 @@ void wsr88d_load_ray_into_radar(Wsr88d_ray_m31 *wsr88d_ray, int isweep,
 	ray->h.range_bin1 = data_hdr.range_first_gate;
 	ray->h.gate_size = data_hdr.range_samp_interval;
 	ray->h.nbins = ngates;
-	radar->v[vol_index]->sweep[isweep]->ray[iray] = ray;
-	radar->v[vol_index]->sweep[isweep]->h.nrays = iray+1;
+	sweep->ray[iray] = ray;
+	sweep->h.nrays = iray+1;
     } /* for each data field */
+    return 1;
 }
 
 
@@ -550,18 +653,321 @@ void wsr88d_load_sweep_header(Radar *radar, int isweep)
 }
 
 
-Radar *wsr88d_load_m31_into_radar(Wsr88d_file *wf)
+enum radial_status {START_OF_ELEV, INTERMED_RADIAL, END_OF_ELEV, BEGIN_VOS,
+    END_VOS};
+
+
+static int wsr88d_sweep_is_selected(RSL_sweep_filter *filter, int isweep,
+	float ray_elev)
+{
+    float elev;
+
+    if (filter == NULL) return 1;
+
+    /* Use the fixed angle of the VCP cut, which wsr88d_load_sweep_header
+     * assigns to the sweep, or else the elevation of the ray itself.
+     */
+    if (isweep < vcp_data.num_cuts) elev = vcp_data.fixed_angle[isweep];
+    else elev = ray_elev;
+
+    return (elev >= filter->elev_min && elev <= filter->elev_max);
+}
+
+
+/* Image of the remainder of a wsr88d file mapped into memory. */
+typedef struct {
+    void *base;           /* Start of the mapping. */
+    size_t base_len;
+    unsigned char *buf;   /* Current position of the file in the mapping. */
+    size_t len;           /* Bytes from buf to the end of the file. */
+} Wsr88d_image;
+
+
+static int wsr88d_map_file(Wsr88d_file *wf, Wsr88d_image *image)
+{
+    /* Map the (decompressed) file from its current position.  Returns 0
+     * when the file cannot be mapped, e.g. when it is a pipe, leaving the
+     * file position untouched.
+     */
+#ifndef _WIN32
+    struct stat st;
+    long pos;
+    void *base;
+
+    pos = ftell(wf->fptr);
+    if (pos < 0 || fstat(fileno(wf->fptr), &st) != 0 || !S_ISREG(st.st_mode)
+	    || st.st_size <= pos) return 0;
+    base = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE,
+	    fileno(wf->fptr), 0);
+    if (base == MAP_FAILED) return 0;
+    image->base = base;
+    image->base_len = (size_t) st.st_size;
+    image->buf = (unsigned char *) base + pos;
+    image->len = (size_t) (st.st_size - pos);
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+
+static void wsr88d_unmap_file(Wsr88d_image *image)
+{
+#ifndef _WIN32
+    munmap(image->base, image->base_len);
+#endif
+}
+
+
+/* Location of a message 31 radial in memory. */
+typedef struct {
+    size_t offset;  /* Offset of the data header block. */
+    int size;       /* Size of the data header block and data moments. */
+    int isweep;
+} Wsr88d_ray_index;
+
+
+static void wsr88d_ray_from_memory(unsigned char *buf, Wsr88d_ray_index *index,
+	Wsr88d_ray_m31 *wsr88d_ray)
+{
+    /* Point the ray at its data moments in place; only the data header
+     * block is copied and byte-swapped.
+     */
+    wsr88d_ray->data = buf + index->offset;
+    wsr88d_ray->data_size = index->size;
+    memcpy(&wsr88d_ray->ray_hdr, wsr88d_ray->data, sizeof(Ray_header_m31));
+    if (little_endian()) wsr88d_swap_m31_ray_hdr(&wsr88d_ray->ray_hdr);
+    get_wsr88d_unamb_and_nyq_vel(wsr88d_ray, &wsr88d_ray->unamb_rng,
+	    &wsr88d_ray->nyq_vel);
+}
+
+
+/* State of a walk over the messages of a Level II image in memory. */
+typedef struct {
+    size_t pos;          /* Offset of the next message. */
+    int isweep;          /* Index of the sweep being read. */
+    int prev_elev_num;
+    int prev_raynum;
+    int end_of_vos;
+    int has_vcp;
+    Wsr88d_ray_index *index; /* Radials of the selected sweeps, in order. */
+    int nindex;
+    int max_index;
+} Wsr88d_m31_walk;
+
+enum walk_status {WALK_ERROR = -1, WALK_MORE, WALK_END_VOS};
+
+
+static void wsr88d_init_walk(Wsr88d_m31_walk *walk)
+{
+    memset(walk, 0, sizeof(Wsr88d_m31_walk));
+    walk->prev_elev_num = 1;
+}
+
+
+static int wsr88d_walk_messages(unsigned char *buf, size_t len,
+	Wsr88d_m31_walk *walk, RSL_sweep_filter *filter)
+{
+    /* Walk the messages from walk->pos, reading the VCP and indexing the
+     * radials of the selected sweeps.  Returns WALK_END_VOS at the end of
+     * the volume, or WALK_MORE when the buffer ends, with walk->pos at the
+     * start of the first incomplete message.
+     */
+    Wsr88d_msg_hdr msghdr;
+    Ray_header_m31 ray_hdr;
+    Wsr88d_ray_index *new_index;
+    short non31_seg_remainder[1202]; /* Remainder after message header */
+    int msg_hdr_size, msg_size, raynum;
+    size_t pos;
+
+    msg_hdr_size = sizeof(Wsr88d_msg_hdr) - sizeof(msghdr.rpg);
+
+    while (!walk->end_of_vos) {
+	pos = walk->pos;
+	if (len - pos < sizeof(Wsr88d_msg_hdr)) return WALK_MORE;
+	memcpy(&msghdr, buf + pos, sizeof(Wsr88d_msg_hdr));
+	pos += sizeof(Wsr88d_msg_hdr);
+
+	if (msghdr.msg_type != 31) {
+	    /* All other message types are segments of 2432 bytes. */
+	    if (len - pos < sizeof(non31_seg_remainder)) return WALK_MORE;
+	    if (msghdr.msg_type == 5) {
+		memcpy(non31_seg_remainder, buf + pos,
+			sizeof(non31_seg_remainder));
+		wsr88d_get_vcp_data(non31_seg_remainder);
+		walk->has_vcp = 1;
+	    }
+	    walk->pos = pos + sizeof(non31_seg_remainder);
+	    continue;
+	}
+
+	if (little_endian()) wsr88d_swap_m31_hdr(&msghdr);
+	msg_size = (int) msghdr.msg_size * 2 - msg_hdr_size;
+	if (msg_size < (int) sizeof(Ray_header_m31)) {
+	    RSL_printf("wsr88d_walk_messages: Invalid message size %d.\n",
+		    msg_size);
+	    return WALK_ERROR;
+	}
+	if (len - pos < (size_t) msg_size) return WALK_MORE;
+	memcpy(&ray_hdr, buf + pos, sizeof(Ray_header_m31));
+	if (little_endian()) wsr88d_swap_m31_ray_hdr(&ray_hdr);
+
+	raynum = ray_hdr.azm_num;
+	if (raynum < 1 || raynum > MAXRAYS_M31) {
+	    RSL_printf("Error: raynum = %d, exceeds MAXRAYS_M31 (%d)\n", raynum,
+		    MAXRAYS_M31);
+	    return WALK_ERROR;
+	}
+
+	/* Unexpected start of new elevation, see wsr88d_load_m31_into_radar. */
+	if (ray_hdr.radial_status == START_OF_ELEV &&
+		ray_hdr.elev_num - 1 > walk->isweep) {
+	    RSL_printf("Warning: Radial status is Start-of-Elevation, "
+		    "but End-of-Elevation was not\n"
+		    "issued for elevation number %d.  Number of rays = %d\n",
+		    walk->prev_elev_num, walk->prev_raynum);
+	    walk->isweep++;
+	    walk->prev_elev_num = ray_hdr.elev_num - 1;
+	}
+	if (walk->isweep >= MAXSWEEPS) {
+	    RSL_printf("Error: isweep = %d, exceeds MAXSWEEPS (%d)\n",
+		    walk->isweep, MAXSWEEPS);
+	    return WALK_ERROR;
+	}
+
+	if (wsr88d_sweep_is_selected(filter, walk->isweep, ray_hdr.elev)) {
+	    if (msg_size > MAX_RADIAL_LENGTH) {
+		RSL_printf("wsr88d_walk_messages: Invalid message size %d.\n",
+			msg_size);
+		return WALK_ERROR;
+	    }
+	    if (walk->nindex == walk->max_index) {
+		walk->max_index = walk->max_index > 0 ? 2 * walk->max_index
+		    : 4096;
+		new_index = (Wsr88d_ray_index *) realloc(walk->index,
+			walk->max_index * sizeof(Wsr88d_ray_index));
+		if (new_index == NULL) {
+		    RSL_printf("wsr88d_walk_messages: Cannot allocate radial "
+			    "index.\n");
+		    return WALK_ERROR;
+		}
+		walk->index = new_index;
+	    }
+	    walk->index[walk->nindex].offset = pos;
+	    walk->index[walk->nindex].size = msg_size;
+	    walk->index[walk->nindex].isweep = walk->isweep;
+	    walk->nindex++;
+	}
+	walk->pos = pos + msg_size;
+	walk->prev_raynum = raynum;
+
+	if (ray_hdr.radial_status == END_OF_ELEV) {
+	    walk->isweep++;
+	    walk->prev_elev_num = ray_hdr.elev_num;
+	}
+	if (ray_hdr.radial_status == END_VOS) walk->end_of_vos = 1;
+    }
+    return WALK_END_VOS;
+}
+
+
+static void wsr88d_decode_sweeps(unsigned char *buf, Wsr88d_m31_walk *walk,
+	int first, int last, Radar *radar, RSL_sweep_filter *filter)
+{
+    /* Decode the indexed radials of sweeps first to last-1 into radar, the
+     * sweeps in parallel when OpenMP is available.
+     */
+    int sweep_start[MAXSWEEPS+1];
+    int nfailed = 0, isweep, i;
+
+    if (last > MAXSWEEPS) last = MAXSWEEPS;
+    if (first >= last) return;
+
+    /* The index is in file order, so the radials of each sweep are
+     * contiguous in it.
+     */
+    for (isweep = first, i = 0; isweep <= last; isweep++) {
+	while (i < walk->nindex && walk->index[i].isweep < isweep) i++;
+	sweep_start[isweep] = i;
+    }
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1) reduction(+:nfailed)
+#endif
+    for (isweep = first; isweep < last; isweep++) {
+	Wsr88d_ray_m31 ray_m31;
+	int iray;
+
+	for (iray = sweep_start[isweep]; iray < sweep_start[isweep+1]; iray++) {
+	    wsr88d_ray_from_memory(buf, &walk->index[iray], &ray_m31);
+	    if (!wsr88d_load_ray_into_radar(&ray_m31, isweep, radar, filter))
+		nfailed++;
+	}
+    }
+
+    /* Reporting is done here rather than in the parallel region above,
+     * since RSL_printf may call back into R.
+     */
+    if (nfailed > 0)
+	RSL_printf("wsr88d_decode_sweeps: %d radials with unknown or "
+		"invalid data blocks.\n", nfailed);
+    for (isweep = first; isweep < last; isweep++)
+	wsr88d_load_sweep_header(radar, isweep);
+}
+
+
+Radar *wsr88d_load_m31_from_memory(unsigned char *buf, size_t len,
+	RSL_sweep_filter *filter)
+{
+    /* Load a message 31 volume from an uncompressed Level II image in
+     * memory, starting after the volume header record.  A first pass walks
+     * the messages, reading the VCP and indexing the radials of the selected
+     * sweeps; the second pass decodes the sweeps, in parallel when OpenMP is
+     * available.
+     */
+    Wsr88d_m31_walk walk;
+    Radar *radar = NULL;
+    int status;
+
+    wsr88d_init_walk(&walk);
+    status = wsr88d_walk_messages(buf, len, &walk, filter);
+    if (status == WALK_MORE) {
+	RSL_printf("Warning: wsr88d_load_m31_from_memory: Unexpected end of "
+		"file.\nCurrent sweep index: %d\nLast ray read: %d\n",
+		walk.isweep, walk.prev_raynum);
+    }
+    if (status != WALK_END_VOS) {
+	free(walk.index);
+	return NULL;
+    }
+
+    radar = RSL_new_radar(MAX_RADAR_VOLUMES);
+    if (walk.has_vcp) radar->h.vcp = vcp_data.vcp;
+    wsr88d_decode_sweeps(buf, &walk, 0, MAXSWEEPS, radar, filter);
+
+    free(walk.index);
+    return radar;
+}
+
+
+Radar *wsr88d_load_m31_into_radar(Wsr88d_file *wf, RSL_sweep_filter *filter)
 {
     Wsr88d_msg_hdr msghdr;
     Wsr88d_ray_m31 wsr88d_ray;
+    unsigned char ray_buf[MAX_RADIAL_LENGTH];
     short non31_seg_remainder[1202]; /* Remainder after message header */
     int end_of_vos = 0, isweep = 0;
     int msg_hdr_size, msg_size, n;
     int prev_elev_num = 1, prev_raynum = 0, raynum = 0;
     Radar *radar = NULL;
-    enum radial_status {START_OF_ELEV, INTERMED_RADIAL, END_OF_ELEV, BEGIN_VOS,
-        END_VOS};
+    Wsr88d_image image;
 
+    /* Decode in place from a mapping of the file when possible. */
+    if (wsr88d_map_file(wf, &image)) {
+        radar = wsr88d_load_m31_from_memory(image.buf, image.len, filter);
+        wsr88d_unmap_file(&image);
+        return radar;
+    }
 
     /* Message type 31 is a variable length message.  All other types consist of
      * 1 or more segments of length 2432 bytes.  To handle all types, we read
@@ -577,6 +983,7 @@ Radar *wsr88d_load_m31_into_radar(Wsr88d_file *wf)
 
     radar = RSL_new_radar(MAX_RADAR_VOLUMES);
     memset(&wsr88d_ray, 0, sizeof(Wsr88d_ray_m31)); /* Initialize to be safe. */
+    wsr88d_ray.data = ray_buf;
 
   while (!end_of_vos) {
     if (msghdr.msg_type == 31) {
@@ -593,7 +1000,7 @@ Radar *wsr88d_load_m31_into_radar(Wsr88d_file *wf)
         return NULL;
       }
       // END FIX
-      n = read_wsr88d_ray_m31(wf, msg_size, &wsr88d_ray);
+      n = read_wsr88d_ray_hdr_m31(wf, msg_size, &wsr88d_ray);
       if (n <= 0){
         // FIX for vol2birdR segfaults:
         RSL_free_radar(radar);
@@ -601,7 +1008,7 @@ Radar *wsr88d_load_m31_into_radar(Wsr88d_file *wf)
         return NULL;
       }
       raynum = wsr88d_ray.ray_hdr.azm_num;
-      if (raynum > MAXRAYS_M31) {
+      if (raynum < 1 || raynum > MAXRAYS_M31) {
         RSL_printf( "Error: raynum = %d, exceeds MAXRAYS_M31"
             " (%d)\n", raynum, MAXRAYS_M31);
         RSL_free_radar(radar);
@@ -623,14 +1030,27 @@ Radar *wsr88d_load_m31_into_radar(Wsr88d_file *wf)
       }
 
       /* Check if this sweep number exceeds how many we allocated */
-      if (isweep > MAXSWEEPS) {
+      if (isweep >= MAXSWEEPS) {
         RSL_printf( "Error: isweep = %d, exceeds MAXSWEEPS (%d)\n", isweep, MAXSWEEPS);
         RSL_free_radar(radar);
         return NULL;
       }
 
-      /* Load ray into radar structure. */
-      wsr88d_load_ray_into_radar(&wsr88d_ray, isweep, radar);
+      /* Load ray into radar structure, or skip over its data moments
+       * when the sweep is not selected by the filter.
+       */
+      if (wsr88d_sweep_is_selected(filter, isweep, wsr88d_ray.ray_hdr.elev)) {
+        n = read_wsr88d_ray_m31(wf, msg_size, &wsr88d_ray);
+        if (n > 0 && !wsr88d_load_ray_into_radar(&wsr88d_ray, isweep, radar,
+              filter))
+          RSL_printf("wsr88d_load_ray_into_radar: Unknown or invalid data "
+              "block.  isweep = %d, iray = %d.\n", isweep, raynum - 1);
+      }
+      else n = skip_wsr88d_ray_m31(wf, msg_size, &wsr88d_ray);
+      if (n <= 0){
+        RSL_free_radar(radar);
+        return NULL;
+      }
       prev_raynum = raynum;
 
       /* Check for end of sweep */
@@ -693,3 +1113,287 @@ Radar *wsr88d_load_m31_into_radar(Wsr88d_file *wf)
 
     return radar;
 }
+
+
+/**********************************************************************/
+/*                                                                    */
+/*          Real-time Level II chunks (RSL_wsr88d_chunks_*)           */
+/*                                                                    */
+/**********************************************************************/
+
+/* Exists in file wsr88d_to_radar.c */
+void wsr88d_load_site_into_radar(Radar *radar, Wsr88d_site_info *sitep);
+
+/* A volume being assembled from the chunk files of the real-time Level II
+ * feed: a start chunk with the volume header and metadata record,
+ * followed by intermediate chunks and an end chunk, each holding one or
+ * more bzip2 compressed LDM records.  The sweeps are decoded as soon as
+ * their last radial has arrived.
+ */
+struct Wsr88d_chunks {
+    unsigned char *buf;  /* Decompressed messages not yet decoded. */
+    size_t len;
+    size_t size;         /* Allocated size of buf. */
+    Wsr88d_m31_walk walk;
+    VCP_data vcp;        /* VCP of this volume, restored before decoding. */
+    int has_vcp;
+    int ndecoded;        /* Number of sweeps decoded into radar. */
+    int has_site;
+    char callid[5];
+    RSL_sweep_filter filter;
+    int has_filter;
+    Radar *radar;
+};
+
+
+Wsr88d_chunks *RSL_wsr88d_chunks_new(char *callid, RSL_sweep_filter *filter)
+{
+    /* Start a volume to be read from chunks.  'callid' is the 4 character
+     * call sign of the radar, used when the start chunk does not carry it;
+     * it may be NULL.  'filter' selects the sweeps to decode, as for
+     * RSL_wsr88d_to_radar_filtered, and may be NULL.
+     */
+    Wsr88d_chunks *chunks;
+
+    chunks = (Wsr88d_chunks *) calloc(1, sizeof(Wsr88d_chunks));
+    if (chunks == NULL) return NULL;
+    wsr88d_init_walk(&chunks->walk);
+    if (callid != NULL) strncpy(chunks->callid, callid, 4);
+    if (filter != NULL) {
+	chunks->filter = *filter;
+	chunks->has_filter = 1;
+    }
+    chunks->radar = RSL_new_radar(MAX_RADAR_VOLUMES);
+    if (chunks->radar == NULL) {
+	free(chunks);
+	return NULL;
+    }
+    return chunks;
+}
+
+
+void RSL_wsr88d_chunks_free(Wsr88d_chunks *chunks)
+{
+    if (chunks == NULL) return;
+    free(chunks->buf);
+    free(chunks->walk.index);
+    RSL_free_radar(chunks->radar);
+    free(chunks);
+}
+
+
+static int wsr88d_chunks_reserve(Wsr88d_chunks *chunks, size_t extra)
+{
+    unsigned char *buf;
+    size_t size;
+
+    if (chunks->len + extra <= chunks->size) return 1;
+    size = chunks->size > 0 ? chunks->size : 262144;
+    while (size < chunks->len + extra) size *= 2;
+    buf = (unsigned char *) realloc(chunks->buf, size);
+    if (buf == NULL) return 0;
+    chunks->buf = buf;
+    chunks->size = size;
+    return 1;
+}
+
+
+static int wsr88d_chunks_append(Wsr88d_chunks *chunks, char *block,
+	unsigned int length, int compressed)
+{
+    /* Append a (bzip2 compressed) record to the message buffer. */
+    unsigned int olength;
+    int error;
+
+    if (!compressed) {
+	if (!wsr88d_chunks_reserve(chunks, length)) return BZ_MEM_ERROR;
+	memcpy(chunks->buf + chunks->len, block, length);
+	chunks->len += length;
+	return BZ_OK;
+    }
+    if (!wsr88d_chunks_reserve(chunks, 4 * (size_t) length)) return BZ_MEM_ERROR;
+    for (;;) {
+	olength = (unsigned int) (chunks->size - chunks->len);
+#ifdef BZ_CONFIG_ERROR
+	error = BZ2_bzBuffToBuffDecompress((char *) chunks->buf + chunks->len,
+		&olength, block, length, 0, 0);
+#else
+	error = bzBuffToBuffDecompress((char *) chunks->buf + chunks->len,
+		&olength, block, length, 0, 0);
+#endif
+	if (error != BZ_OUTBUFF_FULL) break;
+	if (!wsr88d_chunks_reserve(chunks, chunks->size - chunks->len + 1))
+	    return BZ_MEM_ERROR;
+    }
+    if (error == BZ_OK) chunks->len += olength;
+    return error;
+}
+
+
+static void wsr88d_chunks_compact(Wsr88d_chunks *chunks)
+{
+    /* Drop the messages of the decoded sweeps from the buffer. */
+    Wsr88d_m31_walk *walk = &chunks->walk;
+    size_t base;
+    int first = 0, i;
+
+    while (first < walk->nindex && walk->index[first].isweep < chunks->ndecoded)
+	first++;
+    /* Radials are decoded from their data header block onwards. */
+    base = (first < walk->nindex) ? walk->index[first].offset : walk->pos;
+
+    for (i = first; i < walk->nindex; i++) {
+	walk->index[i - first] = walk->index[i];
+	walk->index[i - first].offset -= base;
+    }
+    walk->nindex -= first;
+    memmove(chunks->buf, chunks->buf + base, chunks->len - base);
+    chunks->len -= base;
+    walk->pos -= base;
+}
+
+
+int RSL_wsr88d_chunks_add(Wsr88d_chunks *chunks, char *filename)
+{
+    /* Add the next chunk file of the volume, in the order of the feed.
+     * Decodes the sweeps that are completed by the chunk.  Returns the
+     * number of completed sweeps, or -1 on failure.
+     */
+    FILE *fp;
+    char *data = NULL;
+    long fsize;
+    size_t pos = 0, nread;
+    int length, last, status, complete, error;
+    RSL_sweep_filter *filter = chunks->has_filter ? &chunks->filter : NULL;
+    Wsr88d_site_info *sitep;
+    char site_id[5];
+
+    if (chunks->walk.end_of_vos) {
+	RSL_printf("RSL_wsr88d_chunks_add: Volume is already complete, "
+		"ignoring %s.\n", filename);
+	return 0;
+    }
+
+    if ((fp = fopen(filename, "rb")) == NULL) {
+	wsr88d_perror(filename);
+	return -1;
+    }
+    fseek(fp, 0, SEEK_END);
+    fsize = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    if (fsize > 0) data = (char *) malloc(fsize);
+    nread = (data != NULL) ? fread(data, 1, fsize, fp) : 0;
+    fclose(fp);
+    if (fsize <= 0 || nread != (size_t) fsize) {
+	RSL_printf("RSL_wsr88d_chunks_add: Cannot read %s.\n", filename);
+	free(data);
+	return -1;
+    }
+
+    /* The start chunk begins with the volume header record. */
+    if (fsize >= 24 && (strncmp(data, "AR2V", 4) == 0 ||
+		strncmp(data, "ARCH", 4) == 0)) {
+	memcpy(site_id, data + 20, 4);
+	site_id[4] = '\0';
+	if (site_id[0] != '\0') memcpy(chunks->callid, site_id, 5);
+	pos = 24;
+    }
+
+    if (!chunks->has_site) {
+	sitep = (chunks->callid[0] != '\0') ? wsr88d_get_site(chunks->callid)
+	    : NULL;
+	if (sitep == NULL) {
+	    RSL_printf("RSL_wsr88d_chunks_add: No valid site ID info found.\n");
+	    free(data);
+	    return -1;
+	}
+	wsr88d_load_site_into_radar(chunks->radar, sitep);
+	free(sitep);
+	chunks->has_site = 1;
+    }
+
+    /* Records of the LDM feed: 4 byte big-endian size, negative for the
+     * last record of the volume, followed by the bzip2 stream.  A chunk
+     * without bzip2 records holds the messages as is.
+     */
+    if ((size_t) fsize - pos < 10 || strncmp(data + pos + 4, "BZ", 2) != 0) {
+	error = wsr88d_chunks_append(chunks, data + pos,
+		(unsigned int) (fsize - pos), 0);
+	pos = fsize;
+    }
+    else error = BZ_OK;
+    while (error == BZ_OK && (size_t) fsize - pos >= 4) {
+	length = ((unsigned char) data[pos] << 24) |
+	    ((unsigned char) data[pos+1] << 16) |
+	    ((unsigned char) data[pos+2] << 8) | (unsigned char) data[pos+3];
+	pos += 4;
+	last = (length < 0);
+	if (last) length = -length;
+	if ((size_t) length > (size_t) fsize - pos) {
+	    RSL_printf("RSL_wsr88d_chunks_add: Short record in %s.\n", filename);
+	    free(data);
+	    return -1;
+	}
+	/* very short records contain no compressed data */
+	if (length > 10)
+	    error = wsr88d_chunks_append(chunks, data + pos, length, 1);
+	pos += length;
+	if (last) break;
+    }
+    free(data);
+    if (error != BZ_OK) {
+	RSL_printf("RSL_wsr88d_chunks_add: decompress error - %d\n", error);
+	return -1;
+    }
+
+    /* The VCP is kept in static storage shared with the other readers. */
+    if (chunks->has_vcp) vcp_data = chunks->vcp;
+    status = wsr88d_walk_messages(chunks->buf, chunks->len, &chunks->walk,
+	    filter);
+    if (status == WALK_ERROR) return -1;
+    if (chunks->walk.has_vcp) {
+	chunks->vcp = vcp_data;
+	chunks->has_vcp = 1;
+	chunks->radar->h.vcp = vcp_data.vcp;
+    }
+
+    /* All sweeps before the one being read are complete; at the end of
+     * the volume that one is as well.
+     */
+    complete = chunks->walk.isweep + (status == WALK_END_VOS ? 1 : 0);
+    if (complete > MAXSWEEPS) complete = MAXSWEEPS;
+    if (complete <= chunks->ndecoded) return 0;
+    wsr88d_decode_sweeps(chunks->buf, &chunks->walk, chunks->ndecoded,
+	    complete, chunks->radar, filter);
+    last = chunks->ndecoded;
+    chunks->ndecoded = complete;
+    wsr88d_chunks_compact(chunks);
+    /* The nominal time is that of the first sweep, which the caller may
+     * free once it is used.
+     */
+    if (last == 0) radar_load_date_time(chunks->radar);
+
+    return complete - last;
+}
+
+
+Radar *RSL_wsr88d_chunks_radar(Wsr88d_chunks *chunks)
+{
+    /* The radar assembled so far.  Sweeps are stored as read, at the index
+     * of their elevation cut: split cuts are not merged and SAILS sweeps
+     * are not removed.  The radar remains owned by 'chunks'.
+     */
+    return chunks->radar;
+}
+
+
+int RSL_wsr88d_chunks_nsweeps(Wsr88d_chunks *chunks)
+{
+    return chunks->ndecoded;
+}
+
+
+int RSL_wsr88d_chunks_complete(Wsr88d_chunks *chunks)
+{
+    return chunks->walk.end_of_vos;
+}
@@ -43,7 +43,7 @@ Volume *copy_sweeps_into_volume(Volume *new_volume, Volume *old_volume);
 /* Exists in file wsr88d_remove_sails_sweep.c */
 void wsr88d_remove_sails_sweep(Radar *radar);
 
-Radar *wsr88d_load_m31_into_radar(Wsr88d_file *wf);
+Radar *wsr88d_load_m31_into_radar(Wsr88d_file *wf, RSL_sweep_filter *filter);
 
 /* Function to specify keeping the extra split-cut inserted into middle of
  * volume scan when SAILS is in effect for VCPs 12 and 212.
@@ -222,7 +222,41 @@ int wsr88d_load_sweep_into_volume(Wsr88d_sweep ws,
 /*      March 3, 1994                                                 */
 /**********************************************************************/
 
+void wsr88d_load_site_into_radar(Radar *radar, Wsr88d_site_info *sitep)
+{
+/* Assign the site information to the Radar_header. */
+    radar->h.number = sitep->number;
+    memcpy(&radar->h.name, sitep->name, sizeof(sitep->name));
+    memcpy(&radar->h.radar_name, sitep->name, sizeof(sitep->name)); /* Redundant */
+    memcpy(&radar->h.city, sitep->city, sizeof(sitep->city));
+    memcpy(&radar->h.state, sitep->state, sizeof(sitep->state));
+    strcpy(radar->h.radar_type, "wsr88d");
+    radar->h.latd = sitep->latd;
+    radar->h.latm = sitep->latm;
+    radar->h.lats = sitep->lats;
+    if (radar->h.latd < 0) { /* Degree/min/sec  all the same sign */
+      radar->h.latm *= -1;
+      radar->h.lats *= -1;
+    }
+    radar->h.lond = sitep->lond;
+    radar->h.lonm = sitep->lonm;
+    radar->h.lons = sitep->lons;
+    if (radar->h.lond < 0) { /* Degree/min/sec  all the same sign */
+      radar->h.lonm *= -1;
+      radar->h.lons *= -1;
+    }
+    radar->h.height = sitep->height;
+    radar->h.spulse = sitep->spulse;
+    radar->h.lpulse = sitep->lpulse;
+}
+
 Radar *RSL_wsr88d_to_radar(char *infile, char *call_or_first_tape_file)
+{
+  return RSL_wsr88d_to_radar_filtered(infile, call_or_first_tape_file, NULL);
+}
+
+Radar *RSL_wsr88d_to_radar_filtered(char *infile, char *call_or_first_tape_file,
+                                    RSL_sweep_filter *filter)
 /*
  * Gets all volumes from the nexrad file.  Input file is 'infile'.
  * Site information is extracted from 'call_or_first_tape_file'; this
@@ -236,6 +270,9 @@ Radar *RSL_wsr88d_to_radar(char *infile, char *call_or_first_tape_file)
  *
  * Returns a pointer to a Radar structure; that contains the different
  * Volumes of data.
+ *
+ * For message 31 (Build 10 and later) files, only the sweeps selected by
+ * 'filter' are decoded; a NULL filter reads all sweeps.
  */
 {
   Radar *radar;
@@ -350,7 +387,7 @@ Radar *RSL_wsr88d_to_radar(char *infile, char *call_or_first_tape_file)
 
   if (expected_msgtype == 31) {
       /* Get radar for message type 31. */
-      radar = wsr88d_load_m31_into_radar(wf);
+      radar = wsr88d_load_m31_into_radar(wf, filter);
       if (radar == NULL) return NULL;
   }
   else {
@@ -431,36 +468,18 @@ Radar *RSL_wsr88d_to_radar(char *infile, char *call_or_first_tape_file)
  */
   radar_load_date_time(radar);  /* Magic :-) */
 
-    radar->h.number = sitep->number;
-    memcpy(&radar->h.name, sitep->name, sizeof(sitep->name));
-    memcpy(&radar->h.radar_name, sitep->name, sizeof(sitep->name)); /* Redundant */
-    memcpy(&radar->h.city, sitep->city, sizeof(sitep->city));
-    memcpy(&radar->h.state, sitep->state, sizeof(sitep->state));
-    strcpy(radar->h.radar_type, "wsr88d");
-    radar->h.latd = sitep->latd;
-    radar->h.latm = sitep->latm;
-    radar->h.lats = sitep->lats;
-    if (radar->h.latd < 0) { /* Degree/min/sec  all the same sign */
-      radar->h.latm *= -1;
-      radar->h.lats *= -1;
-    }
-    radar->h.lond = sitep->lond;
-    radar->h.lonm = sitep->lonm;
-    radar->h.lons = sitep->lons;
-    if (radar->h.lond < 0) { /* Degree/min/sec  all the same sign */
-      radar->h.lonm *= -1;
-      radar->h.lons *= -1;
-    }
-    radar->h.height = sitep->height;
-    radar->h.spulse = sitep->spulse;
-    radar->h.lpulse = sitep->lpulse;
-
+    wsr88d_load_site_into_radar(radar, sitep);
     free(sitep);
 
   if (wsr88d_merge_split_cuts_is_set()) {
       radar = wsr88d_merge_split_cuts(radar);
-      if ((radar->h.vcp == 12 || radar->h.vcp == 212) && !keep_sails) 
+      if ((radar->h.vcp == 12 || radar->h.vcp == 212) && !keep_sails &&
+          !(filter != NULL && filter->keep_sails))
           wsr88d_remove_sails_sweep(radar);
   }
+  else if (filter != NULL) {
+      /* Squash out the sweeps that were skipped by the filter. */
+      radar = RSL_prune_radar(radar);
+  }
   return radar;
 }
@@ -0,0 +1,686 @@
+/** Metadata-only catalog of radar input files
+ * @file libcatalog.c
+ *
+ * Reads the radar, nominal time and scan geometry of ODIM, NEXRAD Level II
+ * and IRIS RAW files from their headers only, without decoding the data.
+ * Used to plan batch runs over large archives.
+ *
+ * The functions in this file do not print; a failure to read a file is
+ * reported through the status field of its catalog entry, so files can be
+ * catalogued from multiple threads.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <bzlib.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "hlhdf.h"
+#include "libvol2bird.h"
+#include "libcatalog.h"
+
+#ifdef RSL
+#include "rsl.h"
+#endif
+
+#ifdef IRIS
+#include "iris2odim.h"
+#include "iris2list_interface.h"
+#endif
+
+// size of a NEXRAD Level II volume header (ARCHIVE2 / AR2V)
+#define LEVEL2_VOLUME_HEADER_SIZE 24
+
+// size of the RPG communications manager header preceding each message
+#define LEVEL2_CTM_SIZE 12
+
+// size of a fixed-length (non message 31) Level II message segment
+#define LEVEL2_SEGMENT_SIZE 2432
+
+// the metadata record holds 134 fixed-length message segments
+#define LEVEL2_METADATA_SIZE (134 * LEVEL2_SEGMENT_SIZE)
+
+// bytes of the first data record decompressed to find the first radial
+#define LEVEL2_DATA_PEEK_SIZE 65536
+
+// Level II waveform type of contiguous surveillance cuts (reflectivity only)
+#define LEVEL2_WAVEFORM_CS 1
+
+
+static void catalogAddQuantity(vol2birdCatalogScan_t* scan, const char* quantity) {
+
+    size_t len = strlen(scan->quantities);
+    size_t qlen = strlen(quantity);
+    const char* match = scan->quantities;
+
+    // skip quantities already listed
+    while ((match = strstr(match, quantity)) != NULL) {
+        int startOk = (match == scan->quantities || match[-1] == ',');
+        int endOk = (match[qlen] == '\0' || match[qlen] == ',');
+        if (startOk && endOk) return;
+        match += qlen;
+    }
+
+    if (len + qlen + (len > 0 ? 1 : 0) >= CATALOG_QUANTITIES_SIZE) return;
+
+    if (len > 0) scan->quantities[len++] = ',';
+    memcpy(scan->quantities + len, quantity, qlen + 1);
+}
+
+
+// converts days since 1970-01-01 to a civil date (gmtime is not thread-safe)
+static void catalogDaysToDate(long days, int* year, int* month, int* day) {
+
+    long z = days + 719468;
+    long era = (z >= 0 ? z : z - 146096) / 146097;
+    long doe = z - era * 146097;
+    long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    long mp = (5 * doy + 2) / 153;
+
+    *day = (int) (doy - (153 * mp + 2) / 5 + 1);
+    *month = (int) (mp < 10 ? mp + 3 : mp - 9);
+    *year = (int) (yoe + era * 400 + (*month <= 2));
+}
+
+
+static void catalogSetDateTime(vol2birdCatalogEntry_t* entry, int year, int month, int day, long secondsOfDay) {
+
+    snprintf(entry->date, sizeof(entry->date), "%04d%02d%02d", year % 10000, month % 100, day % 100);
+    snprintf(entry->time, sizeof(entry->time), "%02ld%02ld%02ld",
+             (secondsOfDay / 3600) % 100, (secondsOfDay / 60) % 60, secondsOfDay % 60);
+}
+
+
+// *****************************************************************************
+// ODIM HDF5
+// *****************************************************************************
+
+
+static int catalogGetODIMString(HL_NodeList* nodelist, const char* name, char* value, size_t size) {
+
+    HL_Node* node = HLNodeList_getNodeByName(nodelist, name);
+
+    if (node == NULL || HLNode_getFormat(node) != HLHDF_STRING || HLNode_getData(node) == NULL) {
+        return 0;
+    }
+
+    snprintf(value, size, "%s", (const char*) HLNode_getData(node));
+
+    return 1;
+}
+
+
+static int catalogGetODIMDouble(HL_NodeList* nodelist, const char* name, double* value) {
+
+    HL_Node* node = HLNodeList_getNodeByName(nodelist, name);
+    HL_FormatSpecifier format;
+    size_t size;
+    unsigned char* data;
+
+    if (node == NULL || HLNode_getRank(node) != 0 || (data = HLNode_getData(node)) == NULL) {
+        return 0;
+    }
+
+    format = HLNode_getFormat(node);
+    size = HLNode_getDataSize(node);
+
+    if (format >= HLHDF_FLOAT && format <= HLHDF_LDOUBLE) {
+        if (size == sizeof(float)) {
+            float v;
+            memcpy(&v, data, size);
+            *value = v;
+        } else if (size == sizeof(double)) {
+            double v;
+            memcpy(&v, data, size);
+            *value = v;
+        } else {
+            return 0;
+        }
+    } else if (format >= HLHDF_SCHAR && format <= HLHDF_ULLONG) {
+        if (size == sizeof(char)) {
+            signed char v;
+            memcpy(&v, data, size);
+            *value = v;
+        } else if (size == sizeof(short)) {
+            short v;
+            memcpy(&v, data, size);
+            *value = v;
+        } else if (size == sizeof(int)) {
+            int v;
+            memcpy(&v, data, size);
+            *value = v;
+        } else if (size == sizeof(long long)) {
+            long long v;
+            memcpy(&v, data, size);
+            *value = (double) v;
+        } else {
+            return 0;
+        }
+    } else {
+        return 0;
+    }
+
+    return 1;
+}
+
+
+// picks the node identifier from an ODIM source string, e.g. "WMO:06260,NOD:nldbl"
+static void catalogODIMSourceToRadar(const char* source, char* radar, size_t size) {
+
+    const char* keys[] = {"NOD:", "RAD:", "WMO:", "CMT:"};
+
+    for (size_t iKey = 0; iKey < sizeof(keys) / sizeof(keys[0]); iKey++) {
+        const char* start = strstr(source, keys[iKey]);
+        if (start != NULL) {
+            start += strlen(keys[iKey]);
+            size_t len = strcspn(start, ",");
+            if (len >= size) len = size - 1;
+            memcpy(radar, start, len);
+            radar[len] = '\0';
+            return;
+        }
+    }
+
+    snprintf(radar, size, "%s", source);
+}
+
+
+static int catalogODIM(const char* filename, vol2birdCatalogEntry_t* entry) {
+
+    HL_NodeList* nodelist = NULL;
+    char name[64];
+    char source[256] = "";
+    int result = -1;
+
+    nodelist = HLNodeList_read(filename);
+    if (nodelist == NULL) {
+        goto done;
+    }
+
+    // fetch only attributes, not the dataset arrays
+    HLNodeList_selectMetadataNodes(nodelist);
+    if (!HLNodeList_fetchMarkedNodes(nodelist)) {
+        goto done;
+    }
+
+    if (catalogGetODIMString(nodelist, "/what/source", source, sizeof(source))) {
+        catalogODIMSourceToRadar(source, entry->radar, sizeof(entry->radar));
+    }
+    catalogGetODIMString(nodelist, "/what/date", entry->date, sizeof(entry->date));
+    catalogGetODIMString(nodelist, "/what/time", entry->time, sizeof(entry->time));
+
+    for (int iDataset = 1; entry->nScans < CATALOG_MAX_SCANS; iDataset++) {
+        vol2birdCatalogScan_t* scan = &entry->scans[entry->nScans];
+        double value;
+
+        snprintf(name, sizeof(name), "/dataset%d", iDataset);
+        if (!HLNodeList_hasNodeByName(nodelist, name)) {
+            break;
+        }
+
+        // skip datasets that are not polar scans, e.g. products
+        snprintf(name, sizeof(name), "/dataset%d/where/elangle", iDataset);
+        if (!catalogGetODIMDouble(nodelist, name, &value)) {
+            continue;
+        }
+        scan->elangle = (float) value;
+
+        snprintf(name, sizeof(name), "/dataset%d/where/nrays", iDataset);
+        scan->nrays = catalogGetODIMDouble(nodelist, name, &value) ? (int) value : 0;
+
+        snprintf(name, sizeof(name), "/dataset%d/where/nbins", iDataset);
+        scan->nbins = catalogGetODIMDouble(nodelist, name, &value) ? (int) value : 0;
+
+        snprintf(name, sizeof(name), "/dataset%d/where/rscale", iDataset);
+        scan->rscale = catalogGetODIMDouble(nodelist, name, &value) ? (float) value : 0;
+
+        scan->quantities[0] = '\0';
+        for (int iData = 1; ; iData++) {
+            char quantity[32];
+
+            snprintf(name, sizeof(name), "/dataset%d/data%d", iDataset, iData);
+            if (!HLNodeList_hasNodeByName(nodelist, name)) {
+                break;
+            }
+            snprintf(name, sizeof(name), "/dataset%d/data%d/what/quantity", iDataset, iData);
+            if (catalogGetODIMString(nodelist, name, quantity, sizeof(quantity))) {
+                catalogAddQuantity(scan, quantity);
+            }
+        }
+
+        entry->nScans++;
+    }
+
+    result = 0;
+
+done:
+    if (nodelist != NULL) {
+        HLNodeList_free(nodelist);
+    }
+    return result;
+}
+
+
+// *****************************************************************************
+// NEXRAD Level II
+// *****************************************************************************
+
+
+typedef struct {
+    int nCuts;
+    float elangle[CATALOG_MAX_SCANS];
+    int waveform[CATALOG_MAX_SCANS];
+    int superRes[CATALOG_MAX_SCANS];
+    int haveRadial;     // first message 31 radial seen
+    char radar[5];
+    int nbins;
+    float rscale;
+    int dualpol;
+} level2Header_t;
+
+
+static unsigned int catalogBE16(const unsigned char* p) {
+    return ((unsigned int) p[0] << 8) | p[1];
+}
+
+
+static unsigned long catalogBE32(const unsigned char* p) {
+    return ((unsigned long) p[0] << 24) | ((unsigned long) p[1] << 16) | ((unsigned long) p[2] << 8) | p[3];
+}
+
+
+// decompress (at most 'size' leading bytes of) one bzip2 compressed record
+static long catalogBunzip(char* in, unsigned int inLength, char* out, unsigned int size) {
+
+    bz_stream strm;
+    long produced;
+    int ret;
+
+    memset(&strm, 0, sizeof(strm));
+    if (BZ2_bzDecompressInit(&strm, 0, 0) != BZ_OK) {
+        return -1;
+    }
+
+    strm.next_in = in;
+    strm.avail_in = inLength;
+    strm.next_out = out;
+    strm.avail_out = size;
+
+    do {
+        unsigned int availIn = strm.avail_in;
+        unsigned int availOut = strm.avail_out;
+        ret = BZ2_bzDecompress(&strm);
+        // stop on truncated input
+        if (ret == BZ_OK && strm.avail_in == availIn && strm.avail_out == availOut) break;
+    } while (ret == BZ_OK && strm.avail_out > 0);
+
+    produced = (long) (size - strm.avail_out);
+    BZ2_bzDecompressEnd(&strm);
+
+    if (ret != BZ_OK && ret != BZ_STREAM_END) {
+        return -1;
+    }
+
+    return produced;
+}
+
+
+// volume coverage pattern (message 5), halfword layout as in wsr88d_get_vcp_data()
+static void catalogParseLevel2VCP(const unsigned char* msg, size_t length, level2Header_t* header) {
+
+    if (length < 22) return;
+
+    int nCuts = (int) catalogBE16(msg + 6);
+    if (nCuts > CATALOG_MAX_SCANS) nCuts = CATALOG_MAX_SCANS;
+
+    header->nCuts = 0;
+    for (int iCut = 0; iCut < nCuts; iCut++) {
+        const unsigned char* cut = msg + 22 + 46 * iCut;
+        if (cut + 46 > msg + length) break;
+
+        // binary angle, 3 least significant bits unused
+        float angle = (float) ((catalogBE16(cut) & 0xfff8) * (180.0 / 32768.0));
+        if (angle > 180) angle -= 360;
+
+        header->elangle[iCut] = angle;
+        header->waveform[iCut] = cut[3];
+        header->superRes[iCut] = cut[4];
+        header->nCuts++;
+    }
+}
+
+
+// first digital radar data radial (message 31), see Ray_header_m31 in wsr88d_m31.c
+static void catalogParseLevel2Radial(const unsigned char* msg, size_t length, level2Header_t* header) {
+
+    if (length < 32) return;
+
+    memcpy(header->radar, msg, 4);
+    header->radar[4] = '\0';
+
+    unsigned int nBlocks = catalogBE16(msg + 30);
+    if (nBlocks > 10) nBlocks = 10;
+
+    for (unsigned int iBlock = 0; iBlock < nBlocks; iBlock++) {
+        if (32 + 4 * (iBlock + 1) > length) break;
+        unsigned long pointer = catalogBE32(msg + 32 + 4 * iBlock);
+        if (pointer == 0 || pointer + 14 > length) continue;
+
+        const unsigned char* block = msg + pointer;
+        if (block[0] != 'D') continue;
+
+        if (memcmp(block + 1, "REF", 3) == 0) {
+            header->nbins = (int) catalogBE16(block + 8);
+            header->rscale = (float) catalogBE16(block + 12);
+        }
+        if (memcmp(block + 1, "ZDR", 3) == 0 || memcmp(block + 1, "RHO", 3) == 0 || memcmp(block + 1, "PHI", 3) == 0) {
+            header->dualpol = TRUE;
+        }
+    }
+
+    header->haveRadial = TRUE;
+}
+
+
+static void catalogParseLevel2Messages(const unsigned char* buf, size_t length, level2Header_t* header) {
+
+    size_t offset = 0;
+
+    while (offset + LEVEL2_CTM_SIZE + 16 <= length) {
+        const unsigned char* msg = buf + offset + LEVEL2_CTM_SIZE;
+        size_t msgSize = 2 * (size_t) catalogBE16(msg);
+        int msgType = msg[3];
+
+        if (msgType == 31) {
+            if (msgSize < 16) break;
+            if (!header->haveRadial && offset + LEVEL2_CTM_SIZE + msgSize <= length) {
+                catalogParseLevel2Radial(msg + 16, msgSize - 16, header);
+            }
+            offset += LEVEL2_CTM_SIZE + msgSize;
+        }
+        else {
+            if (msgType == 5 && offset + LEVEL2_SEGMENT_SIZE <= length) {
+                catalogParseLevel2VCP(msg + 16, LEVEL2_SEGMENT_SIZE - LEVEL2_CTM_SIZE - 16, header);
+            }
+            offset += LEVEL2_SEGMENT_SIZE;
+        }
+
+        if (header->haveRadial && header->nCuts > 0) break;
+    }
+}
+
+
+// reads one size-prefixed bzip2 record of an AR2V file
+static long catalogReadLevel2Record(FILE* fp, char* out, unsigned int size) {
+
+    unsigned char prefix[4];
+    long recordLength;
+    long produced;
+    char* record;
+
+    if (fread(prefix, 1, 4, fp) != 4) return -1;
+
+    // the last record of a volume has a negative size
+    recordLength = labs((long) (int32_t) catalogBE32(prefix));
+    if (recordLength <= 10 || recordLength > 100000000) return -1;
+
+    record = malloc(recordLength);
+    if (record == NULL) return -1;
+
+    if (fread(record, 1, recordLength, fp) != (size_t) recordLength) {
+        free(record);
+        return -1;
+    }
+
+    produced = catalogBunzip(record, (unsigned int) recordLength, out, size);
+    free(record);
+
+    return produced;
+}
+
+
+static int catalogLevel2(const char* filename, vol2birdCatalogEntry_t* entry) {
+
+    unsigned char volumeHeader[LEVEL2_VOLUME_HEADER_SIZE + 7];
+    level2Header_t header;
+    size_t bufferSize = LEVEL2_METADATA_SIZE + LEVEL2_DATA_PEEK_SIZE;
+    unsigned char* buffer = NULL;
+    size_t length = 0;
+    int result = -1;
+    int year, month, day;
+    FILE* fp;
+
+    memset(&header, 0, sizeof(header));
+
+    fp = fopen(filename, "rb");
+    if (fp == NULL) {
+        return -1;
+    }
+
+    if (fread(volumeHeader, 1, sizeof(volumeHeader), fp) != sizeof(volumeHeader)) {
+        goto done;
+    }
+
+    // gzip'd Level II files are not catalogued
+    if (memcmp(volumeHeader, "AR2V", 4) != 0 && memcmp(volumeHeader, "ARCHIVE2", 8) != 0) {
+        goto done;
+    }
+
+    // modified Julian date (1 = 1970-01-01) and milliseconds past midnight
+    catalogDaysToDate((long) catalogBE32(volumeHeader + 12) - 1, &year, &month, &day);
+    catalogSetDateTime(entry, year, month, day, (long) (catalogBE32(volumeHeader + 16) / 1000));
+    memcpy(entry->radar, volumeHeader + 20, 4);
+    entry->radar[4] = '\0';
+
+    buffer = malloc(bufferSize);
+    if (buffer == NULL) {
+        goto done;
+    }
+
+    fseek(fp, LEVEL2_VOLUME_HEADER_SIZE, SEEK_SET);
+
+    if (memcmp(volumeHeader + LEVEL2_VOLUME_HEADER_SIZE + 4, "BZ", 2) == 0) {
+        // metadata record (contains the VCP) followed by the first data record
+        long produced = catalogReadLevel2Record(fp, (char*) buffer, LEVEL2_METADATA_SIZE);
+        if (produced < 0) {
+            goto done;
+        }
+        length = (size_t) produced;
+        produced = catalogReadLevel2Record(fp, (char*) buffer + length, (unsigned int) (bufferSize - length));
+        if (produced > 0) {
+            length += (size_t) produced;
+        }
+    }
+    else {
+        // uncompressed messages follow the volume header directly
+        length = fread(buffer, 1, bufferSize, fp);
+    }
+
+    catalogParseLevel2Messages(buffer, length, &header);
+
+    if (entry->radar[0] == '\0' || entry->radar[0] == ' ') {
+        memcpy(entry->radar, header.radar, sizeof(header.radar));
+    }
+
+    // nbins and rscale are those of the reflectivity of the first radial;
+    // the quantities follow from the waveform of each cut in the VCP
+    for (int iCut = 0; iCut < header.nCuts; iCut++) {
+        vol2birdCatalogScan_t* scan = &entry->scans[entry->nScans];
+
+        scan->elangle = header.elangle[iCut];
+        scan->nrays = (header.superRes[iCut] & 1) ? 720 : 360;
+        scan->nbins = header.nbins;
+        scan->rscale = header.rscale;
+        scan->quantities[0] = '\0';
+        catalogAddQuantity(scan, "DBZH");
+        if (header.waveform[iCut] != LEVEL2_WAVEFORM_CS) {
+            catalogAddQuantity(scan, "VRADH");
+            catalogAddQuantity(scan, "WRADH");
+        }
+        if (header.dualpol) {
+            catalogAddQuantity(scan, "ZDR");
+            catalogAddQuantity(scan, "RHOHV");
+            catalogAddQuantity(scan, "PHIDP");
+        }
+        entry->nScans++;
+    }
+
+    result = 0;
+
+done:
+    free(buffer);
+    fclose(fp);
+    return result;
+}
+
+
+// *****************************************************************************
+// IRIS RAW
+// *****************************************************************************
+
+
+#ifdef IRIS
+static int catalogIRIS(const char* filename, vol2birdCatalogEntry_t* entry) {
+
+    IRISfile* fp = NULL;
+    IRISbuf* productRecord = NULL;
+    IRISbuf* ingestRecord = NULL;
+    phd_s* phd = NULL;
+    ihd_s* ihd = NULL;
+    _Bool targetIsBigEndian;
+    short structureId;
+    int result = -1;
+
+    // the file is mapped, only the pages of the two header records are read
+    fp = IRISfile_open(filename);
+    if (fp == NULL) {
+        return -1;
+    }
+
+    // product_hdr record followed by the ingest_header record
+    productRecord = getabuf(fp, IRIS_BUFFER_SIZE);
+    ingestRecord = getabuf(fp, IRIS_BUFFER_SIZE);
+    if (productRecord == NULL || ingestRecord == NULL ||
+        productRecord->bytesCopied != IRIS_BUFFER_SIZE || ingestRecord->bytesCopied != IRIS_BUFFER_SIZE) {
+        goto done;
+    }
+
+    memcpy(&structureId, productRecord->bufIRIS, sizeof(short));
+    targetIsBigEndian = (structureId != 27);
+
+    phd = extract_product_hdr(productRecord, targetIsBigEndian);
+    if (phd == NULL || phd->pcf.product_type_code != 15) {
+        // not a RAW product, no ingest header
+        goto done;
+    }
+
+    ihd = extract_ingest_header(ingestRecord, targetIsBigEndian);
+    if (ihd == NULL) {
+        goto done;
+    }
+
+    snprintf(entry->radar, sizeof(entry->radar), "%.16s", ihd->icf.radar_site_name_from_setup_utility);
+    for (int i = (int) strlen(entry->radar) - 1; i >= 0 && entry->radar[i] == ' '; i--) {
+        entry->radar[i] = '\0';
+    }
+
+    ymd_s* start = &ihd->icf.time_that_volume_scan_was_started;
+    catalogSetDateTime(entry, start->year, start->month, start->day, (long) start->seconds_since_midnight);
+
+    int nSweeps = ihd->tcf.scan.number_of_sweeps_to_perform;
+    if (nSweeps > CATALOG_MAX_SCANS) nSweeps = CATALOG_MAX_SCANS;
+    if (nSweeps > MAX_SWEEPS) nSweeps = MAX_SWEEPS;
+
+    // PPI sector (1) and PPI full (4) scans list their elevations
+    int ppi = (ihd->tcf.scan.antenna_scan_mode == 1 || ihd->tcf.scan.antenna_scan_mode == 4);
+
+    // data types recorded, one bit per IRIS data type
+    UINT4 mask[5] = {ihd->tcf.dsp.DataMask.dWord0, ihd->tcf.dsp.DataMask.dWord1, ihd->tcf.dsp.DataMask.dWord2,
+                     ihd->tcf.dsp.DataMask.dWord3, ihd->tcf.dsp.DataMask.dWord4};
+
+    for (int iSweep = 0; iSweep < nSweeps; iSweep++) {
+        vol2birdCatalogScan_t* scan = &entry->scans[entry->nScans];
+
+        scan->elangle = ppi ? (float) (ihd->tcf.scan.u.ppi.list_of_elevation_angles_to_scan[iSweep] * (360.0 / 65536.0)) : 0;
+        scan->nrays = ihd->icf.number_of_rays_in_sweep;
+        scan->nbins = ihd->tcf.rng.number_of_output_range_bins;
+        scan->rscale = (float) (ihd->tcf.rng.step_between_output_bins_in_cm / 100.0);
+        scan->quantities[0] = '\0';
+        for (int iType = 0; iType < 160; iType++) {
+            if (mask[iType / 32] & (1u << (iType % 32))) {
+                char* quantity = mapDataType(iType);
+                if (quantity != NULL) catalogAddQuantity(scan, quantity);
+            }
+        }
+        entry->nScans++;
+    }
+
+    result = 0;
+
+done:
+    RAVE_FREE(phd);
+    RAVE_FREE(ihd);
+    RAVE_FREE(productRecord);
+    RAVE_FREE(ingestRecord);
+    IRISfile_close(fp);
+    return result;
+}
+#endif
+
+
+// *****************************************************************************
+// Public functions
+// *****************************************************************************
+
+
+int vol2birdCatalogFile(const char* filename, vol2birdCatalogEntry_t* entry) {
+
+    int rslFileType = 0;
+
+    memset(entry, 0, sizeof(vol2birdCatalogEntry_t));
+    entry->status = -1;
+    entry->format = vol2birdProbeFormat(filename, &rslFileType);
+
+    switch (entry->format) {
+    case radarDataFormat_ODIM:
+        // HDF5 is not thread-safe
+        #pragma omp critical(hdf5)
+        entry->status = catalogODIM(filename, entry);
+        break;
+    case radarDataFormat_RSL:
+        #ifdef RSL
+        if (rslFileType == WSR88D_FILE) {
+            entry->status = catalogLevel2(filename, entry);
+        }
+        #endif
+        break;
+    case radarDataFormat_IRIS:
+        #ifdef IRIS
+        entry->status = catalogIRIS(filename, entry);
+        #endif
+        break;
+    default:
+        break;
+    }
+
+    return entry->status;
+}
+
+
+int vol2birdCatalogFiles(char* filenames[], int nFiles, vol2birdCatalogEntry_t* entries) {
+
+    int nRead = 0;
+
+    #pragma omp parallel for schedule(dynamic,1) reduction(+:nRead)
+    for (int iFile = 0; iFile < nFiles; iFile++) {
+        if (vol2birdCatalogFile(filenames[iFile], &entries[iFile]) == 0) {
+            nRead++;
+        }
+    }
+
+    return nRead;
+}
@@ -8,8 +8,15 @@
 #include "constants.h"
 #include "libvol2bird.h"
 #include "librender.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
 
 #ifdef MISTNET
 #include "../libmistnet/libmistnet.h"
@@ -33,13 +40,15 @@ RaveObjectList_t* polarVolumeToCartesianList(PolarVolume_t* pvol, long dim, long
 
 Cartesian_t* polarScanToCartesian(PolarScan_t* scan, long dim, long res, double init);
 
+int polarVolumeToPPI(PolarVolume_t* pvol, const char* quantity, long dim, long res, double* ppi);
+
 void free4DTensor(float ****tensor, int dim1, int dim2, int dim3);
 
 float**** create4DTensor(float *array, int dim1, int dim2, int dim3, int dim4);
 
-int addTensorToPolarVolume(PolarVolume_t* pvol, float ****tensor, int dim1, int dim2, int dim3, int dim4, long res);
+int addTensorToPolarVolume(PolarVolume_t* pvol, float *tensor, int dim1, int dim2, int dim3, int dim4, long res);
 
-int addClassificationToPolarVolume(PolarVolume_t* pvol, float ****tensor, int dim1, int dim2, int dim3, int dim4, long res);
+int addClassificationToPolarVolume(PolarVolume_t* pvol, float *tensor, int dim1, int dim2, int dim3, int dim4, long res);
 
 double*** init3DTensor(int dim1, int dim2, int dim3, double init);
 
@@ -51,6 +60,12 @@ float* flatten3DTensor(double ***tensor, int dim1, int dim2, int dim3);
 
 int polarVolumeTo3DTensor(PolarVolume_t* pvol, double ****tensor, int dim, long res, int nParam);
 
+float* newTensor(size_t size);
+
+void freeTensor(float* tensor);
+
+int polarVolumeToTensor(PolarVolume_t* pvol, float* tensor, long dim, long res, int nChannels);
+
 PolarVolume_t* PolarVolume_selectScansByElevation(PolarVolume_t* volume, float elevs[], int nElevs);
 
 PolarVolume_t* PolarVolume_selectScansByScanUse(PolarVolume_t* volume, vol2birdScanUse_t *scanUse, int nScansUsed);
@@ -58,7 +73,11 @@ PolarVolume_t* PolarVolume_selectScansByScanUse(PolarVolume_t* volume, vol2birdS
 PolarScan_t* PolarVolume_getScanClosestToElevation_vol2bird(PolarVolume_t* volume, double elev);
 
 #ifdef MISTNET
-int run_mistnet(float* tensor_in, float** tensor_out, const char* model_path, int tensor_size);
+int run_mistnet(float* tensor_in, float** tensor_out, const char* model_path, int channels, int height, int width);
+
+int run_mistnet_batch(float* tensor_in, float** tensor_out, const char* model_path, int batch_size, int channels, int height, int width);
+
+void set_mistnet_threads(int n);
 #endif
 
 #ifndef MIN
@@ -73,11 +92,273 @@ int run_mistnet(float* tensor_in, float** tensor_out, const char* model_path, in
 #define ABS(x) (((x) < 0) ? (-(x)) : (x))
 #endif
 
+// alignment in bytes of the tensors allocated by newTensor()
+#define TENSOR_ALIGNMENT 64
+
+// number of polar <-> Cartesian index maps kept between calls
+#define RENDER_MAP_CACHE_SIZE 8
+
+// maximum number of MistNet outputs kept in memory, see the mistNetCache option
+#define MISTNET_CACHE_MAX_SIZE 16
+
+// index maps between the gates of a scan and the pixels of a dim x dim
+// Cartesian grid of resolution res centered on the radar
+typedef struct renderMap {
+    long nRays;
+    long nBins;
+    double rscale;
+    double rstart;
+    double elangle;
+    int hasAstart;
+    double astart;
+    long dim;
+    long res;
+    int cached;     // whether the map is owned by the cache
+    int users;      // number of getRenderMap() calls not yet released
+    int* pixelGate; // gate ray*nBins+bin sampled by pixel x*dim+y, -1 if none
+    int* gatePixel; // pixel x*dim+y containing gate ray*nBins+bin, clamped to the grid;
+                    // stored as -1-pixel for gates outside the grid less its bleed
+} renderMap_t;
+
+static renderMap_t* renderMapCache[RENDER_MAP_CACHE_SIZE];
+static int renderMapCacheNext = 0;
+
 
 /**
  * FUNCTION BODIES
  **/
 
+static void freeRenderMap(renderMap_t* map){
+    if (map == NULL) return;
+    free(map->pixelGate);
+    free(map->gatePixel);
+    free(map);
+}
+
+/**
+ * Return the index maps between a scan and a Cartesian grid
+ *
+ * Maps are cached by scan geometry (rays, bins, range scale and start,
+ * elevation and azimuth start) and grid, so the atan2, sqrt and
+ * distance2range per pixel are computed once for all scans and volumes
+ * of the same geometry. Scans with azimuthal navigation arrays
+ * (startazA/stopazA) get a map of their own. Release with releaseRenderMap();
+ * maps in use stay valid when evicted from the cache. The cache is not
+ * thread-safe, maps are to be requested outside parallel regions.
+ *
+ * @param scan - a polar scan
+ * @param dim - number of pixels in X and Y dimension of the grid
+ * @param res - pixel size in meter
+ * @return the index maps, or NULL on failure
+ */
+static renderMap_t* getRenderMap(PolarScan_t* scan, long dim, long res){
+    long nRays = PolarScan_getNrays(scan);
+    long nBins = PolarScan_getNbins(scan);
+    double rscale = PolarScan_getRscale(scan);
+    double rstart = PolarScan_getRstart(scan);
+    double elev = PolarScan_getElangle(scan);
+    int hasAstart = FALSE;
+    double astart = 0;
+    int navigated = PolarScan_useAzimuthalNavInformation(scan) &&
+        (PolarScan_hasAttribute(scan, "how/startazA") || PolarScan_hasAttribute(scan, "how/stopazA"));
+
+    if (PolarScan_hasAttribute(scan, "how/astart")){
+        RaveAttribute_t* attr = PolarScan_getAttribute(scan, "how/astart");
+        hasAstart = RaveAttribute_getDouble(attr, &astart);
+        RAVE_OBJECT_RELEASE(attr);
+    }
+
+    if (!navigated){
+        for (int i = 0; i < RENDER_MAP_CACHE_SIZE; i++){
+            renderMap_t* map = renderMapCache[i];
+            if (map != NULL && map->nRays == nRays && map->nBins == nBins && map->rscale == rscale &&
+                map->rstart == rstart && map->elangle == elev && map->hasAstart == hasAstart &&
+                map->astart == astart && map->dim == dim && map->res == res){
+                map->users++;
+                return map;
+            }
+        }
+    }
+
+    renderMap_t* map = (renderMap_t*) calloc(1, sizeof(renderMap_t));
+    if (map == NULL){
+        vol2bird_err_printf("failed to allocate memory for render map\n");
+        return NULL;
+    }
+    map->nRays = nRays;
+    map->nBins = nBins;
+    map->rscale = rscale;
+    map->rstart = rstart;
+    map->elangle = elev;
+    map->hasAstart = hasAstart;
+    map->astart = astart;
+    map->dim = dim;
+    map->res = res;
+    map->users = 1;
+    map->pixelGate = (int*) malloc(dim*dim*sizeof(int));
+    map->gatePixel = (int*) malloc(nRays*nBins*sizeof(int));
+    if (map->pixelGate == NULL || map->gatePixel == NULL){
+        vol2bird_err_printf("failed to allocate memory for render map\n");
+        freeRenderMap(map);
+        return NULL;
+    }
+
+    // pixel -> gate, sampled as PolarScan_getParameterValueAtAzimuthAndRange() would
+    for(long x = 0; x<dim; x++){
+        for(long y = 0; y<dim; y++){
+            double xx=((double)res)*((double)(x-dim/2));
+            double yy=((double)res)*((double)(y-dim/2));
+            double azim=atan2(yy,xx);
+            double distance=sqrt(SQUARE(xx)+SQUARE(yy));
+            double range=distance2range(distance,elev);
+            int ray, bin;
+            if (PolarScan_getIndexFromAzimuthAndRange(scan, azim, range, PolarScanSelectionMethod_ROUND, PolarScanSelectionMethod_FLOOR, 0, &ray, &bin)){
+                map->pixelGate[x*dim+y] = ray*nBins+bin;
+            }
+            else{
+                map->pixelGate[x*dim+y] = -1;
+            }
+        }
+    }
+
+    // gate -> pixel
+    for(int iAzim=0; iAzim<nRays; iAzim++){
+        for(int iRang=0; iRang<nBins; iRang++){
+            //range in meter
+            double range = iRang*rscale;
+            //azimuth in radials
+            double azim = iAzim*2*PI/nRays;
+            // ground distance in meter
+            double distance=range2distance(range,elev);
+            // Cartesian x coordinate, with radar at center
+            double xx=distance*cos(azim);
+            // Cartesian y coordinate, with radar at center
+            double yy=distance*sin(azim);
+            // Cartesian grid index x
+            int x=MIN(dim-1,MAX(0,ROUND(xx/res+dim/2)));
+            // Cartesian grid index y
+            int y=MIN(dim-1,MAX(0,ROUND(yy/res+dim/2)));
+            int pixel = x*dim+y;
+            // gates outside the grid less its bleed
+            if(ABS(xx) > res * (dim-MISTNET_BLEED)/2 || ABS(yy) > res * (dim-MISTNET_BLEED)/2){
+                pixel = -1-pixel;
+            }
+            map->gatePixel[iAzim*nBins+iRang] = pixel;
+        }
+    }
+
+    if (!navigated){
+        renderMap_t* evicted = renderMapCache[renderMapCacheNext];
+        if (evicted != NULL){
+            // freed by its last releaseRenderMap() when still in use
+            evicted->cached = FALSE;
+            if (evicted->users <= 0) freeRenderMap(evicted);
+        }
+        renderMapCache[renderMapCacheNext] = map;
+        renderMapCacheNext = (renderMapCacheNext + 1) % RENDER_MAP_CACHE_SIZE;
+        map->cached = TRUE;
+    }
+
+    return map;
+}
+
+static void releaseRenderMap(renderMap_t* map){
+    if (map == NULL) return;
+    map->users--;
+    if (!map->cached && map->users <= 0) freeRenderMap(map);
+}
+
+// value of element 'index' of a raw data buffer of type 'type'
+static double rawValue(void* data, RaveDataType type, long index){
+    switch(type){
+        case RaveDataType_CHAR: return ((char*) data)[index];
+        case RaveDataType_UCHAR: return ((unsigned char*) data)[index];
+        case RaveDataType_SHORT: return ((short*) data)[index];
+        case RaveDataType_USHORT: return ((unsigned short*) data)[index];
+        case RaveDataType_INT: return ((int*) data)[index];
+        case RaveDataType_UINT: return ((unsigned int*) data)[index];
+        case RaveDataType_LONG: return ((long*) data)[index];
+        case RaveDataType_ULONG: return ((unsigned long*) data)[index];
+        case RaveDataType_FLOAT: return ((float*) data)[index];
+        case RaveDataType_DOUBLE: return ((double*) data)[index];
+        default: return 0;
+    }
+}
+
+// a dim x dim image to be filled from a scan parameter, see renderJobs()
+typedef struct renderJob {
+    double* output;     // dim x dim pixels, indexed y*dim+x
+    void* data;         // raw data of the scan parameter, NULL when absent
+    RaveDataType type;
+    double nodata;
+    double undetect;
+    double gain;
+    double offset;
+    double nodataOut;   // value of pixels without data
+    double undetectOut; // value of pixels with undetect gates
+    renderMap_t* map;
+} renderJob_t;
+
+static void initRenderJob(renderJob_t* job, double* output, PolarScanParam_t* polarScanParam, renderMap_t* map, double nodataOut, double undetectOut){
+    job->output = output;
+    job->data = PolarScanParam_getData(polarScanParam);
+    job->type = PolarScanParam_getDataType(polarScanParam);
+    job->nodata = PolarScanParam_getNodata(polarScanParam);
+    job->undetect = PolarScanParam_getUndetect(polarScanParam);
+    job->gain = PolarScanParam_getGain(polarScanParam);
+    job->offset = PolarScanParam_getOffset(polarScanParam);
+    job->nodataOut = nodataOut;
+    job->undetectOut = undetectOut;
+    job->map = map;
+}
+
+// fills row y of the image of a render job
+static void renderRow(renderJob_t* job, long y){
+    long dim = job->map->dim;
+    int* pixelGate = job->map->pixelGate;
+    double* row = job->output + y*dim;
+
+    for(long x = 0; x<dim; x++){
+        int gate = pixelGate[x*dim+y];
+        double value = job->nodataOut;
+        if(gate >= 0 && job->data != NULL){
+            double raw = rawValue(job->data, job->type, gate);
+            if(raw == job->nodata){
+                value = job->nodataOut;
+            }
+            else if(raw == job->undetect){
+                value = job->undetectOut;
+            }
+            else{
+                value = job->offset + raw*job->gain;
+            }
+        }
+        row[x] = value;
+    }
+}
+
+/**
+ * Fill the images of render jobs, by gathering from the raw buffers of their scan parameters
+ *
+ * Rows of all images are spread over the OpenMP threads, which write disjoint
+ * rows of raw buffers only. The RAVE objects and render maps of the jobs are
+ * to be created by the caller beforehand, as neither is thread-safe.
+ *
+ * @param jobs - the render jobs
+ * @param nJobs - number of render jobs
+ * @param dim - number of pixels in X and Y dimension of the images
+ */
+static void renderJobs(renderJob_t* jobs, int nJobs, long dim){
+    long nRows = nJobs*dim;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for(long iRow = 0; iRow < nRows; iRow++){
+        renderRow(&jobs[iRow/dim], iRow%dim);
+    }
+}
+
 /**
  * Convert from ground distance and elevation to slant range.
  *
@@ -240,6 +521,17 @@ Cartesian_t* polarVolumeToCartesian(PolarVolume_t* pvol, long dim, long res, dou
     
     if(nScans<=0){
         vol2bird_err_printf("Error: polar volume contains no scans\n");
+        RAVE_OBJECT_RELEASE(cartesian);
+        return NULL;
+    }
+
+    // the parameters and render maps are created serially, the grids are then filled in parallel
+    renderMap_t** maps = (renderMap_t**) calloc(nScans, sizeof(renderMap_t*));
+    renderJob_t* jobs = NULL;
+    int nJobs = 0;
+    if (maps == NULL){
+        vol2bird_err_printf("failed to allocate memory for render maps\n");
+        RAVE_OBJECT_RELEASE(cartesian);
         return NULL;
     }
 
@@ -249,16 +541,28 @@ Cartesian_t* polarVolumeToCartesian(PolarVolume_t* pvol, long dim, long res, dou
         // extract the scan object from the volume object
         scan = PolarVolume_getScan(pvol,iScan);
         
-        double elev = PolarScan_getElangle(scan);
-        
         scanParameterNames = PolarScan_getParameterNames(scan);
+        int nParams = RaveList_size(scanParameterNames);
         
-        if(RaveList_size(scanParameterNames)<=0){
+        if(nParams<=0){
             vol2bird_err_printf("Warning: ignoring scan without scan parameters\n");
+            RaveList_freeAndDestroy(&scanParameterNames);
+            RAVE_OBJECT_RELEASE(scan);
             continue;            
         }
+        
+        maps[iScan] = getRenderMap(scan, dim, res);
+        renderJob_t* grown = (renderJob_t*) realloc(jobs, (nJobs + nParams)*sizeof(renderJob_t));
+        if(maps[iScan] == NULL || grown == NULL){
+            if(grown == NULL) vol2bird_err_printf("failed to allocate memory for render jobs\n");
+            else jobs = grown;
+            RaveList_freeAndDestroy(&scanParameterNames);
+            RAVE_OBJECT_RELEASE(scan);
+            continue;
+        }
+        jobs = grown;
                 
-        for(int iParam = 0; iParam<RaveList_size(scanParameterNames); iParam++){
+        for(int iParam = 0; iParam<nParams; iParam++){
             // retrieve name of the scan parameter
             scanParameterName = RaveList_get(scanParameterNames, iParam);
             
@@ -273,39 +577,35 @@ Cartesian_t* polarVolumeToCartesian(PolarVolume_t* pvol, long dim, long res, dou
             parameterName = RaveUtilities_trimText(parameterNameFull, strlen(parameterNameFull));
 
             // create a cartesian scan parameter with the same name
+            PolarScanParam_t* polarScanParam = PolarScan_getParameter(scan, scanParameterName);
             cartesianParam = Cartesian_createParameter(cartesian,parameterName,RaveDataType_DOUBLE, init);
-            CartesianParam_setNodata(cartesianParam, PolarScanParam_getNodata(PolarScan_getParameter(scan, scanParameterName)));
-            CartesianParam_setUndetect(cartesianParam, PolarScanParam_getUndetect(PolarScan_getParameter(scan, scanParameterName)));
-            
-            double range,azim,distance;
-            double value;
-            
-            RaveValueType a;
-            // loop over the grid, and fill it
-            for(long x = 0; x<dim; x++){
-                for(long y = 0; y<dim; y++){
-                    double xx=((double)res)*((double)(x-dim/2));
-                    double yy=((double)res)*((double)(y-dim/2));
-                    azim=atan2(yy,xx);
-                    distance=sqrt(SQUARE(xx)+SQUARE(yy));
-                    range=distance2range(distance,elev);
-                    a=PolarScan_getConvertedParameterValueAtAzimuthAndRange(scan,scanParameterName,azim,range,&value);
-                    if(a!=RaveValueType_DATA){
-                        PolarScan_getParameterValueAtAzimuthAndRange(scan,scanParameterName,azim,range,&value);
-                    }
-                    CartesianParam_setValue(cartesianParam, x, y, value);
-                }
+            if(cartesianParam != NULL){
+                CartesianParam_setNodata(cartesianParam, PolarScanParam_getNodata(polarScanParam));
+                CartesianParam_setUndetect(cartesianParam, PolarScanParam_getUndetect(polarScanParam));
+
+                // the grid is filled below, pixels receive the raw nodata / undetect values
+                initRenderJob(&jobs[nJobs++], (double*) CartesianParam_getData(cartesianParam), polarScanParam, maps[iScan],
+                    PolarScanParam_getNodata(polarScanParam), PolarScanParam_getUndetect(polarScanParam));
             }
-            
-            // add the cartesian scan parameter to the cartesian object
-            Cartesian_addParameter(cartesian,cartesianParam);
+            RAVE_OBJECT_RELEASE(polarScanParam);
             
             free(parameterNameFull);
             RAVE_FREE(parameterName);
             RAVE_OBJECT_RELEASE(cartesianParam);
         } // iParam
         
+        RaveList_freeAndDestroy(&scanParameterNames);
+        RAVE_OBJECT_RELEASE(scan);
     } // iElev
+
+    // the scan parameters are owned by the volume, and the Cartesian parameters by the grid
+    renderJobs(jobs, nJobs, dim);
+
+    free(jobs);
+    for (int iScan = 0; iScan < nScans; iScan++) {
+        releaseRenderMap(maps[iScan]);
+    }
+    free(maps);
     
     return cartesian;
 }
@@ -391,8 +691,6 @@ Cartesian_t* polarScanToCartesian(PolarScan_t* scan, long dim, long res, double
     //Cartesian_setAreaExtent(cartesian, -res*dim/2, -res*dim/2, res*dim/2, res*dim/2);
 
     
-    double elev = PolarScan_getElangle(scan);
-    
     scanParameterNames = PolarScan_getParameterNames(scan);
     
     if(RaveList_size(scanParameterNames)<=0){
@@ -401,48 +699,105 @@ Cartesian_t* polarScanToCartesian(PolarScan_t* scan, long dim, long res, double
         RAVE_OBJECT_RELEASE(cartesian);
         return NULL;
     }
+
+    int nParams = RaveList_size(scanParameterNames);
+    renderMap_t* map = getRenderMap(scan, dim, res);
+    renderJob_t* jobs = (renderJob_t*) malloc(nParams*sizeof(renderJob_t));
+    int nJobs = 0;
+    if(map == NULL || jobs == NULL){
+        releaseRenderMap(map);
+        free(jobs);
+        RaveList_freeAndDestroy(&scanParameterNames);
+        RAVE_OBJECT_RELEASE(cartesian);
+        return NULL;
+    }
             
-    for(int iParam = 0; iParam<RaveList_size(scanParameterNames); iParam++){
+    for(int iParam = 0; iParam<nParams; iParam++){
         // retrieve name of the scan parameter
         scanParameterName = (char*)RaveList_get(scanParameterNames, iParam);
         polarScanParam = PolarScan_getParameter(scan, scanParameterName);
         
         // create a cartesian scan parameter with the same name
         cartesianParam = Cartesian_createParameter(cartesian, scanParameterName, RaveDataType_DOUBLE, init);
-        CartesianParam_setNodata(cartesianParam, PolarScanParam_getNodata(polarScanParam));
-        CartesianParam_setUndetect(cartesianParam, PolarScanParam_getUndetect(polarScanParam));
+        if(cartesianParam != NULL){
+            CartesianParam_setNodata(cartesianParam, PolarScanParam_getNodata(polarScanParam));
+            CartesianParam_setUndetect(cartesianParam, PolarScanParam_getUndetect(polarScanParam));
 
-        double range,azim,distance;
-        double value;
-        
-        RaveValueType a;
-        // loop over the grid, and fill it
-        for(long x = 0; x<dim; x++){
-            for(long y = 0; y<dim; y++){
-                double xx=((double)res)*((double)(x-dim/2));
-                double yy=((double)res)*((double)(y-dim/2));
-                azim=atan2(yy,xx);
-                distance=sqrt(SQUARE(xx)+SQUARE(yy));
-                range=distance2range(distance,elev);
-                a = PolarScan_getConvertedParameterValueAtAzimuthAndRange(scan, scanParameterName, azim, range, &value);
-                if(a != RaveValueType_DATA){
-                    PolarScan_getParameterValueAtAzimuthAndRange(scan, scanParameterName, azim, range, &value);
-                }
-                CartesianParam_setValue(cartesianParam, x, y, value);
-            }
+            // the grid is filled below, pixels receive the raw nodata / undetect values
+            initRenderJob(&jobs[nJobs++], (double*) CartesianParam_getData(cartesianParam), polarScanParam, map,
+                PolarScanParam_getNodata(polarScanParam), PolarScanParam_getUndetect(polarScanParam));
         }
         
-        // add the cartesian scan parameter to the cartesian object
-        Cartesian_addParameter(cartesian, cartesianParam);
-        
         RAVE_OBJECT_RELEASE(polarScanParam);
         RAVE_OBJECT_RELEASE(cartesianParam);
     } // iParam
+
+    // fill the grids of all parameters in parallel
+    renderJobs(jobs, nJobs, dim);
     
+    free(jobs);
+    releaseRenderMap(map);
     RaveList_freeAndDestroy(&scanParameterNames);
     return cartesian;
 }
 
+/**
+ * Render a quantity of all scans of a polar volume to PPI images
+ *
+ * The images are filled in parallel when OpenMP is available. Pixels
+ * without data, including gates with the nodata or undetect value,
+ * and images of scans without the quantity are set to NAN.
+ *
+ * @param pvol - a polar volume
+ * @param quantity - the quantity to render, e.g. DBZH
+ * @param dim - number of pixels in X and Y dimension of the images
+ * @param res - pixel size in meter
+ * @param ppi - output, nScans images of dim x dim pixels. Pixel y*dim+x of an image
+ * lies res*(x-dim/2) meter north and res*(y-dim/2) meter east of the radar
+ * @return 0 on success, -1 otherwise
+ */
+int polarVolumeToPPI(PolarVolume_t* pvol, const char* quantity, long dim, long res, double* ppi){
+    int nScans = PolarVolume_getNumberOfScans(pvol);
+    long nPixels = dim*dim;
+
+    renderMap_t** maps = (renderMap_t**) calloc(nScans > 0 ? nScans : 1, sizeof(renderMap_t*));
+    renderJob_t* jobs = (renderJob_t*) malloc((nScans > 0 ? nScans : 1)*sizeof(renderJob_t));
+    int nJobs = 0;
+    if (maps == NULL || jobs == NULL){
+        vol2bird_err_printf("failed to allocate memory for render jobs\n");
+        free(maps);
+        free(jobs);
+        return -1;
+    }
+
+    for (int iScan = 0; iScan < nScans; iScan++){
+        double* image = ppi + iScan*nPixels;
+        PolarScan_t* scan = PolarVolume_getScan(pvol, iScan);
+        PolarScanParam_t* param = PolarScan_getParameter(scan, quantity);
+        if (param != NULL){
+            maps[iScan] = getRenderMap(scan, dim, res);
+        }
+        if (maps[iScan] != NULL){
+            initRenderJob(&jobs[nJobs++], image, param, maps[iScan], NAN, NAN);
+        }
+        else{
+            for (long i = 0; i < nPixels; i++) image[i] = NAN;
+        }
+        RAVE_OBJECT_RELEASE(param);
+        RAVE_OBJECT_RELEASE(scan);
+    }
+
+    renderJobs(jobs, nJobs, dim);
+
+    free(jobs);
+    for (int iScan = 0; iScan < nScans; iScan++){
+        releaseRenderMap(maps[iScan]);
+    }
+    free(maps);
+
+    return 0;
+}
+
 
 float**** create4DTensor(float *array, int dim1, int dim2, int dim3, int dim4) {
     float ****tensor = (float ****)malloc(dim1 * sizeof(float***));
@@ -722,6 +1077,140 @@ int polarVolumeTo3DTensor(PolarVolume_t* pvol, double ****tensor, int dim, long
 }
 
 
+/**
+ * Allocate a contiguous float tensor of 'size' elements, aligned to
+ * TENSOR_ALIGNMENT bytes. Release with freeTensor().
+ */
+float* newTensor(size_t size){
+    void* tensor = NULL;
+#ifdef _WIN32
+    tensor = _aligned_malloc(size*sizeof(float), TENSOR_ALIGNMENT);
+#else
+    if (posix_memalign(&tensor, TENSOR_ALIGNMENT, size*sizeof(float)) != 0){
+        tensor = NULL;
+    }
+#endif
+    if (tensor == NULL){
+        vol2bird_err_printf("failed to allocate tensor of %lu elements\n", (unsigned long) size);
+    }
+    return (float*) tensor;
+}
+
+void freeTensor(float* tensor){
+#ifdef _WIN32
+    _aligned_free(tensor);
+#else
+    free(tensor);
+#endif
+}
+
+/**
+ * Render the scans of a polar volume into a contiguous float tensor
+ *
+ * The DBZ, VRAD and WRAD parameters of scan iScan are written to channels
+ * iScan, nScans+iScan and 2*nScans+iScan of a [channel][x][y] tensor, which
+ * is the NCHW layout of the MistNet model input for a batch of one volume.
+ * Pixels without data are set to NAN, channels without a parameter keep
+ * MISTNET_INIT.
+ *
+ * @param pvol - a polar volume
+ * @param tensor - output, nChannels*dim*dim values
+ * @param dim - number of pixels in X and Y dimension of the grid
+ * @param res - pixel size in meter
+ * @param nChannels - number of channels of the tensor
+ * @return 0 on success, -1 otherwise
+ */
+int polarVolumeToTensor(PolarVolume_t* pvol, float* tensor, long dim, long res, int nChannels){
+    const char* prefixes[3] = {"DBZ", "VRAD", "WRAD"};
+    long nPixels = dim*dim;
+    int nScans = PolarVolume_getNumberOfScans(pvol);
+
+    if(nScans<=0){
+        vol2bird_err_printf("Error: polar volume contains no scans\n");
+        return -1;
+    }
+
+    for (long i = 0; i < nChannels*nPixels; i++){
+        tensor[i] = MISTNET_INIT;
+    }
+
+    for (int iScan = 0; iScan < nScans; iScan++){
+        PolarScan_t* scan = PolarVolume_getScan(pvol, iScan);
+        RaveList_t* scanParameterNames = PolarScan_getParameterNames(scan);
+        renderMap_t* map = getRenderMap(scan, dim, res);
+        int count[3] = {0, 0, 0};
+
+        if (map == NULL){
+            RaveList_freeAndDestroy(&scanParameterNames);
+            RAVE_OBJECT_RELEASE(scan);
+            return -1;
+        }
+
+        // parameters are stored in order DBZ, VRAD, WRAD
+        for (int iOrder = 0; iOrder < 3; iOrder++){
+            for (int iParam = 0; iParam < RaveList_size(scanParameterNames); iParam++){
+                char* parameterName = (char*) RaveList_get(scanParameterNames, iParam);
+                if (strncmp(prefixes[iOrder], parameterName, strlen(prefixes[iOrder])) != 0){
+                    continue;
+                }
+
+                int channel = iScan + nScans*iOrder;
+                if (channel >= nChannels){
+                    vol2bird_err_printf( "Error: exceeding 3D tensor dimension\n");
+                    releaseRenderMap(map);
+                    RaveList_freeAndDestroy(&scanParameterNames);
+                    RAVE_OBJECT_RELEASE(scan);
+                    return -1;
+                }
+                count[iOrder]++;
+
+                PolarScanParam_t* param = PolarScan_getParameter(scan, parameterName);
+                void* data = PolarScanParam_getData(param);
+                RaveDataType type = PolarScanParam_getDataType(param);
+                double nodata = PolarScanParam_getNodata(param);
+                double undetect = PolarScanParam_getUndetect(param);
+                double gain = PolarScanParam_getGain(param);
+                double offset = PolarScanParam_getOffset(param);
+                float* channelData = tensor + channel*nPixels;
+                float* dbzData = tensor + iScan*nPixels;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+                for (long iPixel = 0; iPixel < nPixels; iPixel++){
+                    int gate = map->pixelGate[iPixel];
+                    float value = NAN;
+                    if (gate >= 0 && data != NULL){
+                        double raw = rawValue(data, type, gate);
+                        if (raw != nodata && raw != undetect){
+                            value = offset + raw*gain;
+                        }
+                    }
+                    // only copy radial velocity and spectrum width values that have a corresponding reflectivity value
+                    // this is to account for occasional sweeps where radial velocity extends to shorter ranges than reflectivity
+                    if (MISTNET_REQUIRE_DBZ && iOrder > 0 && isnan(dbzData[iPixel])){
+                        value = NAN;
+                    }
+                    channelData[iPixel] = value;
+                }
+
+                RAVE_OBJECT_RELEASE(param);
+            }
+        }
+
+        if(count[0] == 0) vol2bird_err_printf( "Warning: no reflectivity data found for MistNet input scan %i, initializing with values %i instead.\n", iScan, MISTNET_INIT);
+        if(count[1] == 0) vol2bird_err_printf( "Warning: no radial velocity data found for MistNet input scan %i, initializing with values %i instead.\n", iScan, MISTNET_INIT);
+        if(count[2] == 0) vol2bird_err_printf( "Warning: no spectrum width data found for MistNet input scan %i, initializing with values %i instead.\n", iScan, MISTNET_INIT);
+
+        releaseRenderMap(map);
+        RaveList_freeAndDestroy(&scanParameterNames);
+        RAVE_OBJECT_RELEASE(scan);
+    }
+
+    return 0;
+}
+
+
 /**
  * Return a polar volume containing a selection of scans by elevation
  * 
@@ -877,7 +1366,98 @@ PolarScan_t* PolarVolume_getScanClosestToElevation_vol2bird(PolarVolume_t* volum
     return(scan);
 }
 
-int addTensorToPolarVolume(PolarVolume_t* pvol, float ****tensor, int dim1, int dim2, int dim3, int dim4, long res){
+// index of element [i][j][k][l] of a contiguous dim1 x dim2 x dim3 x dim4 tensor
+#define TENSOR_INDEX(i,j,k,l,dim2,dim3,dim4) ((((size_t)(i)*(dim2)+(j))*(dim3)+(k))*(dim4)+(l))
+
+/**
+ * Average MistNet weather probability over the scans, for each pixel of the grid
+ *
+ * @param tensor - the model output, a contiguous [class][scan][x][y] tensor
+ * @param dim2 - number of scans
+ * @param dim3 - X dimension of the grid
+ * @param dim4 - Y dimension of the grid
+ * @return dim3 x dim4 averages indexed x*dim4+y, to be freed by the caller, or NULL on failure
+ */
+static float* weatherAverageMap(float *tensor, int dim2, int dim3, int dim4){
+    long nPixels = (long) dim3*dim4;
+    float* average = (float*) calloc(nPixels, sizeof(float));
+    if (average == NULL){
+        vol2bird_err_printf("failed to allocate memory for MistNet weather average\n");
+        return NULL;
+    }
+
+    for(int i=0; i<dim2; i++){
+        float* weather = tensor + TENSOR_INDEX(MISTNET_WEATHER_INDEX,i,0,0,dim2,dim3,dim4);
+        for(long pixel=0; pixel<nPixels; pixel++){
+            average[pixel]+=weather[pixel]/dim2;
+        }
+    }
+
+    return average;
+}
+
+// gathers pixel values into the gates of a raw data buffer of C type 'ctype'
+#define GATHER_GATES(ctype) {                                       \
+    ctype* gates = (ctype*) data;                                   \
+    for(long gate=0; gate<nGates; gate++){                          \
+        int pixel = gatePixel[gate];                                \
+        if(pixel < 0){                                              \
+            if(!clamp) continue;                                    \
+            pixel = -1-pixel;                                       \
+        }                                                           \
+        gates[gate] = (ctype) pixels[pixel];                        \
+    }                                                               \
+}
+
+/**
+ * Fill a scan parameter with the values of the Cartesian pixels that its gates map to
+ *
+ * A single pass over the gates through the gate to pixel map of the scan,
+ * writing the raw data buffer of the parameter directly.
+ *
+ * @param param - a parameter of the scan of map, with gain 1 and offset 0
+ * @param map - the index maps of the scan
+ * @param pixels - values of the dim x dim pixels, indexed x*dim+y
+ * @param clamp - when TRUE, gates outside the grid less its bleed take the value of the
+ * nearest edge pixel, otherwise they are left unchanged
+ */
+static void gatherScanParam(PolarScanParam_t* param, renderMap_t* map, float* pixels, int clamp){
+    long nGates = map->nRays*map->nBins;
+    int* gatePixel = map->gatePixel;
+    void* data = PolarScanParam_getData(param);
+
+    switch(PolarScanParam_getDataType(param)){
+        case RaveDataType_SHORT: GATHER_GATES(short); break;
+        case RaveDataType_INT: GATHER_GATES(int); break;
+        case RaveDataType_FLOAT: GATHER_GATES(float); break;
+        case RaveDataType_DOUBLE: GATHER_GATES(double); break;
+        default:
+            for(long gate=0; gate<nGates; gate++){
+                int pixel = gatePixel[gate];
+                if(pixel < 0){
+                    if(!clamp) continue;
+                    pixel = -1-pixel;
+                }
+                PolarScanParam_setValue(param, gate % map->nBins, gate / map->nBins, pixels[pixel]);
+            }
+    }
+}
+
+#undef GATHER_GATES
+
+/**
+ * Add the MistNet class probabilities and classification to the scans of a polar volume
+ *
+ * @param pvol - the MistNet input scans
+ * @param tensor - the model output, a contiguous [class][scan][x][y] tensor
+ * @param dim1 - number of classes
+ * @param dim2 - number of scans
+ * @param dim3 - X dimension of the grid
+ * @param dim4 - Y dimension of the grid
+ * @param res - pixel size in meter
+ * @return 0 on success, -1 otherwise
+ */
+int addTensorToPolarVolume(PolarVolume_t* pvol, float *tensor, int dim1, int dim2, int dim3, int dim4, long res){
     
     RAVE_ASSERT((pvol != NULL), "pvol == NULL");
 
@@ -889,6 +1469,16 @@ int addTensorToPolarVolume(PolarVolume_t* pvol, float ****tensor, int dim1, int
     
     if(nScans != dim2){
         vol2bird_err_printf( "Error: polar volume has %i scans, while tensor has data for %i scans.\n", nScans, dim2);
+        return(-1);
+    }
+
+    long nPixels = (long) dim3*dim4;
+    float* weatherAvg = weatherAverageMap(tensor, dim2, dim3, dim4);
+    float* classification = (float*) malloc(nPixels*sizeof(float));
+    if(weatherAvg == NULL || classification == NULL){
+        free(weatherAvg);
+        free(classification);
+        return(-1);
     }
 
    // iterate over the selected scans in 'volume'
@@ -897,7 +1487,7 @@ int addTensorToPolarVolume(PolarVolume_t* pvol, float ****tensor, int dim1, int
         scan = PolarVolume_getScan(pvol,iScan);
         
         if(PolarScan_hasParameter(scan, "WEATHER")){
-            vol2bird_err_printf( "Warning: scan used multiple times as MistNet input, ignoring segmentation %i/%i\n", iScan+1, MISTNET_N_ELEV);
+            vol2bird_err_printf( "Warning: scan used multiple times as MistNet input, ignoring segmentation %i/%i\n", iScan+1, dim2);
             RAVE_OBJECT_RELEASE(scan);
             continue;
         }
@@ -905,63 +1495,65 @@ int addTensorToPolarVolume(PolarVolume_t* pvol, float ****tensor, int dim1, int
         PolarScanParam_t *mistnetParamWeather = PolarScan_newParam(scan, "WEATHER", RaveDataType_DOUBLE);
         PolarScanParam_t *mistnetParamBiology = PolarScan_newParam(scan, "BIOLOGY", RaveDataType_DOUBLE);
         PolarScanParam_t *mistnetParamBackground= PolarScan_newParam(scan, "BACKGROUND", RaveDataType_DOUBLE);
-        PolarScanParam_t *mistnetParamClassification= PolarScan_newParam(scan, CELLNAME, RaveDataType_INT);
-        
-        long nRang = PolarScan_getNbins(scan);
-        long nAzim = PolarScan_getNrays(scan);
-        double elev = PolarScan_getElangle(scan);
-        double rangeScale = PolarScan_getRscale(scan);
+        PolarScanParam_t *mistnetParamClassification= PolarScan_newParam(scan, CELLNAME, CELLTYPE);
         
-        for(int iRang=0; iRang<nRang; iRang++){
-            for(int iAzim=0; iAzim<nAzim; iAzim++){
-                //range in meter
-                double range = iRang*rangeScale;
-                //azimuth in radials
-                double azim = iAzim*2*PI/nAzim;
-                // ground distance in meter
-                double distance=range2distance(range,elev);
-                // Cartesian x coordinate, with radar at center
-                double xx=distance*cos(azim);
-                // Cartesian y coordinate, with radar at center
-                double yy=distance*sin(azim);
-                // do not assign values outside the mistnet grid
-                if(ABS(xx) > MISTNET_RESOLUTION * (MISTNET_DIMENSION-MISTNET_BLEED)/2) continue;
-                if(ABS(yy) > MISTNET_RESOLUTION * (MISTNET_DIMENSION-MISTNET_BLEED)/2) continue;
-                // Cartesian grid index x
-                int x=MIN(dim3-1,MAX(0,ROUND(xx/res+dim3/2)));
-                // Cartesian grid index y
-                int y=MIN(dim4-1,MAX(0,ROUND(yy/res+dim4/2)));
-                //
-                float valueBackground=tensor[MISTNET_BACKGROUND_INDEX][iScan][x][y];
-                float valueBiology=tensor[MISTNET_BIOLOGY_INDEX][iScan][x][y];
-                float valueWeather=tensor[MISTNET_WEATHER_INDEX][iScan][x][y];
-                float valueWeatherAvg=0;
-                for(int i=0; i<nScans; i++){
-                    valueWeatherAvg+=(tensor[MISTNET_WEATHER_INDEX][i][x][y]/nScans);
-                }
-                int valueClassification = CELLINIT;
-                // post-processing prediction rules for weather, as defined in Lin et al. 2019, doi 10.1111/2041-210X.13280
-                if(valueWeather > MISTNET_WEATHER_THRESHOLD || valueWeatherAvg > MISTNET_SCAN_AVERAGE_WEATHER_THRESHOLD){
-                    valueClassification=MISTNET_WEATHER_CELL_VALUE;
-                }
-                PolarScanParam_setValue(mistnetParamBackground, iRang, iAzim, valueBackground);
-                PolarScanParam_setValue(mistnetParamBiology, iRang, iAzim, valueBiology);
-                PolarScanParam_setValue(mistnetParamWeather, iRang, iAzim, valueWeather);
-                PolarScanParam_setValue(mistnetParamClassification, iRang, iAzim, valueClassification);                
-            }            
+        renderMap_t* map = getRenderMap(scan, dim3, res);
+        if(map == NULL){
+            RAVE_OBJECT_RELEASE(mistnetParamWeather);
+            RAVE_OBJECT_RELEASE(mistnetParamBiology);
+            RAVE_OBJECT_RELEASE(mistnetParamBackground);
+            RAVE_OBJECT_RELEASE(mistnetParamClassification);
+            RAVE_OBJECT_RELEASE(scan);
+            free(weatherAvg);
+            free(classification);
+            return(-1);
+        }
+
+        float* background = tensor + TENSOR_INDEX(MISTNET_BACKGROUND_INDEX,iScan,0,0,dim2,dim3,dim4);
+        float* biology = tensor + TENSOR_INDEX(MISTNET_BIOLOGY_INDEX,iScan,0,0,dim2,dim3,dim4);
+        float* weather = tensor + TENSOR_INDEX(MISTNET_WEATHER_INDEX,iScan,0,0,dim2,dim3,dim4);
+
+        // post-processing prediction rules for weather, as defined in Lin et al. 2019, doi 10.1111/2041-210X.13280
+        for(long pixel=0; pixel<nPixels; pixel++){
+            classification[pixel] = (weather[pixel] > MISTNET_WEATHER_THRESHOLD || weatherAvg[pixel] > MISTNET_SCAN_AVERAGE_WEATHER_THRESHOLD) ?
+                MISTNET_WEATHER_CELL_VALUE : CELLINIT;
         }
+
+        // do not assign values outside the mistnet grid
+        gatherScanParam(mistnetParamBackground, map, background, FALSE);
+        gatherScanParam(mistnetParamBiology, map, biology, FALSE);
+        gatherScanParam(mistnetParamWeather, map, weather, FALSE);
+        gatherScanParam(mistnetParamClassification, map, classification, FALSE);
+
+        releaseRenderMap(map);
         RAVE_OBJECT_RELEASE(mistnetParamWeather);
         RAVE_OBJECT_RELEASE(mistnetParamBiology);
         RAVE_OBJECT_RELEASE(mistnetParamBackground);
         RAVE_OBJECT_RELEASE(mistnetParamClassification);
         RAVE_OBJECT_RELEASE(scan);
     }
+
+    free(weatherAvg);
+    free(classification);
     
     return(0);
 
 }
 
-int addClassificationToPolarVolume(PolarVolume_t* pvol, float ****tensor, int dim1, int dim2, int dim3, int dim4, long res){
+/**
+ * Add the MistNet classification to the scans of a polar volume that were not MistNet input,
+ * using the average weather probability over the input scans
+ *
+ * @param pvol - a polar volume
+ * @param tensor - the model output, a contiguous [class][scan][x][y] tensor
+ * @param dim1 - number of classes
+ * @param dim2 - number of scans
+ * @param dim3 - X dimension of the grid
+ * @param dim4 - Y dimension of the grid
+ * @param res - pixel size in meter
+ * @return 0 on success, -1 otherwise
+ */
+int addClassificationToPolarVolume(PolarVolume_t* pvol, float *tensor, int dim1, int dim2, int dim3, int dim4, long res){
     
     RAVE_ASSERT((pvol != NULL), "pvol == NULL");
 
@@ -970,6 +1562,19 @@ int addClassificationToPolarVolume(PolarVolume_t* pvol, float ****tensor, int di
     int nScans;
     // determine how many scan elevations the volume object contains
     nScans = PolarVolume_getNumberOfScans(pvol);
+
+    // the classification depends on the pixel only, so it is computed once for all scans
+    long nPixels = (long) dim3*dim4;
+    float* classification = weatherAverageMap(tensor, dim2, dim3, dim4);
+    if(classification == NULL){
+        return(-1);
+    }
+    // post-processing prediction rules for weather, modified for scans not
+    // part of the segmentation model, after Lin et al. 2019, doi 10.1111/2041-210X.13280
+    for(long pixel=0; pixel<nPixels; pixel++){
+        classification[pixel] = classification[pixel] > MISTNET_SCAN_AVERAGE_WEATHER_THRESHOLD ?
+            MISTNET_WEATHER_CELL_VALUE : CELLINIT;
+    }
     
    // iterate over the selected scans in 'volume'
     for (int iScan = 0; iScan < nScans; iScan++) {
@@ -981,60 +1586,49 @@ int addClassificationToPolarVolume(PolarVolume_t* pvol, float ****tensor, int di
             continue;
         }
 
-        PolarScanParam_t *mistnetParamClassification= PolarScan_newParam(scan, CELLNAME, RaveDataType_INT);
-        
-        long nRang = PolarScan_getNbins(scan);
-        long nAzim = PolarScan_getNrays(scan);
-        double elev = PolarScan_getElangle(scan);
-        double rangeScale = PolarScan_getRscale(scan);
+        PolarScanParam_t *mistnetParamClassification= PolarScan_newParam(scan, CELLNAME, CELLTYPE);
         
-        for(int iRang=0; iRang<nRang; iRang++){
-            for(int iAzim=0; iAzim<nAzim; iAzim++){
-                //range in meter
-                double range = iRang*rangeScale;
-                //azimuth in radials
-                double azim = iAzim*2*PI/nAzim;
-                // ground distance in meter
-                double distance=range2distance(range,elev);
-                // Cartesian x coordinate, with radar at center
-                double xx=distance*cos(azim);
-                // Cartesian y coordinate, with radar at center
-                double yy=distance*sin(azim);
-                // Cartesian grid index x
-                int x=MIN(dim3-1,MAX(0,ROUND(xx/res+dim3/2)));
-                // Cartesian grid index y
-                int y=MIN(dim4-1,MAX(0,ROUND(yy/res+dim4/2)));
-                //
-                float valueWeatherAvg=0;
-                for(int i=0; i<dim2; i++){
-                    valueWeatherAvg+=(tensor[MISTNET_WEATHER_INDEX][i][x][y]/dim2);
-                }
-                int valueClassification = CELLINIT;
-                // post-processing prediction rules for weather, modified for scans not
-                // part of the segmentation model, after Lin et al. 2019, doi 10.1111/2041-210X.13280
-                if(valueWeatherAvg > MISTNET_SCAN_AVERAGE_WEATHER_THRESHOLD){
-                    valueClassification=MISTNET_WEATHER_CELL_VALUE;
-                }
-                PolarScanParam_setValue(mistnetParamClassification, iRang, iAzim, valueClassification);                
-            }            
+        renderMap_t* map = getRenderMap(scan, dim3, res);
+        if(map == NULL){
+            RAVE_OBJECT_RELEASE(mistnetParamClassification);
+            RAVE_OBJECT_RELEASE(scan);
+            free(classification);
+            return(-1);
         }
+
+        // gates outside the grid take the nearest edge pixel
+        gatherScanParam(mistnetParamClassification, map, classification, TRUE);
+
+        releaseRenderMap(map);
         
         PolarScan_addParameter(scan, mistnetParamClassification);
         RAVE_OBJECT_RELEASE(mistnetParamClassification);
         RAVE_OBJECT_RELEASE(scan);
     }
+
+    free(classification);
     
     return(0);
 
 }
 
 #if defined(MISTNET)
-// segments biology from precipitation using mistnet deep convolution net.
-int segmentScansUsingMistnet(PolarVolume_t* volume, vol2birdScanUse_t *scanUse, vol2bird_t* alldata){    
+/**
+ * Select the scans of a volume that are input to the MistNet segmentation model
+ *
+ * Scans not used as MistNet input are marked as not used in scanUse when
+ * the mistNetElevsOnly option is set.
+ *
+ * @param volume - a polar volume
+ * @param scanUse - the scans of the volume used by vol2bird
+ * @param alldata - the vol2bird configuration
+ * @return a polar volume referencing the selected scans, or NULL when the
+ * volume does not contain all scans required by the model
+ */
+static PolarVolume_t* selectScansForMistnet(PolarVolume_t* volume, vol2birdScanUse_t *scanUse, vol2bird_t* alldata){
     // volume with only the 5 selected elevations
     PolarVolume_t* volume_mistnet = NULL;
     PolarVolume_t* volume_select = NULL;
-    int result = 0;
 
     volume_select = PolarVolume_selectScansByScanUse(volume, scanUse, alldata->misc.nScansUsed);
     volume_mistnet = PolarVolume_selectScansByElevation(volume_select, alldata->options.mistNetElevs, alldata->options.mistNetNElevs);
@@ -1044,7 +1638,7 @@ int segmentScansUsingMistnet(PolarVolume_t* volume, vol2birdScanUse_t *scanUse,
             PolarVolume_getNumberOfScans(volume_mistnet),alldata->options.mistNetNElevs);
             RAVE_OBJECT_RELEASE(volume_select);
             RAVE_OBJECT_RELEASE(volume_mistnet);
-            return -1;
+            return NULL;
     }
 
     // set scanUse to false for scans not entering the MistNet segmentation model
@@ -1068,54 +1662,441 @@ int segmentScansUsingMistnet(PolarVolume_t* volume, vol2birdScanUse_t *scanUse,
         if(printWarning) vol2bird_err_printf( "Warning: Ignoring scan(s) not used as MistNet input: %s...\n", buffer);
     }
 
-    // convert polar volume into 3D tensor array
-    double ***mistnetTensorInput3D = NULL;
-    int nCartesianParam = polarVolumeTo3DTensor(volume_mistnet,&mistnetTensorInput3D,MISTNET_DIMENSION,MISTNET_RESOLUTION,3*alldata->options.mistNetNElevs);
+    RAVE_OBJECT_RELEASE(volume_select);
 
-    // flatten 3D tensor into a 1D array
-    float *mistnetTensorInput;
-    mistnetTensorInput = flatten3DTensor(mistnetTensorInput3D,3*alldata->options.mistNetNElevs,MISTNET_DIMENSION,MISTNET_DIMENSION);
-    // run mistnet, which outputs a 1D array
-    int mistnetTensorSize=3*alldata->options.mistNetNElevs*MISTNET_DIMENSION*MISTNET_DIMENSION;
-    float *mistnetTensorOutput = (float *) malloc(mistnetTensorSize*sizeof(float));
+    return volume_mistnet;
+}
+
+/**
+ * Whether all MistNet input scans were segmented earlier in this run, i.e. as
+ * part of a batch. Relies on the in-memory MISTNET_SEGMENTED_ATTRIBUTE marker,
+ * which is stripped from volumes as they are read, and not on the WEATHER
+ * parameter, which a volume written by vol2bird also contains.
+ */
+static int isSegmentedByMistnet(PolarVolume_t* volume_mistnet){
+    int nScans = PolarVolume_getNumberOfScans(volume_mistnet);
+
+    for (int iScan = 0; iScan < nScans; iScan++) {
+        PolarScan_t* scan = PolarVolume_getScan(volume_mistnet, iScan);
+        int segmented = PolarScan_hasAttribute(scan, MISTNET_SEGMENTED_ATTRIBUTE);
+        RAVE_OBJECT_RELEASE(scan);
+        if (!segmented) return FALSE;
+    }
 
-    vol2bird_err_printf( "Running MistNet...");
+    return TRUE;
+}
 
-    result = run_mistnet(mistnetTensorInput, &mistnetTensorOutput, alldata->options.mistNetPath, mistnetTensorSize);
+/**
+ * Mark the MistNet input scans as segmented in this run and remove the MistNet
+ * class probabilities of an earlier run, as read from file, such that they are
+ * replaced by the output of the current run.
+ *
+ * @param volume_mistnet - the MistNet input scans
+ * @param segmented - FALSE before adding the output, TRUE after
+ */
+static void markSegmentedByMistnet(PolarVolume_t* volume_mistnet, int segmented){
+    int nScans = PolarVolume_getNumberOfScans(volume_mistnet);
 
-    // if mistnet run failed, clean up and exit
-    if(result < 0){
-        if(nCartesianParam > 0){
-            free(mistnetTensorInput);
-            free3DTensor(mistnetTensorInput3D,nCartesianParam,MISTNET_RESOLUTION);
+    for (int iScan = 0; iScan < nScans; iScan++) {
+        PolarScan_t* scan = PolarVolume_getScan(volume_mistnet, iScan);
+        if (!segmented){
+            if (!PolarScan_hasAttribute(scan, MISTNET_SEGMENTED_ATTRIBUTE)){
+                const char* classes[3] = {"WEATHER", "BIOLOGY", "BACKGROUND"};
+                for (int iClass = 0; iClass < 3; iClass++){
+                    PolarScanParam_t* param = PolarScan_removeParameter(scan, classes[iClass]);
+                    RAVE_OBJECT_RELEASE(param);
+                }
+            }
         }
-        RAVE_OBJECT_RELEASE(volume_select);
-        RAVE_OBJECT_RELEASE(volume_mistnet);
-        vol2bird_err_printf( "failed\n");
-        return -1;
+        else if (!PolarScan_hasAttribute(scan, MISTNET_SEGMENTED_ATTRIBUTE)){
+            RaveAttribute_t* attr = RaveAttributeHelp_createLong(MISTNET_SEGMENTED_ATTRIBUTE, 1);
+            PolarScan_addAttribute(scan, attr);
+            RAVE_OBJECT_RELEASE(attr);
+        }
+        RAVE_OBJECT_RELEASE(scan);
     }
+}
+
+/**
+ * Number of channels of the MistNet input and output tensors, i.e. three
+ * quantities (or classes) for each of the MistNet elevation scans
+ */
+static int mistnetChannels(vol2bird_t* alldata){
+    return 3*alldata->options.mistNetNElevs;
+}
 
-    vol2bird_err_printf( "done\n");
-    // convert mistnet 1D array into a 4D tensor
-    float ****mistnetTensorOutput4D = create4DTensor(mistnetTensorOutput,3,alldata->options.mistNetNElevs,MISTNET_DIMENSION,MISTNET_DIMENSION);
+/**
+ * Number of values of the MistNet input and output tensors of a single volume
+ */
+static int mistnetTensorSize(vol2bird_t* alldata){
+    return mistnetChannels(alldata)*alldata->options.mistNetDimension*alldata->options.mistNetDimension;
+}
+
+/**
+ * Render the MistNet input scans into the flattened input tensor of the model
+ *
+ * @param volume_mistnet - the MistNet input scans
+ * @param alldata - the vol2bird configuration
+ * @param tensor - output, mistnetChannels(alldata)*mistNetDimension*mistNetDimension values in NCHW layout
+ * @return 0 on success, -1 otherwise
+ */
+static int mistnetInputTensor(PolarVolume_t* volume_mistnet, vol2bird_t* alldata, float* tensor){
+    // render the polar volume directly into the model input layout
+    return polarVolumeToTensor(volume_mistnet, tensor, alldata->options.mistNetDimension, alldata->options.mistNetResolution, mistnetChannels(alldata));
+}
+
+/**
+ * Add the MistNet output of a volume to its scans
+ *
+ * @param volume - the polar volume
+ * @param volume_mistnet - the MistNet input scans of the volume
+ * @param alldata - the vol2bird configuration
+ * @param tensor - the model output for this volume, read in place
+ */
+static void addMistnetOutputToPolarVolume(PolarVolume_t* volume, PolarVolume_t* volume_mistnet, vol2bird_t* alldata, float* tensor){
     // add segmentation to polar volume
-    addTensorToPolarVolume(volume_mistnet, mistnetTensorOutput4D,3,alldata->options.mistNetNElevs,MISTNET_DIMENSION,MISTNET_DIMENSION,MISTNET_RESOLUTION);
+    int dim = alldata->options.mistNetDimension;
+    long res = alldata->options.mistNetResolution;
+    markSegmentedByMistnet(volume_mistnet, FALSE);
+    addTensorToPolarVolume(volume_mistnet, tensor,3,alldata->options.mistNetNElevs,dim,dim,res);
+    markSegmentedByMistnet(volume_mistnet, TRUE);
 
     // add segmentation for scans that weren't input to the segmentation model to polar volume
     // note: all scans in 'volume_mistnet' are also contained in 'volume', i.e. its scan pointers point to the same objects
-    addClassificationToPolarVolume(volume, mistnetTensorOutput4D,3,alldata->options.mistNetNElevs,MISTNET_DIMENSION,MISTNET_DIMENSION,MISTNET_RESOLUTION);
+    addClassificationToPolarVolume(volume, tensor,3,alldata->options.mistNetNElevs,dim,dim,res);
+}
 
-    //clean up 3D array
-    if(nCartesianParam > 0){
-        free(mistnetTensorInput);
-        free(mistnetTensorOutput);
-        free3DTensor(mistnetTensorInput3D,nCartesianParam,MISTNET_RESOLUTION);
-        free4DTensor(mistnetTensorOutput4D, 3, alldata->options.mistNetNElevs, MISTNET_RESOLUTION);
+// a MistNet output kept in memory
+typedef struct mistnetCacheEntry {
+    uint64_t key;
+    int tensorSize;
+    float* output;
+} mistnetCacheEntry_t;
+
+static mistnetCacheEntry_t mistnetCache[MISTNET_CACHE_MAX_SIZE];
+static int mistnetCacheNext = 0;
+
+#define FNV_OFFSET_BASIS 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+// 64-bit FNV-1a hash of a buffer, continuing from hash
+static uint64_t fnv1a(uint64_t hash, const void* data, size_t size){
+    const unsigned char* bytes = (const unsigned char*) data;
+    for (size_t i = 0; i < size; i++){
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
     }
+    return hash;
+}
 
-    RAVE_OBJECT_RELEASE(volume_select);
+static int mistnetCacheEnabled(vol2bird_t* alldata){
+    return alldata->options.mistNetCache > 0 || alldata->options.mistNetCacheDir[0] != '\0';
+}
+
+/**
+ * Key of the MistNet output for a rendered input: a hash of the input tensor,
+ * its shape and resolution, and the path and modification time of the model
+ */
+static uint64_t mistnetCacheKey(float* input, vol2bird_t* alldata){
+    int shape[3] = {mistnetChannels(alldata), alldata->options.mistNetDimension, alldata->options.mistNetResolution};
+    long long mtime = 0;
+    struct stat modelStat;
+    if (stat(alldata->options.mistNetPath, &modelStat) == 0){
+        mtime = (long long) modelStat.st_mtime;
+    }
+
+    uint64_t key = FNV_OFFSET_BASIS;
+    key = fnv1a(key, alldata->options.mistNetPath, strlen(alldata->options.mistNetPath));
+    key = fnv1a(key, &mtime, sizeof(mtime));
+    key = fnv1a(key, shape, sizeof(shape));
+    key = fnv1a(key, input, (size_t) mistnetTensorSize(alldata)*sizeof(float));
+    return key;
+}
+
+static void mistnetCacheFile(char* filename, size_t size, uint64_t key, vol2bird_t* alldata){
+    snprintf(filename, size, "%s/mistnet_%016llx.bin", alldata->options.mistNetCacheDir, (unsigned long long) key);
+}
+
+/**
+ * Look up a MistNet output, in memory first and then on disk
+ *
+ * @param key - the key of the input, see mistnetCacheKey()
+ * @param output - output, mistnetTensorSize(alldata) values
+ * @param alldata - the vol2bird configuration
+ * @return TRUE when found, FALSE otherwise
+ */
+static int mistnetCacheGet(uint64_t key, float* output, vol2bird_t* alldata){
+    int tensorSize = mistnetTensorSize(alldata);
+
+    for (int i = 0; i < MISTNET_CACHE_MAX_SIZE; i++){
+        if (mistnetCache[i].output != NULL && mistnetCache[i].key == key && mistnetCache[i].tensorSize == tensorSize){
+            memcpy(output, mistnetCache[i].output, (size_t) tensorSize*sizeof(float));
+            return TRUE;
+        }
+    }
+
+    if (alldata->options.mistNetCacheDir[0] == '\0') return FALSE;
+
+    char filename[1100];
+    mistnetCacheFile(filename, sizeof(filename), key, alldata);
+    FILE* file = fopen(filename, "rb");
+    if (file == NULL) return FALSE;
+
+    // a file starts with the key and the number of values, followed by the values
+    uint64_t fileKey = 0;
+    int32_t fileTensorSize = 0;
+    int found = fread(&fileKey, sizeof(fileKey), 1, file) == 1 &&
+        fread(&fileTensorSize, sizeof(fileTensorSize), 1, file) == 1 &&
+        fileKey == key && fileTensorSize == tensorSize &&
+        fread(output, sizeof(float), tensorSize, file) == (size_t) tensorSize;
+    fclose(file);
+
+    return found;
+}
+
+/**
+ * Store a MistNet output in memory, when the mistNetCache option is set,
+ * and on disk, when the mistNetCacheDir option is set
+ */
+static void mistnetCachePut(uint64_t key, float* output, vol2bird_t* alldata){
+    int tensorSize = mistnetTensorSize(alldata);
+
+    int size = MIN(alldata->options.mistNetCache, MISTNET_CACHE_MAX_SIZE);
+    if (size > 0){
+        if (mistnetCacheNext >= size) mistnetCacheNext = 0;
+        mistnetCacheEntry_t* entry = &mistnetCache[mistnetCacheNext];
+        if (entry->output == NULL || entry->tensorSize != tensorSize){
+            free(entry->output);
+            entry->output = (float*) malloc((size_t) tensorSize*sizeof(float));
+        }
+        if (entry->output != NULL){
+            memcpy(entry->output, output, (size_t) tensorSize*sizeof(float));
+            entry->key = key;
+            entry->tensorSize = tensorSize;
+            mistnetCacheNext = (mistnetCacheNext + 1) % size;
+        }
+    }
+
+    if (alldata->options.mistNetCacheDir[0] == '\0') return;
+
+    // written under a temporary name, such that readers never see a partial file
+    char filename[1100];
+    char tmpname[1110];
+    mistnetCacheFile(filename, sizeof(filename), key, alldata);
+    snprintf(tmpname, sizeof(tmpname), "%s.tmp", filename);
+    FILE* file = fopen(tmpname, "wb");
+    if (file == NULL){
+        vol2bird_err_printf("Warning: failed to write MistNet cache file %s\n", tmpname);
+        return;
+    }
+    int32_t fileTensorSize = tensorSize;
+    int written = fwrite(&key, sizeof(key), 1, file) == 1 &&
+        fwrite(&fileTensorSize, sizeof(fileTensorSize), 1, file) == 1 &&
+        fwrite(output, sizeof(float), tensorSize, file) == (size_t) tensorSize;
+    if (fclose(file) != 0) written = FALSE;
+    if (!written || rename(tmpname, filename) != 0){
+        remove(tmpname);
+    }
+}
+
+// segments biology from precipitation using mistnet deep convolution net.
+int segmentScansUsingMistnet(PolarVolume_t* volume, vol2birdScanUse_t *scanUse, vol2bird_t* alldata){    
+    PolarVolume_t* volume_mistnet = NULL;
+    int result = 0;
+
+    volume_mistnet = selectScansForMistnet(volume, scanUse, alldata);
+    if (volume_mistnet == NULL){
+        return -1;
+    }
+
+    // segmented earlier as part of a batch, see segmentVolumesUsingMistnet()
+    if (isSegmentedByMistnet(volume_mistnet)){
+        RAVE_OBJECT_RELEASE(volume_mistnet);
+        return 0;
+    }
+
+    // run mistnet, which outputs a 1D array
+    int tensorSize = mistnetTensorSize(alldata);
+    float *mistnetTensorInput = newTensor(tensorSize);
+    float *mistnetTensorOutput = newTensor(tensorSize);
+    if (mistnetTensorInput == NULL || mistnetTensorOutput == NULL){
+        freeTensor(mistnetTensorInput);
+        freeTensor(mistnetTensorOutput);
+        RAVE_OBJECT_RELEASE(volume_mistnet);
+        return -1;
+    }
+
+    result = mistnetInputTensor(volume_mistnet, alldata, mistnetTensorInput);
+
+    // skip the inference when the output for this input is cached
+    int cached = FALSE;
+    uint64_t key = 0;
+    if(result == 0 && mistnetCacheEnabled(alldata)){
+        key = mistnetCacheKey(mistnetTensorInput, alldata);
+        cached = mistnetCacheGet(key, mistnetTensorOutput, alldata);
+        if(cached) vol2bird_err_printf( "Using cached MistNet output\n");
+    }
+
+    if(result == 0 && !cached){
+        vol2bird_err_printf( "Running MistNet...");
+
+        set_mistnet_threads(alldata->options.mistNetThreads);
+        result = run_mistnet(mistnetTensorInput, &mistnetTensorOutput, alldata->options.mistNetPath,
+            mistnetChannels(alldata), alldata->options.mistNetDimension, alldata->options.mistNetDimension);
+
+        vol2bird_err_printf( result < 0 ? "failed\n" : "done\n");
+
+        if(result == 0 && mistnetCacheEnabled(alldata)){
+            mistnetCachePut(key, mistnetTensorOutput, alldata);
+        }
+    }
+
+    // if mistnet run failed, clean up and exit
+    if(result < 0){
+        freeTensor(mistnetTensorInput);
+        freeTensor(mistnetTensorOutput);
+        RAVE_OBJECT_RELEASE(volume_mistnet);
+        return -1;
+    }
+
+    addMistnetOutputToPolarVolume(volume, volume_mistnet, alldata, mistnetTensorOutput);
+
+    freeTensor(mistnetTensorInput);
+    freeTensor(mistnetTensorOutput);
     RAVE_OBJECT_RELEASE(volume_mistnet);
     
     return result;
 }   // segmentScansUsingMistnet
+
+// a batch of up to MISTNET_BATCH_SIZE volumes segmented in one MistNet forward pass
+struct vol2birdMistnetBatch {
+    int nVolumes;                                      // volumes with model input in the batch
+    PolarVolume_t* volumes[MISTNET_BATCH_SIZE];        // the volumes
+    PolarVolume_t* volume_mistnet[MISTNET_BATCH_SIZE]; // their model input scans
+    int channels;                                      // channels per volume
+    int dim;                                           // height and width of the grid
+    int tensorSize;                                    // number of values per volume, channels x dim x dim
+    float* input;                                      // model input, nVolumes x tensorSize
+    float* output;                                     // model output, nVolumes x tensorSize
+    uint64_t key[MISTNET_BATCH_SIZE];                  // cache keys of the inputs, see mistnetCacheKey()
+    int nThreads;                                      // size of the process-wide libtorch intra-op pool, 0 for default
+    int result;                                        // result of the inference, -1 before it ran
+    vol2bird_t* alldata;
+};
+
+/**
+ * Select the model input scans of up to MISTNET_BATCH_SIZE volumes and render
+ * them into a batch input tensor. Volumes lacking the model input scans, or
+ * segmented before, are left out of the batch.
+ *
+ * @param volumes - the polar volumes
+ * @param scanUse - the scans of each volume used by vol2bird
+ * @param nVolumes - number of volumes, at most MISTNET_BATCH_SIZE
+ * @param alldata - the vol2bird configuration, which is referenced by the batch
+ * @return the batch, or NULL on failure
+ */
+vol2birdMistnetBatch_t* mistnetBatchNew(PolarVolume_t* volumes[], vol2birdScanUse_t *scanUse[], int nVolumes, vol2bird_t* alldata){
+    vol2birdMistnetBatch_t* batch = (vol2birdMistnetBatch_t*) calloc(1, sizeof(vol2birdMistnetBatch_t));
+    if (batch == NULL){
+        vol2bird_err_printf("Error: failed to allocate the MistNet batch\n");
+        return NULL;
+    }
+    batch->channels = mistnetChannels(alldata);
+    batch->dim = alldata->options.mistNetDimension;
+    batch->tensorSize = mistnetTensorSize(alldata);
+    batch->nThreads = alldata->options.mistNetThreads;
+    batch->result = -1;
+    batch->alldata = alldata;
+    batch->input = newTensor((size_t) MISTNET_BATCH_SIZE*batch->tensorSize);
+    batch->output = newTensor((size_t) MISTNET_BATCH_SIZE*batch->tensorSize);
+    if (batch->input == NULL || batch->output == NULL){
+        vol2bird_err_printf("Error: failed to allocate the MistNet batch tensors\n");
+        vol2birdMistnetBatchFree(batch);
+        return NULL;
+    }
+
+    for (int iVolume = 0; iVolume < nVolumes && iVolume < MISTNET_BATCH_SIZE; iVolume++) {
+        if (scanUse[iVolume] == NULL) continue;
+        // volumes lacking the model input scans are left for segmentScansUsingMistnet() to report
+        PolarVolume_t* selected = selectScansForMistnet(volumes[iVolume], scanUse[iVolume], alldata);
+        if (selected == NULL) continue;
+        float* input = batch->input + (size_t) batch->nVolumes*batch->tensorSize;
+        if (isSegmentedByMistnet(selected) || mistnetInputTensor(selected, alldata, input) < 0){
+            RAVE_OBJECT_RELEASE(selected);
+            continue;
+        }
+        // volumes with a cached output are segmented right away and left out of the batch
+        if (mistnetCacheEnabled(alldata)){
+            float* output = batch->output + (size_t) batch->nVolumes*batch->tensorSize;
+            batch->key[batch->nVolumes] = mistnetCacheKey(input, alldata);
+            if (mistnetCacheGet(batch->key[batch->nVolumes], output, alldata)){
+                vol2bird_err_printf("Using cached MistNet output\n");
+                addMistnetOutputToPolarVolume(volumes[iVolume], selected, alldata, output);
+                RAVE_OBJECT_RELEASE(selected);
+                continue;
+            }
+        }
+        batch->volumes[batch->nVolumes] = RAVE_OBJECT_COPY(volumes[iVolume]);
+        batch->volume_mistnet[batch->nVolumes] = selected;
+        batch->nVolumes++;
+    }
+
+    return batch;
+}
+
+/**
+ * Run MistNet on a batch. Touches neither RAVE objects nor the console,
+ * so it may run in a thread of its own while the caller renders the next
+ * batch or calculates profiles.
+ *
+ * @return 0 on success, -1 otherwise
+ */
+int vol2birdMistnetBatchRun(vol2birdMistnetBatch_t* batch){
+    if (batch == NULL) return -1;
+    if (batch->nVolumes == 0) {
+        batch->result = 0;
+        return 0;
+    }
+    set_mistnet_threads(batch->nThreads);
+    batch->result = run_mistnet_batch(batch->input, &batch->output, batch->alldata->options.mistNetPath,
+        batch->nVolumes, batch->channels, batch->dim, batch->dim);
+    return batch->result;
+}
+
+/**
+ * Add the MistNet output of a batch to its volumes
+ *
+ * @return the number of volumes segmented, -1 when the inference failed
+ */
+int vol2birdMistnetBatchApply(vol2birdMistnetBatch_t* batch){
+    if (batch == NULL) return -1;
+    if (batch->nVolumes == 0) return 0;
+
+    if (batch->result < 0){
+        vol2bird_err_printf("Running MistNet on %i volumes...failed\n", batch->nVolumes);
+        return -1;
+    }
+    vol2bird_err_printf("Running MistNet on %i volumes...done\n", batch->nVolumes);
+
+    for (int iBatch = 0; iBatch < batch->nVolumes; iBatch++) {
+        float* output = batch->output + (size_t) iBatch*batch->tensorSize;
+        addMistnetOutputToPolarVolume(batch->volumes[iBatch], batch->volume_mistnet[iBatch], batch->alldata, output);
+        if (mistnetCacheEnabled(batch->alldata)){
+            mistnetCachePut(batch->key[iBatch], output, batch->alldata);
+        }
+    }
+
+    return batch->nVolumes;
+}
+
+void vol2birdMistnetBatchFree(vol2birdMistnetBatch_t* batch){
+    if (batch == NULL) return;
+    for (int iBatch = 0; iBatch < batch->nVolumes; iBatch++) {
+        RAVE_OBJECT_RELEASE(batch->volumes[iBatch]);
+        RAVE_OBJECT_RELEASE(batch->volume_mistnet[iBatch]);
+    }
+    freeTensor(batch->input);
+    freeTensor(batch->output);
+    free(batch);
+}
 #endif
@@ -17,17 +17,43 @@
 #include <string.h>
 #include <math.h>
 
+// number of distinct RSL Range codes (256 or 65536, depending on USE_TWO_BYTE_PRECISION)
+#define RSL_LOOKUP_SIZE (1 << (8*sizeof(Range)))
+
+// lookup table mapping every RSL Range code of a sweep directly onto
+// the value stored in the RAVE scan parameter
+typedef struct rslLookup {
+    float (*f)(Range);      // RSL conversion function the table was built for
+    RaveDataType type;      // RaveDataType_USHORT (codes with gain/offset) or RaveDataType_FLOAT
+    double gain;
+    double offset;
+    double nodata;
+    double undetect;
+    unsigned short codes[RSL_LOOKUP_SIZE];  // stored values for RaveDataType_USHORT
+    float values[RSL_LOOKUP_SIZE];          // stored values for RaveDataType_FLOAT
+} rslLookup_t;
+
 // non-public function prototypes (local to this file/translation unit)
 
 PolarVolume_t* PolarVolume_vol2bird_RSL2Rave(Radar* radar, float rangeMax);
 
 PolarVolume_t* PolarVolume_RSL2Rave(Radar* radar, float rangeMax);
 
-PolarScan_t* PolarScan_RSL2Rave(Radar *radar, int iScan, float rangeMax);
+PolarScan_t* PolarScan_RSL2Rave(Radar *radar, int iScan, float rangeMax, float nyqRadar);
+
+void rslReleaseSweeps(Radar *radar, int iScan, float elevNext);
+
+float rslSharedRange(Radar* radar, float rangeMax);
+
+PolarVolume_t* rslNewVolume(Radar* radar, Ray* rslRay);
 
-PolarScanParam_t* PolarScanParam_RSL2Rave(Radar *radar, float elev, int RSL_INDEX,float rangeMax, double *scale);
+PolarScanParam_t* PolarScanParam_RSL2Rave(Radar *radar, int iScan, float elev, int RSL_INDEX,float rangeMax, double *scale);
+
+void rslSweepTimes(Sweep *rslSweep, PolarScan_t* scan);
     
-int rslCopy2Rave(Sweep *rslSweep,PolarScanParam_t* scanparam);
+void rslLookupInit(rslLookup_t* lut, float (*f)(Range), int compact);
+
+int rslCopy2Rave(Sweep *rslSweep,PolarScanParam_t* scanparam, rslLookup_t* lut);
 
 #ifndef MIN
 #define MIN(x,y) (((x) < (y)) ? (x) : (y))
@@ -45,10 +71,70 @@ void vol2bird_err_printf(const char* fmt, ...);
 
 // non-public function declarations (local to this file/translation unit)
 
-// copies a RSL sweep to a Rave scan
-int rslCopy2Rave(Sweep *rslSweep,PolarScanParam_t* scanparam){
+// evaluates the RSL conversion function once for every Range code.
+// When the valid codes map linearly onto physical values and at least two
+// reserved codes are available for undetect and nodata, the RSL codes are
+// stored as is in an unsigned short parameter with matching gain and offset.
+// Otherwise the physical values are stored as float.
+void rslLookupInit(rslLookup_t* lut, float (*f)(Range), int compact){
+    int first = -1, last = -1;
+    int undetectCode = -1, nodataCode = -1;
     float value;
-    double setvalue;
+    
+    lut->f = f;
+    lut->type = RaveDataType_FLOAT;
+    lut->gain = 1;
+    lut->offset = 0;
+    lut->nodata = RSL_NODATA;
+    lut->undetect = RSL_UNDETECT;
+    
+    for(int code=0; code<RSL_LOOKUP_SIZE; code++){
+        value = f((Range) code);
+        if (value >= NOECHO && value <= BADVAL){
+            // reserved value, free to encode undetect and nodata with
+            if (undetectCode < 0) undetectCode = code;
+            else if (nodataCode < 0) nodataCode = code;
+            // BADVAL is used in RSL library to encode for undetects, but also for nodata
+            // In most cases we are dealing with undetects, so encode as such
+            // RFVAL is a range folded value, see RSL documentation.
+            // Other reserved values (APFLAG, NOECHO) carry no usable data.
+            lut->values[code] = (value == BADVAL || value == RFVAL) ? RSL_UNDETECT : RSL_NODATA;
+        }
+        else{
+            if (first < 0) first = code;
+            last = code;
+            lut->values[code] = value;
+        }
+    }
+    
+    if (!compact || nodataCode < 0 || last <= first) return;
+    
+    // check that the valid codes lie on a straight line,
+    // within a small fraction of the quantisation step
+    double gain = ((double) lut->values[last] - lut->values[first])/(last - first);
+    double offset = lut->values[first] - gain*first;
+    if (gain == 0) return;
+    for(int code=first; code<=last; code++){
+        value = f((Range) code);
+        if (value >= NOECHO && value <= BADVAL) continue;
+        if (fabs(value - (gain*code + offset)) > 0.05*fabs(gain)) return;
+    }
+    
+    lut->type = RaveDataType_USHORT;
+    lut->gain = gain;
+    lut->offset = offset;
+    lut->nodata = nodataCode;
+    lut->undetect = undetectCode;
+    for(int code=0; code<RSL_LOOKUP_SIZE; code++){
+        value = f((Range) code);
+        if (value == BADVAL || value == RFVAL) lut->codes[code] = undetectCode;
+        else if (value >= NOECHO && value <= BADVAL) lut->codes[code] = nodataCode;
+        else lut->codes[code] = code;
+    }
+}
+
+// copies a RSL sweep to a Rave scan
+int rslCopy2Rave(Sweep *rslSweep,PolarScanParam_t* scanparam, rslLookup_t* lut){
     float rscale;
     int rayindex=0;
     Ray *rslRay;
@@ -62,8 +148,11 @@ int rslCopy2Rave(Sweep *rslSweep,PolarScanParam_t* scanparam){
     nrays = PolarScanParam_getNrays(scanparam);
 
     if (nbins == 0 || nrays == 0) return 0;
+    
+    unsigned short *codes = (unsigned short *) PolarScanParam_getData(scanparam);
+    float *values = (float *) PolarScanParam_getData(scanparam);
 
-    for(int iRay=0; iRay<rslSweep->h.nrays; iRay++){
+    for(int iRay=0; iRay<rslSweep->h.nrays && rslRay != NULL; iRay++){
         // determine at which ray index we are in the rave scanparam
         // adding half a ray bin width, to get into the middle of the ray bin
         rayindex=ROUND(nrays*(rslRay->h.azimuth+180.0/nrays)/360.0);
@@ -71,20 +160,24 @@ int rslCopy2Rave(Sweep *rslSweep,PolarScanParam_t* scanparam){
         rscale = rslRay->h.gate_size;
         // only values between 0 and 360 degrees permitted
         if (rayindex >= nrays) rayindex-=nrays;
+        // rays with a different conversion function only occur in the float representation
+        if (lut->type == RaveDataType_FLOAT && rslRay->h.f != lut->f) rslLookupInit(lut, rslRay->h.f, 0);
         // loop over range bins
-        int iBinStart = ROUND((rslRay->h.range_bin1 + 0.5*rscale)/rscale);
+        int iBinStart = (rscale > 0) ? ROUND((rslRay->h.range_bin1 + 0.5*rscale)/rscale) : 0;
         for(int iBin=iBinStart; iBin<nbins; iBin++){
-            value=RSL_get_value_from_ray(rslRay, iBin*rscale/1000);
-            if (value == BADVAL || value == RFVAL){
-                // BADVAL is used in RSL library to encode for undetects, but also for nodata
-                // In most cases we are dealing with undetects, so encode as such
-                // RFVAL is a range folded value, see RSL documentation.
-                setvalue=PolarScanParam_getUndetect(scanparam);
+            // index of the RSL gate at this range, range_bin1 is range to center of first bin
+            int iGate = (rscale > 0) ? (int)((iBin*rscale - rslRay->h.range_bin1)/rscale + 0.5) : -1;
+            // gates outside the ray are undetects, like BADVAL returned by RSL_get_value_from_ray
+            if (iGate < 0 || iGate >= rslRay->h.nbins){
+                if (lut->type == RaveDataType_USHORT) codes[rayindex*nbins+iBin] = (unsigned short) lut->undetect;
+                else values[rayindex*nbins+iBin] = (float) lut->undetect;
+            }
+            else if (lut->type == RaveDataType_USHORT){
+                codes[rayindex*nbins+iBin] = lut->codes[rslRay->range[iGate]];
             }
             else{
-                setvalue=(value-PolarScanParam_getOffset(scanparam))/PolarScanParam_getGain(scanparam);
+                values[rayindex*nbins+iBin] = lut->values[rslRay->range[iGate]];
             }
-            PolarScanParam_setValue(scanparam, iBin, rayindex, setvalue);
         }
         rslRay=RSL_get_next_cwise_ray(rslSweep, rslRay);
     }
@@ -93,13 +186,13 @@ int rslCopy2Rave(Sweep *rslSweep,PolarScanParam_t* scanparam){
 }
 
 
-PolarScanParam_t* PolarScanParam_RSL2Rave(Radar *radar, float elev, int RSL_INDEX,float rangeMax, double *scale){
+PolarScanParam_t* PolarScanParam_RSL2Rave(Radar *radar, int iScan, float elev, int RSL_INDEX,float rangeMax, double *scale){
     Volume *rslVolume;
     Sweep *rslSweep;
     Ray *rslRay;
     PolarScanParam_t* param = NULL;
+    rslLookup_t* lut = NULL;
     
-    float offset,gain;
     int nbins,nrays,rscale;
     
     char* DBZH="DBZH";
@@ -126,7 +219,13 @@ PolarScanParam_t* PolarScanParam_RSL2Rave(Radar *radar, float elev, int RSL_INDE
         return param;
     }
 
-    rslSweep = RSL_get_sweep(rslVolume, elev);
+    // sorted volumes keep the sweeps of a scan at the same index, which
+    // tells apart sweeps repeating an elevation (NEXRAD SAILS)
+    rslSweep = NULL;
+    if(iScan < rslVolume->h.nsweeps && rslVolume->sweep[iScan] != NULL && ABS(rslVolume->sweep[iScan]->h.elev-elev) <= ELEVTOL){
+        rslSweep = rslVolume->sweep[iScan];
+    }
+    if(rslSweep == NULL) rslSweep = RSL_get_sweep(rslVolume, elev);
 
     if(rslSweep == NULL) {
         vol2bird_err_printf("Warning: RSL sweep of volume %i not found by PolarScanParam_RSL2Rave...\n",RSL_INDEX);
@@ -149,53 +248,33 @@ PolarScanParam_t* PolarScanParam_RSL2Rave(Radar *radar, float elev, int RSL_INDE
     switch (RSL_INDEX) {
         case DZ_INDEX : 
             name = DBZH;
-            offset = 0;
-            gain = 1;
             break;
         case VR_INDEX :
             name = VRADH;
-            offset = 0;
-            gain = 1;
             break;        
         case RH_INDEX :
             name = RHOHV;
-            offset = 0;
-            gain = 1;
             break;
         case SW_INDEX :
             name = WRADH;
-            offset = 0;
-            gain = 1;
             break;
         case ZT_INDEX :
             name = TH;
-            offset = 0;
-            gain = 1;
             break;
         case DR_INDEX :
             name = ZDR;
-            offset = 0;
-            gain = 1;
             break;
         case PH_INDEX :
             name = PHIDP;
-            offset = 0;
-            gain = 1;
             break;
         case KD_INDEX :
             name = KDP;
-            offset = 0;
-            gain = 1;
             break;
         case V2_INDEX :
             name = VRAD2;
-            offset = 0;
-            gain = 1;
             break;
         case V3_INDEX :
             name = VRAD3;
-            offset = 0;
-            gain = 1;
             break;
         default :
             vol2bird_err_printf("Something went wrong; RSL scan parameter not implemented in PolarScanParam_RSL2Rave\n");
@@ -220,30 +299,47 @@ PolarScanParam_t* PolarScanParam_RSL2Rave(Radar *radar, float elev, int RSL_INDE
         vol2bird_err_printf("Warning: resampling %s sweep at elevation %f (%i rays into %i azimuth-bins) ...\n",name,elev,rslSweep->h.nrays,nrays);
     }
 
+    // build the lookup table of the sweep; RSL codes are only stored as is
+    // when all rays share the same conversion function
+    int compact = 1;
+    for(int iRay=0; iRay<rslSweep->h.nrays; iRay++){
+        if (rslSweep->ray[iRay] != NULL && rslSweep->ray[iRay]->h.f != rslRay->h.f) compact = 0;
+    }
+    lut = RAVE_MALLOC(sizeof(rslLookup_t));
+    if (lut == NULL){
+        vol2bird_err_printf("Failed to allocate memory for RSL lookup table in PolarScanParam_RSL2Rave\n");
+        return param;
+    }
+    rslLookupInit(lut, rslRay->h.f, compact);
+
     param = RAVE_OBJECT_NEW(&PolarScanParam_TYPE);
     PolarScanParam_setQuantity(param, name);
-    PolarScanParam_createData(param,nbins,nrays,RaveDataType_DOUBLE);
-    PolarScanParam_setOffset(param,offset);
-    PolarScanParam_setGain(param,gain);
-    PolarScanParam_setNodata(param,RSL_NODATA);
-    PolarScanParam_setUndetect(param,RSL_UNDETECT);
+    PolarScanParam_createData(param,nbins,nrays,lut->type);
+    PolarScanParam_setOffset(param,lut->offset);
+    PolarScanParam_setGain(param,lut->gain);
+    PolarScanParam_setNodata(param,lut->nodata);
+    PolarScanParam_setUndetect(param,lut->undetect);
 
     // initialize the data field
-    for(int iRay=0; iRay<nrays; iRay++){
-        for(int iBin=0; iBin<nbins; iBin++){
-            PolarScanParam_setValue(param, iBin, iRay, PolarScanParam_getNodata(param));
-        }
+    if (lut->type == RaveDataType_USHORT){
+        unsigned short *codes = (unsigned short *) PolarScanParam_getData(param);
+        for(long i=0; i<(long) nrays*nbins; i++) codes[i] = (unsigned short) lut->nodata;
+    }
+    else{
+        float *values = (float *) PolarScanParam_getData(param);
+        for(long i=0; i<(long) nrays*nbins; i++) values[i] = (float) lut->nodata;
     }
 
     // Fill the PolarScanParam_t objects with corresponding RSL data
-    //XXXX Check that the encoding works correctly
-    rslCopy2Rave(rslSweep,param);
+    rslCopy2Rave(rslSweep,param,lut);
+    
+    RAVE_FREE(lut);
     
     return param;
 }
 
 
-PolarScan_t* PolarScan_RSL2Rave(Radar *radar, int iScan, float rangeMax){
+PolarScan_t* PolarScan_RSL2Rave(Radar *radar, int iScan, float rangeMax, float nyqRadar){
     
     PolarScanParam_t* param;
     PolarScan_t* scan = NULL;
@@ -308,9 +404,9 @@ PolarScan_t* PolarScan_RSL2Rave(Radar *radar, int iScan, float rangeMax){
         return(NULL);
     }
     
-    // if no nyquist velocity found, try it with the native RSL function
+    // if no nyquist velocity found, use the value found by the native RSL function
     if(nyq_vel == 0){
-        nyq_vel = RSL_get_nyquist_from_radar(radar);
+        nyq_vel = nyqRadar;
     }
     
     RaveAttribute_t* attr_NI = RaveAttributeHelp_createDouble("how/NI", (double) nyq_vel);
@@ -325,6 +421,9 @@ PolarScan_t* PolarScan_RSL2Rave(Radar *radar, int iScan, float rangeMax){
     // add range scale Atribute to scan
     rscale = rslRay->h.gate_size;
     PolarScan_setRscale(scan, rscale);
+
+    // add start and end date and time of the reflectivity sweep to scan
+    rslSweepTimes(radar->v[DZ_INDEX]->sweep[iScan], scan);
     
     // loop through the volume pointers
     // iParam gives you the XX_INDEX flag, i.e. scan parameter type
@@ -334,7 +433,7 @@ PolarScan_t* PolarScan_RSL2Rave(Radar *radar, int iScan, float rangeMax){
         
         if(radar->v[iParam] == NULL) continue;
         
-        param = PolarScanParam_RSL2Rave(radar, elev, iParam, rangeMax, &scale);
+        param = PolarScanParam_RSL2Rave(radar, iScan, elev, iParam, rangeMax, &scale);
         if(param == NULL){
             vol2bird_err_printf("PolarScanParam_RSL2Rave returned empty object for parameter %i\n",iParam);
             goto done;
@@ -366,41 +465,77 @@ PolarScan_t* PolarScan_RSL2Rave(Radar *radar, int iScan, float rangeMax){
         return scan;
 }
 
-// maps a RSL polar volume to a RAVE polar volume NEW NEW NEW
-PolarVolume_t* PolarVolume_RSL2Rave(Radar* radar, float rangeMax){
-        
-    // the RAVE polar volume to be returned by this function
-    PolarVolume_t* volume = NULL;
+// sets the start and end date and time of a scan to those of the
+// first and last ray of a RSL sweep
+void rslSweepTimes(Sweep *rslSweep, PolarScan_t* scan){
+    Ray *rslRay;
+    Ray *first = NULL;
+    Ray *last = NULL;
+    double t, tFirst = 0, tLast = 0;
+    char date[9];
+    char time[7];
     
-    if(radar == NULL) {
-        vol2bird_err_printf("Error: RSL radar object is empty...\n");
-        return volume;
-    }
-
-    // sort the scans (sweeps) and rays
-    if(RSL_sort_radar(radar) == NULL) {
-        vol2bird_err_printf("Error: failed to sort RSL radar object...\n");
-        goto done;
+    for(int iRay=0; iRay<rslSweep->h.nrays; iRay++){
+        rslRay = rslSweep->ray[iRay];
+        if (rslRay == NULL) continue;
+        // rays are sorted by azimuth, compare their times as a single number
+        t = ((((rslRay->h.year*13.0 + rslRay->h.month)*32 + rslRay->h.day)*24 + rslRay->h.hour)*60 + rslRay->h.minute)*60 + rslRay->h.sec;
+        if (first == NULL || t < tFirst){
+            first = rslRay;
+            tFirst = t;
+        }
+        if (last == NULL || t > tLast){
+            last = rslRay;
+            tLast = t;
+        }
     }
     
-    Volume *rslVol = NULL;
-    Ray* rslRay = NULL;
-    PolarScan_t* scan = NULL;
+    if (first == NULL) return;
+    
+    snprintf(date, 9, "%04i%02i%02i",first->h.year,first->h.month,first->h.day);
+    snprintf(time, 7, "%02i%02i%02i",first->h.hour,first->h.minute,(int) floor(first->h.sec));
+    PolarScan_setStartDate(scan, date);
+    PolarScan_setStartTime(scan, time);
+    snprintf(date, 9, "%04i%02i%02i",last->h.year,last->h.month,last->h.day);
+    snprintf(time, 7, "%02i%02i%02i",last->h.hour,last->h.minute,(int) floor(last->h.sec));
+    PolarScan_setEndDate(scan, date);
+    PolarScan_setEndTime(scan, time);
+}
 
-    // several checks that the volumes contain data -- should be outside this function!
-    // should have a specific vol2bird version, and a rsl2odim version
-    // this should be in vol2bird version only
 
-    // find the first non-zero RSL volume
-    // usually breaks at iParam==0, the reflectivity volume
+// releases the RSL sweeps up to index iScan that can no longer be looked up
+// by elevation for scans at elevNext or higher, keeping at least one sweep
+// per volume so that RSL_get_sweep keeps working
+void rslReleaseSweeps(Radar *radar, int iScan, float elevNext){
+    Volume *rslVol;
+    Sweep *rslSweep;
+    
     for (int iParam = 0; iParam < radar->h.nvolumes; iParam++){
-        if(radar->v[iParam] == NULL) continue;
-        rslVol = radar->v[iParam];        
-        break;
+        rslVol = radar->v[iParam];
+        if(rslVol == NULL) continue;
+        
+        int nLeft = 0;
+        for (int i = 0; i < rslVol->h.nsweeps; i++){
+            if(rslVol->sweep[i] != NULL) nLeft++;
+        }
+        
+        for (int i = 0; i <= iScan && i < rslVol->h.nsweeps && nLeft > 1; i++){
+            rslSweep = rslVol->sweep[i];
+            if(rslSweep == NULL) continue;
+            if(rslSweep->h.elev + rslSweep->h.vert_half_bw < elevNext){
+                RSL_free_sweep(rslSweep);
+                rslVol->sweep[i] = NULL;
+                nLeft--;
+            }
+        }
     }
+}
+
 
-    // find the largest shared maximum range
-    // based on first ray (i.e. first sweep) of each volume 
+// finds the largest maximum range shared by the volumes of a RSL radar,
+// based on the first ray (i.e. first sweep) of each volume, limited to rangeMax
+float rslSharedRange(Radar* radar, float rangeMax){
+    Ray* rslRay;
     float maxRange=FLT_MAX;
     float iRange;
     for (int iParam = 0; iParam < radar->h.nvolumes; iParam++){
@@ -411,21 +546,19 @@ PolarVolume_t* PolarVolume_RSL2Rave(Radar* radar, float rangeMax){
     }
     // if largest shared maximum range is larger than requested rangeMax, use the requested value
     if(rangeMax<maxRange) maxRange=rangeMax;
+    return maxRange;
+}
 
-    // retrieve the first ray, for extracting some metadata
-    rslRay = RSL_get_first_ray_of_volume(rslVol);
-    if (rslRay == NULL){
-        vol2bird_err_printf("Error: RSL radar object contains no rays...\n");
-        goto done;
-    }
-        
-    // all checks on RSL object passed
-    // make a new rave polar volume object
-    volume = RAVE_OBJECT_NEW(&PolarVolume_TYPE);
+
+// makes a RAVE polar volume without scans, with the metadata of a RSL radar
+// and of its ray rslRay
+PolarVolume_t* rslNewVolume(Radar* radar, Ray* rslRay){
+
+    PolarVolume_t* volume = RAVE_OBJECT_NEW(&PolarVolume_TYPE);
     
     if (volume == NULL) {
         RAVE_CRITICAL0("Error: failed to create polarvolume instance");
-        goto done;
+        return NULL;
     }
 
     // add attribute data to RAVE polar volume
@@ -471,20 +604,80 @@ PolarVolume_t* PolarVolume_RSL2Rave(Radar* radar, float rangeMax){
     if (rslRay->h.beam_width > 0){
         PolarVolume_setBeamwidth(volume, rslRay->h.beam_width*PI/180);
     }
+
+    free(pvsource);
+
+    return volume;
+}
+
+
+// maps a RSL polar volume to a RAVE polar volume NEW NEW NEW
+// sweeps of the RSL radar are released during conversion, free the radar afterwards
+PolarVolume_t* PolarVolume_RSL2Rave(Radar* radar, float rangeMax){
+        
+    // the RAVE polar volume to be returned by this function
+    PolarVolume_t* volume = NULL;
+    
+    if(radar == NULL) {
+        vol2bird_err_printf("Error: RSL radar object is empty...\n");
+        return volume;
+    }
+
+    // sort the scans (sweeps) and rays
+    if(RSL_sort_radar(radar) == NULL) {
+        vol2bird_err_printf("Error: failed to sort RSL radar object...\n");
+        goto done;
+    }
+    
+    Volume *rslVol = NULL;
+    Ray* rslRay = NULL;
+    PolarScan_t* scan = NULL;
+
+    // several checks that the volumes contain data -- should be outside this function!
+    // should have a specific vol2bird version, and a rsl2odim version
+    // this should be in vol2bird version only
+
+    // find the first non-zero RSL volume
+    // usually breaks at iParam==0, the reflectivity volume
+    for (int iParam = 0; iParam < radar->h.nvolumes; iParam++){
+        if(radar->v[iParam] == NULL) continue;
+        rslVol = radar->v[iParam];        
+        break;
+    }
+
+    float maxRange = rslSharedRange(radar, rangeMax);
+
+    // retrieve the first ray, for extracting some metadata
+    rslRay = RSL_get_first_ray_of_volume(rslVol);
+    if (rslRay == NULL){
+        vol2bird_err_printf("Error: RSL radar object contains no rays...\n");
+        goto done;
+    }
+        
+    // all checks on RSL object passed
+    // make a new rave polar volume object
+    volume = rslNewVolume(radar, rslRay);
+    if (volume == NULL) goto done;
+
+    // Nyquist velocity of the radar, for scans without one of their own
+    float nyqRadar = RSL_get_nyquist_from_radar(radar);
         
     // read the RSL scans (sweeps) and add them to RAVE polar volume
+    // the RSL sweeps are released as soon as they have been converted,
+    // such that the RSL and RAVE copies of the volume do not coexist in full
     int result;
     for (int iScan = 0; iScan < rslVol->h.nsweeps; iScan++){
-        scan = PolarScan_RSL2Rave(radar, iScan, maxRange);
+        scan = PolarScan_RSL2Rave(radar, iScan, maxRange, nyqRadar);
         // Add the scan to the volume
         result = PolarVolume_addScan(volume,scan);
         if(result == 0){
            vol2bird_err_printf("PolarVolume_RSL2Rave failed to add RSL scan %i to RAVE polar volume\n",iScan);
         }
         RAVE_OBJECT_RELEASE(scan);
+        if (iScan+1 < rslVol->h.nsweeps && rslVol->sweep[iScan+1] != NULL){
+            rslReleaseSweeps(radar, iScan, rslVol->sweep[iScan+1]->h.elev);
+        }
     }
-   
-    free(pvsource);
     
     done:
         return volume;
@@ -520,9 +713,10 @@ PolarVolume_t* PolarVolume_vol2bird_RSL2Rave(Radar* radar, float rangeMax){
 }
 
 
-PolarVolume_t* vol2birdGetRSLVolume(char* filename, float rangeMax, int small) {
+PolarVolume_t* vol2birdGetRSLVolume(char* filename, enum File_type filetype, float rangeMax, int small, float elevMin, float elevMax, int keepSails) {
     Radar *radar;
     PolarVolume_t* volume = NULL;
+    RSL_sweep_filter filter;
 
     // if small, only read reflectivity, velocity, Rho_HV        
     // else select all scans
@@ -531,6 +725,14 @@ PolarVolume_t* vol2birdGetRSLVolume(char* filename, float rangeMax, int small) {
     
     RSL_read_these_sweeps("all",NULL);
     
+    // only decode sweeps within the requested elevation range,
+    // and range gates up to rangeMax
+    filter.elev_min = elevMin;
+    filter.elev_max = elevMax;
+    filter.max_range = rangeMax;
+    // keep the SAILS sweeps of NEXRAD data when requested
+    filter.keep_sails = keepSails;
+    
     // read the file to a RSL radar object
     
     // according to documentation of RSL it is not required to parse a callid
@@ -542,7 +744,8 @@ PolarVolume_t* vol2birdGetRSLVolume(char* filename, float rangeMax, int small) {
     callid[4] = 0; //null terminate destination
     vol2bird_err_printf("Filename = %s, callid = %s\n", filename, callid);
     
-    radar = RSL_anyformat_to_radar(filename,callid);
+    // the file type was already determined by vol2birdProbeFormat
+    radar = RSL_filetype_to_radar(filetype, filename, callid, &filter);
 
     if (radar == NULL) {
         vol2bird_err_printf("critical error, cannot open file %s\n", filename);
@@ -559,4 +762,240 @@ PolarVolume_t* vol2birdGetRSLVolume(char* filename, float rangeMax, int small) {
     
 }
 
+
+// a NEXRAD Level II volume received as chunk files of the real-time feed,
+// converted scan by scan as the sweeps complete
+struct vol2birdChunks {
+    Wsr88d_chunks* rsl;     // RSL radar with the sweeps received so far
+    PolarVolume_t* shell;   // RAVE polar volume metadata, without scans
+    PolarVolume_t* volume;  // RAVE polar volume with the scans converted so far
+    float rangeMax;         // range of the scans, shared range once the first scan is converted
+    int small;              // only read reflectivity, velocity, spectrum width and Rho_HV
+    int keepSails;          // keep the SAILS repeats of the lowest elevations
+    int iSweepNext;         // first RSL sweep not yet checked for a complete scan
+    int iSweepUnused;       // first RSL sweep not yet used for a scan
+};
+
+
+// returns the sweep of the chunk radar at index iSweep in volume iParam,
+// when it contains rays
+static Sweep* rslChunkSweep(Radar* radar, int iParam, int iSweep){
+    Volume* rslVol = radar->v[iParam];
+    if (rslVol == NULL || iSweep >= rslVol->h.nsweeps) return NULL;
+    Sweep* rslSweep = rslVol->sweep[iSweep];
+    if (rslSweep == NULL || RSL_get_first_ray_of_sweep(rslSweep) == NULL) return NULL;
+    return rslSweep;
+}
+
+
+// converts the scan completed by the Doppler sweep iSweep of the chunk radar,
+// taking each parameter from the earliest unused sweep at the same elevation,
+// such that split cuts combine the reflectivity of the surveillance sweep
+// with the velocity of the Doppler sweep, as RSL does for complete files
+static PolarScan_t* rslChunkScan(vol2birdChunks_t* chunks, Radar* radar, int iSweep){
+    PolarScan_t* scan = NULL;
+    Radar* view;
+    Sweep* rslSweep;
+    float elev = radar->v[VR_INDEX]->sweep[iSweep]->h.elev;
+
+    // a radar holding a single sweep per volume, sharing the sweeps of the chunk radar
+    view = RSL_new_radar(radar->h.nvolumes);
+    if (view == NULL) return NULL;
+    view->h = radar->h;
+    for (int iParam = 0; iParam < radar->h.nvolumes; iParam++){
+        for (int i = chunks->iSweepUnused; i <= iSweep; i++){
+            rslSweep = rslChunkSweep(radar, iParam, i);
+            if (rslSweep == NULL || ABS(rslSweep->h.elev - elev) > ELEVTOL) continue;
+            view->v[iParam] = RSL_new_volume(1);
+            view->v[iParam]->h = radar->v[iParam]->h;
+            view->v[iParam]->h.nsweeps = 1;
+            view->v[iParam]->sweep[0] = RSL_sort_rays_in_sweep(rslSweep);
+            break;
+        }
+    }
+
+    if (view->v[DZ_INDEX] == NULL){
+        vol2bird_err_printf("Warning: no reflectivity sweep found for elevation %f, skipping scan ...\n", elev);
+        goto done;
+    }
+
+    // the first scan fixes the range and the metadata of the volume
+    if (chunks->shell == NULL){
+        chunks->rangeMax = rslSharedRange(view, chunks->rangeMax);
+        chunks->shell = rslNewVolume(view, RSL_get_first_ray_of_sweep(view->v[DZ_INDEX]->sweep[0]));
+        if (chunks->shell == NULL) goto done;
+        chunks->volume = RAVE_OBJECT_CLONE(chunks->shell);
+        if (chunks->volume == NULL){
+            RAVE_OBJECT_RELEASE(chunks->shell);
+            goto done;
+        }
+    }
+
+    scan = PolarScan_RSL2Rave(view, 0, chunks->rangeMax, RSL_get_nyquist_from_radar(view));
+
+    done:
+        // the sweeps remain owned by the chunk radar
+        for (int iParam = 0; iParam < view->h.nvolumes; iParam++){
+            if (view->v[iParam] == NULL) continue;
+            view->v[iParam]->sweep[0] = NULL;
+            view->v[iParam]->h.type_str = NULL;
+        }
+        RSL_free_radar(view);
+        return scan;
+}
+
+
+// checks whether a polar volume contains a scan at elevation elev (in degrees)
+static int rslChunkHasElevation(PolarVolume_t* volume, float elev){
+    int found = 0;
+    if (volume == NULL) return 0;
+    for (int iScan = 0; iScan < PolarVolume_getNumberOfScans(volume) && !found; iScan++){
+        PolarScan_t* scan = PolarVolume_getScan(volume, iScan);
+        found = ABS(PolarScan_getElangle(scan)*180/PI - elev) <= ELEVTOL;
+        RAVE_OBJECT_RELEASE(scan);
+    }
+    return found;
+}
+
+
+// releases the sweeps of the chunk radar from index iFrom up to iTo
+static void rslChunkRelease(Radar* radar, int iFrom, int iTo){
+    for (int iParam = 0; iParam < radar->h.nvolumes; iParam++){
+        Volume* rslVol = radar->v[iParam];
+        if (rslVol == NULL) continue;
+        for (int i = iFrom; i <= iTo && i < rslVol->h.nsweeps; i++){
+            RSL_free_sweep(rslVol->sweep[i]);
+            rslVol->sweep[i] = NULL;
+        }
+    }
+}
+
+
+vol2birdChunks_t* vol2birdChunksNew(const char* callid, float rangeMax, int small, float elevMin, float elevMax, int keepSails){
+    RSL_sweep_filter filter;
+    vol2birdChunks_t* chunks;
+
+    chunks = (vol2birdChunks_t*) calloc(1, sizeof(vol2birdChunks_t));
+    if (chunks == NULL){
+        vol2bird_err_printf("Failed to allocate memory for NEXRAD chunks\n");
+        return NULL;
+    }
+
+    // only decode sweeps within the requested elevation range,
+    // and range gates up to rangeMax
+    filter.elev_min = elevMin;
+    filter.elev_max = elevMax;
+    filter.max_range = rangeMax;
+    filter.keep_sails = keepSails;
+
+    chunks->rsl = RSL_wsr88d_chunks_new((char*) callid, &filter);
+    if (chunks->rsl == NULL){
+        vol2bird_err_printf("Failed to allocate memory for NEXRAD chunks\n");
+        free(chunks);
+        return NULL;
+    }
+    chunks->rangeMax = rangeMax;
+    chunks->small = small;
+    chunks->keepSails = keepSails;
+
+    return chunks;
+}
+
+
+int vol2birdChunksAdd(vol2birdChunks_t* chunks, const char* filename, vol2bird_t* alldata){
+    Radar* radar;
+    PolarScan_t* scan;
+    PolarVolume_t* fresh = NULL;
+    Sweep* rslSweep;
+    float elev;
+    int nSweeps, nScans = 0;
+
+    // the field selection of RSL is global, set it for every chunk
+    if(chunks->small) RSL_select_fields("dz","vr","sw","rh", NULL);
+    else RSL_select_fields("dz","vr","sw","zt","dr","rh","ph","kd", NULL);
+    RSL_read_these_sweeps("all",NULL);
+
+    if (RSL_wsr88d_chunks_add(chunks->rsl, (char*) filename) < 0){
+        vol2bird_err_printf("critical error, cannot read chunk %s\n", filename);
+        return -1;
+    }
+
+    radar = RSL_wsr88d_chunks_radar(chunks->rsl);
+    nSweeps = RSL_wsr88d_chunks_nsweeps(chunks->rsl);
+
+    // a scan is complete with its Doppler sweep, i.e. the first sweep with radial velocities
+    for (; chunks->iSweepNext < nSweeps; chunks->iSweepNext++){
+        int iSweep = chunks->iSweepNext;
+
+        rslSweep = rslChunkSweep(radar, VR_INDEX, iSweep);
+        if (rslSweep == NULL) continue;
+        elev = rslSweep->h.elev;
+
+        // SAILS repeats of an elevation already in the volume
+        if (!chunks->keepSails && (rslChunkHasElevation(chunks->volume, elev) ||
+                                   rslChunkHasElevation(fresh, elev))){
+            rslChunkRelease(radar, chunks->iSweepUnused, iSweep);
+            chunks->iSweepUnused = iSweep+1;
+            continue;
+        }
+
+        scan = rslChunkScan(chunks, radar, iSweep);
+        rslChunkRelease(radar, chunks->iSweepUnused, iSweep);
+        chunks->iSweepUnused = iSweep+1;
+        if (scan == NULL) continue;
+
+        // the scans completed by this chunk are collected in a volume of their own
+        if (fresh == NULL) fresh = RAVE_OBJECT_CLONE(chunks->shell);
+        if (fresh == NULL || PolarVolume_addScan(fresh, scan) == 0){
+            vol2bird_err_printf("vol2birdChunksAdd failed to add scan at elevation %f\n", elev);
+        }
+        RAVE_OBJECT_RELEASE(scan);
+    }
+
+    if (fresh == NULL) return 0;
+
+    // run the segmentation on the new scans only, then move them to the volume
+    if (alldata != NULL && vol2birdSegmentScans(fresh, alldata) < 0){
+        RAVE_OBJECT_RELEASE(fresh);
+        return -1;
+    }
+    while (PolarVolume_getNumberOfScans(fresh) > 0){
+        scan = PolarVolume_getScan(fresh, 0);
+        PolarVolume_removeScan(fresh, 0);
+        PolarVolume_addScan(chunks->volume, scan);
+        RAVE_OBJECT_RELEASE(scan);
+        nScans++;
+    }
+    RAVE_OBJECT_RELEASE(fresh);
+
+    return nScans;
+}
+
+
+int vol2birdChunksComplete(vol2birdChunks_t* chunks){
+    return RSL_wsr88d_chunks_complete(chunks->rsl);
+}
+
+
+int vol2birdChunksNumberOfScans(vol2birdChunks_t* chunks){
+    if (chunks->volume == NULL) return 0;
+    return PolarVolume_getNumberOfScans(chunks->volume);
+}
+
+
+PolarVolume_t* vol2birdChunksVolume(vol2birdChunks_t* chunks){
+    if (chunks->volume == NULL) return NULL;
+    PolarVolume_sortByElevations(chunks->volume, 1);
+    return RAVE_OBJECT_COPY(chunks->volume);
+}
+
+
+void vol2birdChunksFree(vol2birdChunks_t* chunks){
+    if (chunks == NULL) return;
+    RSL_wsr88d_chunks_free(chunks->rsl);
+    RAVE_OBJECT_RELEASE(chunks->shell);
+    RAVE_OBJECT_RELEASE(chunks->volume);
+    free(chunks);
+}
+
 #endif
@@ -65,6 +65,16 @@ static void classifyGatesSimple(vol2bird_t* alldata);
 
 static void constructPointsArray(PolarVolume_t* volume, vol2birdScanUse_t *scanUse, vol2bird_t* alldata);
 
+static int segmentScan(PolarScan_t* scan, vol2birdScanUse_t scanUse, int iScan, int nScans, vol2bird_t* alldata);
+
+static PolarScanParam_t* getCellParam(PolarScan_t* scan);
+
+static void selectPolarizationMode(vol2bird_t* alldata);
+
+static int checkMistnetGrid(vol2bird_t* alldata);
+
+static void setRadarWavelength(PolarVolume_t* volume, vol2bird_t* alldata);
+
 static int detNumberOfGates(const int iLayer, const float rangeScale, const float elevAngle,
                             const int nRang, const int nAzim, const float radarHeight, vol2bird_t* alldata);
 
@@ -148,7 +158,7 @@ static void updateFlagFieldsInPointsArray(const float* yObs, const float* yFitte
 static int updateMap(PolarScan_t* scan, CELLPROP *cellProp, const int nCells, vol2bird_t* alldata);
 
 #ifdef IRIS
-PolarVolume_t* vol2birdGetIRISVolume(char* filenames[], int nInputFiles);
+PolarVolume_t* vol2birdGetIRISVolume(char* filenames[], int nInputFiles, float rangeMax);
 #endif
 
 PolarVolume_t* vol2birdGetODIMVolume(char* filenames[], int nInputFiles);
@@ -537,6 +547,141 @@ static void classifyGatesSimple(vol2bird_t* alldata) {
 
 
 
+// returns the CELL parameter of a scan, holding CELLTYPE data. A CELL of
+// another type, as read from file or written by an earlier version, is
+// converted in place. Returns NULL when the scan has no CELL parameter.
+static PolarScanParam_t* getCellParam(PolarScan_t* scan) {
+
+    PolarScanParam_t *cellParam = PolarScan_getParameter(scan, CELLNAME);
+
+    if (cellParam == NULL || PolarScanParam_getDataType(cellParam) == CELLTYPE){
+        return cellParam;
+    }
+
+    long nBins = PolarScanParam_getNbins(cellParam);
+    long nRays = PolarScanParam_getNrays(cellParam);
+    short *cellData = (short *) malloc(nBins * nRays * sizeof(short));
+    if (cellData == NULL){
+        vol2bird_err_printf("Failed to allocate memory for converting the CELL quantity\n");
+        RAVE_OBJECT_RELEASE(cellParam);
+        return NULL;
+    }
+
+    double value;
+    for (long iRay = 0; iRay < nRays; iRay++){
+        for (long iBin = 0; iBin < nBins; iBin++){
+            PolarScanParam_getValue(cellParam, iBin, iRay, &value);
+            cellData[iRay * nBins + iBin] = (short) value;
+        }
+    }
+
+    // setData copies the data
+    int result = PolarScanParam_setData(cellParam, nBins, nRays, cellData, CELLTYPE);
+    free(cellData);
+    if (result == 0){
+        vol2bird_err_printf("Failed to convert the CELL quantity\n");
+        RAVE_OBJECT_RELEASE(cellParam);
+        return NULL;
+    }
+
+    return cellParam;
+}
+
+
+// segments a single scan: calculates the vrad texture, finds and analyzes
+// the (weather) cells and their fringes
+static int segmentScan(PolarScan_t* scan, vol2birdScanUse_t scanUse, int iScan, int nScans, vol2bird_t* alldata) {
+
+    PolarScanParam_t *cellScanParam = NULL;
+    PolarScanParam_t *texScanParam = NULL;
+
+    // check that CELL parameter is not present, which might be after running MistNet
+    if (!PolarScan_hasParameter(scan, CELLNAME)){
+        cellScanParam = PolarScan_newParam(scan, scanUse.cellName, CELLTYPE);
+    }
+    else{
+        cellScanParam = getCellParam(scan);
+        if (cellScanParam == NULL){
+            return -1;
+        }
+    }
+    // only when dealing with normal (non-dual pol) data, generate a vrad texture field
+    if (alldata->options.singlePol){
+        // ------------------------------------------------------------- //
+        //                      calculate vrad texture                   //
+        // ------------------------------------------------------------- //
+
+        texScanParam = PolarScan_newParam(scan, scanUse.texName, TEXTYPE);
+
+        calcTexture(scan, scanUse, alldata);					
+    }
+
+    int nCells = -1;
+
+    // ------------------------------------------------------------- //
+    //        find (weather) cells in the reflectivity image         //
+    // ------------------------------------------------------------- //
+				
+    if (alldata->options.dualPol && !alldata->options.useMistNet){
+    
+        if (alldata->options.singlePol){
+						
+            // first pass: single pol rain filtering
+            nCells = findWeatherCells(scan,scanUse.dbzName,alldata->options.dbzThresMin,TRUE,2,TRUE,alldata);
+            // first pass: single pol analysis of precipitation cells
+            analyzeCells(scan, scanUse, nCells, FALSE, alldata);
+            // second pass: dual pol precipitation filtering
+            nCells = findWeatherCells(scan,scanUse.rhohvName,
+                        alldata->options.rhohvThresMin,TRUE,nCells+1,FALSE,alldata);
+        }
+        else{
+            nCells = findWeatherCells(scan,scanUse.rhohvName,
+                        alldata->options.rhohvThresMin,TRUE,2,TRUE,alldata);						
+        }
+
+    }
+
+    if (!alldata->options.dualPol && !alldata->options.useMistNet){
+    
+        nCells = findWeatherCells(scan,scanUse.dbzName,alldata->options.dbzThresMin,TRUE,2,TRUE,alldata);
+
+    }
+
+    if (alldata->options.useMistNet){
+        nCells = 2;
+    }
+
+    if (nCells<0){
+        vol2bird_err_printf("Error: findWeatherCells exited with errors\n");
+        RAVE_OBJECT_RELEASE(cellScanParam);
+        RAVE_OBJECT_RELEASE(texScanParam);
+        return -1;
+    }
+
+    if (alldata->options.printCellProp == TRUE) {
+        vol2bird_err_printf("(%d/%d): found %d cells.\n",iScan+1, nScans, nCells);
+    }
+
+    // ------------------------------------------------------------- //
+    //                      analyze cells                            //
+    // ------------------------------------------------------------- //
+    if (!alldata->options.useMistNet){
+        nCells=analyzeCells(scan, scanUse, nCells, alldata->options.dualPol, alldata);
+    }
+    // ------------------------------------------------------------- //
+    //                     calculate fringe                          //
+    // ------------------------------------------------------------- //
+
+    fringeCells(scan, alldata); 
+
+    RAVE_OBJECT_RELEASE(texScanParam);
+    RAVE_OBJECT_RELEASE(cellScanParam);
+
+    return 0;
+}
+
+
+
 static void constructPointsArray(PolarVolume_t* volume, vol2birdScanUse_t* scanUse, vol2bird_t* alldata) {
     
         // iterate over the scans in 'volume'
@@ -553,83 +698,26 @@ static void constructPointsArray(PolarVolume_t* volume, vol2birdScanUse_t* scanU
                 // extract the scan object from the volume object
                 PolarScan_t* scan = PolarVolume_getScan(volume, iScan);
 
-                PolarScanParam_t *cellScanParam = NULL;
-                PolarScanParam_t *texScanParam = NULL;
-                
-                // check that CELL parameter is not present, which might be after running MistNet
-                if (!PolarScan_hasParameter(scan, CELLNAME)){
-                    cellScanParam = PolarScan_newParam(scan, scanUse[iScan].cellName, RaveDataType_INT);
-                }
-                // only when dealing with normal (non-dual pol) data, generate a vrad texture field
-                if (alldata->options.singlePol){
-                    // ------------------------------------------------------------- //
-                    //                      calculate vrad texture                   //
-                    // ------------------------------------------------------------- //
-
-                    texScanParam = PolarScan_newParam(scan, scanUse[iScan].texName, RaveDataType_DOUBLE);
-
-                    calcTexture(scan, scanUse[iScan], alldata);					
-                }
+                // scans shared between SAILS sub-volumes, or segmented while
+                // the volume was being received, are segmented only once.
+                // The marker is only set in memory during this run, it is
+                // stripped from volumes as they are read
+                int segmented = !alldata->options.useMistNet &&
+                    (alldata->options.sailsProfiles || alldata->misc.scansSegmented) &&
+                    PolarScan_hasAttribute(scan, SEGMENTED_ATTRIBUTE);
 
-                int nCells = -1;
-
-                // ------------------------------------------------------------- //
-                //        find (weather) cells in the reflectivity image         //
-                // ------------------------------------------------------------- //
-				
-                if (alldata->options.dualPol && !alldata->options.useMistNet){
-                    
-                    if (alldata->options.singlePol){
-						
-                        // first pass: single pol rain filtering
-                        nCells = findWeatherCells(scan,scanUse[iScan].dbzName,alldata->options.dbzThresMin,TRUE,2,TRUE,alldata);
-                        // first pass: single pol analysis of precipitation cells
-                        analyzeCells(scan, scanUse[iScan], nCells, FALSE, alldata);
-                        // second pass: dual pol precipitation filtering
-                        nCells = findWeatherCells(scan,scanUse[iScan].rhohvName,
-                                    alldata->options.rhohvThresMin,TRUE,nCells+1,FALSE,alldata);
+                if (!segmented){
+                    if (segmentScan(scan, scanUse[iScan], iScan, nScans, alldata) < 0){
+                        RAVE_OBJECT_RELEASE(scan);
+                        return;
                     }
-                    else{
-                        nCells = findWeatherCells(scan,scanUse[iScan].rhohvName,
-                                    alldata->options.rhohvThresMin,TRUE,2,TRUE,alldata);						
+                    if (alldata->options.sailsProfiles){
+                        RaveAttribute_t* attr_segmented = RaveAttributeHelp_createLong(SEGMENTED_ATTRIBUTE, 1);
+                        PolarScan_addAttribute(scan, attr_segmented);
+                        RAVE_OBJECT_RELEASE(attr_segmented);
                     }
-
-                }
-
-                if (!alldata->options.dualPol && !alldata->options.useMistNet){
-                    
-                    nCells = findWeatherCells(scan,scanUse[iScan].dbzName,alldata->options.dbzThresMin,TRUE,2,TRUE,alldata);
-
-                }
-                
-                if (alldata->options.useMistNet){
-                    nCells = 2;
-                }
-                
-                if (nCells<0){
-                    vol2bird_err_printf("Error: findWeatherCells exited with errors\n");
-                    RAVE_OBJECT_RELEASE(scan);
-                    RAVE_OBJECT_RELEASE(cellScanParam);
-                    RAVE_OBJECT_RELEASE(texScanParam);
-                    return;
-                }
-                
-                if (alldata->options.printCellProp == TRUE) {
-                    vol2bird_err_printf("(%d/%d): found %d cells.\n",iScan+1, nScans, nCells);
-                }
-                
-                // ------------------------------------------------------------- //
-                //                      analyze cells                            //
-                // ------------------------------------------------------------- //
-                if (!alldata->options.useMistNet){
-                    nCells=analyzeCells(scan, scanUse[iScan], nCells, alldata->options.dualPol, alldata);
                 }
                 // ------------------------------------------------------------- //
-                //                     calculate fringe                          //
-                // ------------------------------------------------------------- //
-    
-                fringeCells(scan, alldata); 
-                // ------------------------------------------------------------- //
                 //            print selected outputs to stderr                   //
                 // ------------------------------------------------------------- //
     
@@ -684,8 +772,6 @@ static void constructPointsArray(PolarVolume_t* volume, vol2birdScanUse_t* scanU
                     if (alldata->points.indexFrom[iLayer] + alldata->points.nPointsWritten[iLayer] > alldata->points.indexTo[iLayer]) {
                         vol2bird_err_printf("Problem occurred: writing over existing data\n");
                         RAVE_OBJECT_RELEASE(scan);
-                        RAVE_OBJECT_RELEASE(cellScanParam);
-                        RAVE_OBJECT_RELEASE(texScanParam);
                         return;
                     }
     
@@ -697,8 +783,6 @@ static void constructPointsArray(PolarVolume_t* volume, vol2birdScanUse_t* scanU
     
                 // free previously malloc'ed arrays                
                 RAVE_OBJECT_RELEASE(scan);
-                RAVE_OBJECT_RELEASE(texScanParam);
-                RAVE_OBJECT_RELEASE(cellScanParam);
             }
         } // endfor (iScan = 0; iScan < nScans; iScan++)
 }
@@ -1295,6 +1379,7 @@ static int findWeatherCells(PolarScan_t *scan, const char* quantity, float quant
     int nNeighborhood;
     int count;
     int cellImageInitialValue;
+    int nCellsSkipped = 0;
 
     float quantityThres;
 
@@ -1344,7 +1429,7 @@ static int findWeatherCells(PolarScan_t *scan, const char* quantity, float quant
     }
     
     PolarScanParam_t *scanParam = PolarScan_getParameter(scan, quantity);
-    PolarScanParam_t *cellParam = PolarScan_getParameter(scan, CELLNAME);
+    PolarScanParam_t *cellParam = getCellParam(scan);
 
     if (scanParam == NULL || cellParam == NULL) {
         RAVE_OBJECT_RELEASE(scanParam);
@@ -1354,7 +1439,7 @@ static int findWeatherCells(PolarScan_t *scan, const char* quantity, float quant
     }
 
     // get direct pointer to the data block
-    int* cellParamData = (int*) PolarScanParam_getData(cellParam);
+    short* cellParamData = (short*) PolarScanParam_getData(cellParam);
     
     quantityMissing = PolarScanParam_getNodata(scanParam);
     quantityUndetect = PolarScanParam_getUndetect(scanParam);
@@ -1519,8 +1604,12 @@ static int findWeatherCells(PolarScan_t *scan, const char* quantity, float quant
                 }
             }
 
-            // When no connections are found, give a new number.
-            if ((int) cellValueGlobal == cellImageInitialValue) {
+            // When no connections are found, give a new number, as long as
+            // it fits the cell label map
+            if ((int) cellValueGlobal == cellImageInitialValue && iCellIdentifier > CELLMAX) {
+                nCellsSkipped++;
+            }
+            else if ((int) cellValueGlobal == cellImageInitialValue) {
 
                 #ifdef FPRINTFON
                 vol2bird_err_printf("new cell found...assigning number %d\n",iCellIdentifier);
@@ -1566,6 +1655,10 @@ static int findWeatherCells(PolarScan_t *scan, const char* quantity, float quant
         }
     }
 
+    if (nCellsSkipped > 0) {
+        vol2bird_err_printf("Warning: more than %d cells found, %d gates left unassigned\n", CELLMAX, nCellsSkipped);
+    }
+
     // Returning number of detected cells (including fringe/clutter)
     nCells = iCellIdentifier;
 
@@ -1660,8 +1753,11 @@ static void fringeCells(PolarScan_t* scan, vol2bird_t* alldata) {
     int nAzim = (int) PolarScan_getNrays(scan);
     float aScale = 360.0f/ nAzim;
     float rScale = (float) PolarScan_getRscale(scan);
-    PolarScanParam_t *cellParam = PolarScan_getParameter(scan,CELLNAME);
-    int *cellImage = (int *) PolarScanParam_getData(cellParam);
+    PolarScanParam_t *cellParam = getCellParam(scan);
+    if (cellParam == NULL){
+        return;
+    }
+    short *cellImage = (short *) PolarScanParam_getData(cellParam);
 
     int iRang;
     int iAzim;
@@ -2168,7 +2264,6 @@ PolarScanParam_t* PolarScan_newParam(PolarScan_t *scan, const char *quantity, Ra
     PolarScanParam_setGain(scanParam,1);
     
     // initialize all values to NODATA
-    // (NOTE: this fails for negative values when type == RaveDataType_FLOAT, results in 0 being set. RAVE bug?)
     double nodata = PolarScanParam_getNodata(scanParam);
     for(int iRang = 0; iRang < PolarScan_getNbins(scan); iRang++){
         for(int iAzim = 0; iAzim < PolarScan_getNrays(scan); iAzim++){
@@ -2354,6 +2449,107 @@ int PolarVolume_getEndDateTime(PolarVolume_t* pvol, char** EndDate, char** EndTi
 }
 
 
+int PolarVolume_splitSails(PolarVolume_t* pvol, PolarVolume_t** subVolumes, int maxSubVolumes)
+{
+    RAVE_ASSERT((pvol != NULL), "pvol == NULL");
+
+    // ------------------------------------------------------------------- //
+    // splits a volume with repeats of the lowest elevation scan (NEXRAD   //
+    // SAILS) into sub-volumes that contain one of the repeats each, plus  //
+    // all higher scans. The scans are shared between the sub-volumes.     //
+    // Returns the number of sub-volumes, or -1 on failure.                //
+    // ------------------------------------------------------------------- //
+
+    int nScans = PolarVolume_getNumberOfScans(pvol);
+    int iLowest[SAILSMAX];
+    long startLowest[SAILSMAX];
+    int nLowest = 0;
+    double elevLowest = DBL_MAX;
+
+    for (int iScan = 0; iScan < nScans; iScan++){
+        PolarScan_t* scan = PolarVolume_getScan(pvol, iScan);
+        if (PolarScan_getElangle(scan) < elevLowest) elevLowest = PolarScan_getElangle(scan);
+        RAVE_OBJECT_RELEASE(scan);
+    }
+
+    // collect the repeats of the lowest scan in order of their start time
+    for (int iScan = 0; iScan < nScans; iScan++){
+        PolarScan_t* scan = PolarVolume_getScan(pvol, iScan);
+        if (fabs(PolarScan_getElangle(scan) - elevLowest) < ELEVTOL * DEG2RAD && nLowest < maxSubVolumes && nLowest < SAILSMAX){
+            char* date = (char *) PolarScan_getStartDate(scan);
+            char* time = (char *) PolarScan_getStartTime(scan);
+            long start = (date != NULL && time != NULL) ? datetime2long(date, time) : 0;
+            int iInsert = nLowest;
+            while (iInsert > 0 && startLowest[iInsert - 1] > start){
+                iLowest[iInsert] = iLowest[iInsert - 1];
+                startLowest[iInsert] = startLowest[iInsert - 1];
+                iInsert--;
+            }
+            iLowest[iInsert] = iScan;
+            startLowest[iInsert] = start;
+            nLowest++;
+        }
+        RAVE_OBJECT_RELEASE(scan);
+    }
+
+    if (nLowest <= 1){
+        subVolumes[0] = RAVE_OBJECT_COPY(pvol);
+        return 1;
+    }
+
+    for (int iSub = 0; iSub < nLowest; iSub++){
+        PolarVolume_t* sub = (PolarVolume_t*) RAVE_OBJECT_NEW(&PolarVolume_TYPE);
+        if (sub == NULL){
+            for (int i = 0; i < iSub; i++){
+                RAVE_OBJECT_RELEASE(subVolumes[i]);
+            }
+            return -1;
+        }
+        PolarVolume_setSource(sub, PolarVolume_getSource(pvol));
+        PolarVolume_setLongitude(sub, PolarVolume_getLongitude(pvol));
+        PolarVolume_setLatitude(sub, PolarVolume_getLatitude(pvol));
+        PolarVolume_setHeight(sub, PolarVolume_getHeight(pvol));
+        PolarVolume_setBeamwH(sub, PolarVolume_getBeamwH(pvol));
+        PolarVolume_setBeamwV(sub, PolarVolume_getBeamwV(pvol));
+
+        RaveList_t* attrNames = PolarVolume_getAttributeNames(pvol);
+        for (int iAttr = 0; attrNames != NULL && iAttr < RaveList_size(attrNames); iAttr++){
+            RaveAttribute_t* attr = PolarVolume_getAttribute(pvol, (const char*) RaveList_get(attrNames, iAttr));
+            if (attr != NULL) PolarVolume_addAttribute(sub, attr);
+            RAVE_OBJECT_RELEASE(attr);
+        }
+        RaveList_freeAndDestroy(&attrNames);
+
+        // the first sub-volume keeps the nominal time of the full volume,
+        // the others are timed by the start of their lowest scan
+        PolarScan_t* lowest = PolarVolume_getScan(pvol, iLowest[iSub]);
+        if (iSub == 0 || PolarScan_getStartDate(lowest) == NULL || PolarScan_getStartTime(lowest) == NULL){
+            PolarVolume_setDate(sub, PolarVolume_getDate(pvol));
+            PolarVolume_setTime(sub, PolarVolume_getTime(pvol));
+        }
+        else{
+            PolarVolume_setDate(sub, PolarScan_getStartDate(lowest));
+            PolarVolume_setTime(sub, PolarScan_getStartTime(lowest));
+        }
+        RAVE_OBJECT_RELEASE(lowest);
+
+        for (int iScan = 0; iScan < nScans; iScan++){
+            int isLowest = FALSE;
+            for (int i = 0; i < nLowest; i++){
+                if (iLowest[i] == iScan && i != iSub) isLowest = TRUE;
+            }
+            if (isLowest) continue;
+            PolarScan_t* scan = PolarVolume_getScan(pvol, iScan);
+            PolarVolume_addScan(sub, scan);
+            RAVE_OBJECT_RELEASE(scan);
+        }
+        subVolumes[iSub] = sub;
+    }
+
+    return nLowest;
+}
+
+
 double PolarVolume_getWavelength(PolarVolume_t* pvol)
 {
     RAVE_ASSERT((pvol != NULL), "pvol == NULL");
@@ -2875,6 +3071,13 @@ static int readUserConfigOptions(cfg_t** cfg, const char * optsConfFilename) {
         CFG_BOOL("MISTNET_ELEVS_ONLY", MISTNET_ELEVS_ONLY, CFGF_NONE),
         CFG_BOOL("USE_MISTNET", USE_MISTNET, CFGF_NONE),
         CFG_STR("MISTNET_PATH",MISTNET_PATH,CFGF_NONE),
+        CFG_INT("MISTNET_THREADS",MISTNET_THREADS,CFGF_NONE),
+        CFG_INT("MISTNET_DIMENSION",MISTNET_DIMENSION,CFGF_NONE),
+        CFG_INT("MISTNET_RESOLUTION",MISTNET_RESOLUTION,CFGF_NONE),
+        CFG_INT("MISTNET_CACHE",MISTNET_CACHE,CFGF_NONE),
+        CFG_STR("MISTNET_CACHE_DIR",MISTNET_CACHE_DIR,CFGF_NONE),
+        CFG_BOOL("SAILS_PROFILES",SAILS_PROFILES,CFGF_NONE),
+        CFG_BOOL("OUTPUT_SEGMENTATION",OUTPUT_SEGMENTATION,CFGF_NONE),
         CFG_END()
     };
     
@@ -3285,10 +3488,68 @@ int saveToODIM(RaveCoreObject* object, const char* filename){
 }
 
 
-int saveToCSV(const char *filename, vol2bird_t* alldata, PolarVolume_t* pvol){
+// writes a polar volume to an ODIM file. Unless options.outputSegmentation is set,
+// the texture and cell quantities are taken out of the scans for the duration of the
+// write, such that they remain available to the caller. The segmentation markers of
+// the scans are never written, they only hold for the current run.
+int saveVolumeToODIM(PolarVolume_t* volume, const char* filename, vol2bird_t* alldata){
+
+    const char* markers[2] = {SEGMENTED_ATTRIBUTE, MISTNET_SEGMENTED_ATTRIBUTE};
+    int nScans = PolarVolume_getNumberOfScans(volume);
+    PolarScanParam_t** removed = (PolarScanParam_t**) calloc(2 * nScans + 1, sizeof(PolarScanParam_t*));
+    RaveAttribute_t** removedMarker = (RaveAttribute_t**) calloc(2 * nScans + 1, sizeof(RaveAttribute_t*));
+    if (removed == NULL || removedMarker == NULL){
+        vol2bird_err_printf("Failed to allocate memory in saveVolumeToODIM\n");
+        free(removed);
+        free(removedMarker);
+        return 0;
+    }
+
+    for (int iScan = 0; iScan < nScans; iScan++){
+        PolarScan_t* scan = PolarVolume_getScan(volume, iScan);
+        if (!alldata->options.outputSegmentation){
+            removed[2 * iScan] = PolarScan_removeParameter(scan, TEXNAME);
+            removed[2 * iScan + 1] = PolarScan_removeParameter(scan, CELLNAME);
+        }
+        for (int iMarker = 0; iMarker < 2; iMarker++){
+            if (PolarScan_hasAttribute(scan, markers[iMarker])){
+                removedMarker[2 * iScan + iMarker] = PolarScan_getAttribute(scan, markers[iMarker]);
+                PolarScan_removeAttribute(scan, markers[iMarker]);
+            }
+        }
+        RAVE_OBJECT_RELEASE(scan);
+    }
+
+    int result = saveToODIM((RaveCoreObject*) volume, filename);
+
+    for (int iScan = 0; iScan < nScans; iScan++){
+        PolarScan_t* scan = PolarVolume_getScan(volume, iScan);
+        for (int iParam = 2 * iScan; iParam < 2 * iScan + 2; iParam++){
+            if (removed[iParam] != NULL){
+                PolarScan_addParameter(scan, removed[iParam]);
+                RAVE_OBJECT_RELEASE(removed[iParam]);
+            }
+        }
+        for (int iMarker = 2 * iScan; iMarker < 2 * iScan + 2; iMarker++){
+            if (removedMarker[iMarker] != NULL){
+                PolarScan_addAttribute(scan, removedMarker[iMarker]);
+                RAVE_OBJECT_RELEASE(removedMarker[iMarker]);
+            }
+        }
+        RAVE_OBJECT_RELEASE(scan);
+    }
+    free(removed);
+    free(removedMarker);
+
+    return result;
+}
+
+
+static int writeCSV(const char *filename, const char *mode, vol2bird_t* alldata, PolarVolume_t* pvol){
     
     // ----------------------------------------------------------------------------------------- //
     // this function writes the vertical profile to CSV format https://aloftdata.eu/vpts-csv     //
+    // mode is passed to fopen; the header is only written when the file starts out empty        //
     // ---------------------------------------------------------------------------------------- //
 
     //get attributes from polar volume
@@ -3304,7 +3565,7 @@ int saveToCSV(const char *filename, vol2bird_t* alldata, PolarVolume_t* pvol){
     time = PolarVolume_getTime(pvol);    
 
     FILE *fp;
-    fp = fopen(filename, "w");
+    fp = fopen(filename, mode);
     if (fp == NULL) {
         vol2bird_printf("Failed to open file %s for writing.\n", filename);
         return 0;
@@ -3329,7 +3590,8 @@ int saveToCSV(const char *filename, vol2bird_t* alldata, PolarVolume_t* pvol){
     radar_name = alldata->misc.radarName;
     fileIn = alldata->misc.filename_pvol;
     
-    fprintf(fp,"radar,datetime,height,u,v,w,ff,dd,sd_vvp,gap,eta,dens,dbz,dbz_all,n,n_dbz,n_all,n_dbz_all,rcs,sd_vvp_threshold,vcp,radar_latitude,radar_longitude,radar_height,radar_wavelength,source_file\n");
+    fseek(fp, 0, SEEK_END);
+    if (ftell(fp) == 0) fprintf(fp,"radar,datetime,height,u,v,w,ff,dd,sd_vvp,gap,eta,dens,dbz,dbz_all,n,n_dbz,n_all,n_dbz_all,rcs,sd_vvp_threshold,vcp,radar_latitude,radar_longitude,radar_height,radar_wavelength,source_file\n");
 
     int iRowProfile;
     int iCopied = 0;
@@ -3383,6 +3645,17 @@ int saveToCSV(const char *filename, vol2bird_t* alldata, PolarVolume_t* pvol){
 
 }
 
+
+int saveToCSV(const char *filename, vol2bird_t* alldata, PolarVolume_t* pvol){
+    return writeCSV(filename, "w", alldata, pvol);
+}
+
+
+int appendToCSV(const char *filename, vol2bird_t* alldata, PolarVolume_t* pvol){
+    // adds the profile rows to an existing CSV file, writing the header only for a new file
+    return writeCSV(filename, "a", alldata, pvol);
+}
+
     //check if file extension is csv
 int isCSV(const char *filename) {
     const char *dot = strrchr(filename, '.');
@@ -3746,25 +4019,68 @@ static void sortCellsByArea(CELLPROP *cellProp, const int nCells) {
 
 
 
-radarDataFormat determineRadarFormat(char* filename){
+radarDataFormat vol2birdProbeFormat(const char* filename, int* rslFileType){
+    
+    // read the leading bytes of the file once and classify them,
+    // instead of having every reader open and sniff the file in turn
+    static const unsigned char hdf5Signature[8] = {0x89, 'H', 'D', 'F', '\r', '\n', 0x1a, '\n'};
+    unsigned char header[VOL2BIRD_PROBE_SIZE];
+    size_t nHeader;
+    FILE* fp;
+    
+    if (rslFileType != NULL) *rslFileType = 0;
+    
+    fp = fopen(filename, "rb");
+    if (fp == NULL){
+        return radarDataFormat_UNKNOWN;
+    }
+    nHeader = fread(header, 1, sizeof(header), fp);
+    fclose(fp);
     
 #ifdef IRIS
-    if (isIRIS(filename)==0){
-        return radarDataFormat_ODIM;
+    // IRIS files start with a product_hdr structure identifier (27)
+    if (nHeader >= sizeof(short)){
+        short structureId;
+        memcpy(&structureId, header, sizeof(short));
+        if (structureId == 27){
+            return radarDataFormat_IRIS;
+        }
     }
 #endif
-
+    
+    // HDF5 superblock signature, at offset 0 or after a user block
+    // of 512, 1024 or 2048 bytes
+    for (size_t offset = 0; offset + sizeof(hdf5Signature) <= nHeader; offset = (offset == 0 ? 512 : 2 * offset)){
+        if (memcmp(header + offset, hdf5Signature, sizeof(hdf5Signature)) == 0){
+            return radarDataFormat_ODIM;
+        }
+    }
+    
 #ifdef RSL
-    if(RSL_filetype(filename) != UNKNOWN){
+    enum File_type type = RSL_filetype_from_buffer(header, nHeader);
+    if (type != UNKNOWN){
+        if (rslFileType != NULL) *rslFileType = (int) type;
         return radarDataFormat_RSL;
     }
 #endif
+    
+    return radarDataFormat_UNKNOWN;
+}
+
 
+radarDataFormat determineRadarFormat(char* filename){
+    
+    radarDataFormat format = vol2birdProbeFormat(filename, NULL);
+    
+    if (format != radarDataFormat_UNKNOWN){
+        return format;
+    }
+    
     // try to load the file using Rave
     // unfortunately this loads the entire file into memory,
     // but no other file type check function available in Rave.
     RaveIO_t* raveio = RaveIO_open(filename, 0, NULL);
-
+    
     // check that a valid RaveIO_t pointer was returned
     if (raveio != (RaveIO_t*) NULL){
         RAVE_OBJECT_RELEASE(raveio);
@@ -3897,8 +4213,11 @@ static int updateMap(PolarScan_t* scan, CELLPROP *cellProp, const int nCells, vo
     int nCellsValid;
     int cellImageValue;
 
-    PolarScanParam_t *cellParam = PolarScan_getParameter(scan, CELLNAME);
-    int* cellImage = (int *) PolarScanParam_getData(cellParam);
+    PolarScanParam_t *cellParam = getCellParam(scan);
+    if (cellParam == NULL){
+        return -1;
+    }
+    short* cellImage = (short *) PolarScanParam_getData(cellParam);
 
     int nGlobal = PolarScanParam_getNbins(cellParam) * PolarScanParam_getNrays(cellParam);
 
@@ -4641,155 +4960,104 @@ void printProfile(vol2bird_t* alldata) {
 // remember to release the polar volume object when done with it
 PolarVolume_t* vol2birdGetVolume(char* filenames[], int nInputFiles, float rangeMax, int small){
     
+    // read scans at all elevations
+    return vol2birdGetVolumeElevRange(filenames, nInputFiles, rangeMax, small, -90, 90, FALSE);
+}
+
+// maximum range (m) of the range gates used by the analysis configured in alldata,
+// readers need not convert gates beyond it
+float vol2birdGetReadRange(vol2bird_t* alldata){
+    
+    float range = alldata->misc.rCellMax;
+    
+    #ifdef MISTNET
+    // MistNet segments a Cartesian grid, whose corners lie further out
+    if (alldata->options.useMistNet){
+        float rangeMistNet = 0.75 * alldata->options.mistNetDimension * alldata->options.mistNetResolution;
+        if (rangeMistNet > range) range = rangeMistNet;
+    }
+    #endif
+    
+    return range;
+}
+
+// as vol2birdGetVolume, but NEXRAD Level II scans with elevations outside
+// elevMin-elevMax (degrees) are skipped by the reader instead of decoded.
+// keepSails keeps the SAILS scans of NEXRAD data, which are dropped otherwise
+PolarVolume_t* vol2birdGetVolumeElevRange(char* filenames[], int nInputFiles, float rangeMax, int small, float elevMin, float elevMax, int keepSails){
+    
     PolarVolume_t* volume = NULL;
+    int rslFileType = 0;
+    
+    // determine the format once from the header of the first file
+    radarDataFormat format = vol2birdProbeFormat(filenames[0], &rslFileType);
     
     #ifdef IRIS
-    // test whether the file is in IRIS format
-    if (isIRIS(filenames[0])==0){
-        volume = vol2birdGetIRISVolume(filenames, nInputFiles);
+    if (format == radarDataFormat_IRIS){
+        volume = vol2birdGetIRISVolume(filenames, nInputFiles, rangeMax);
         goto done;
     }
     #endif
-
+    
     // not a rave complient file, attempt to read the file with the RSL library instead
     #ifdef RSL
-    if(RSL_filetype(filenames[0]) != UNKNOWN){
+    if (format == radarDataFormat_RSL){
         if (nInputFiles > 1){
             vol2bird_err_printf("Multiple input files detected in RSL format. Only single polar volume file import supported, using file %s only.\n", filenames[0]);
         }
-        volume = vol2birdGetRSLVolume(filenames[0], rangeMax, small);
+        volume = vol2birdGetRSLVolume(filenames[0], (enum File_type) rslFileType, rangeMax, small, elevMin, elevMax, keepSails);
         goto done;
     }
     #endif
     
     volume = vol2birdGetODIMVolume(filenames, nInputFiles);
-
+    
     if (volume != NULL) {
       PolarVolume_sortByElevations(volume,1);
     }
 done:
+    // a segmentation marker stored in the file does not refer to this run
+    if (volume != NULL) {
+      vol2birdClearSegmented(volume);
+    }
     return volume;
 }
 
 #ifdef IRIS
-PolarVolume_t* vol2birdGetIRISVolume(char* filenames[], int nInputFiles) {
+PolarVolume_t* vol2birdGetIRISVolume(char* filenames[], int nInputFiles, float rangeMax) {
     // initialize a polar volume to return
     PolarVolume_t* output = NULL;
     // initialize helper volume and scan to store intermediate file reads
     PolarVolume_t* volume = NULL;
     PolarScan_t* scan = NULL;
     
-    int outputInitialised = FALSE;
-    
-    // initialize the rave object type of filename
-    int rot = Rave_ObjectType_UNDEFINED;
-
-    int ret = 0;
-    
-    file_element_s* file_element_p = NULL;
-
     for (int i=0; i<nInputFiles; i++){
-        // read the iris file
-        file_element_p = readIRIS(filenames[i]);
+        // read the iris file straight into a polar volume, sweep by sweep,
+        // without converting range bins beyond rangeMax
+        volume = readIRISVolume(filenames[i], rangeMax);
 
-        if(file_element_p == NULL){
+        if(volume == NULL){
             vol2bird_err_printf( "Warning: failed to read file %s in IRIS format, ignoring.\n", filenames[i]);
             continue;
         }
-
-        rot = objectTypeFromIRIS(file_element_p);
-        
-        if (rot == Rave_ObjectType_UNDEFINED){
-            vol2bird_err_printf( "Warning: unknown object type while reading file %s in IRIS format, ignoring.\n", filenames[i]);
-            free_IRIS(&file_element_p);
-            continue;
-        }
         
-        // start a new output volume object if we do not have one yet
+        // the first volume read becomes the output volume
         if (output == NULL){
-            output = RAVE_OBJECT_NEW(&PolarVolume_TYPE);
-            if (output == NULL) {
-                RAVE_CRITICAL0("Error: failed to create polarvolume instance");
-                goto done;
-            }
+            output = volume;
+            volume = NULL;
+            continue;
         }
         
-        if (rot == Rave_ObjectType_PVOL) {
-            volume = RAVE_OBJECT_NEW(&PolarVolume_TYPE);
-            if (volume == NULL) {
-                RAVE_CRITICAL0("Error: failed to create polarvolume instance");
-                goto done;
-            }
-            
-            // read iris data into rave polar volume object
-            ret = populateObject((RaveCoreObject*) volume, file_element_p);
-
-            if( ret != 0) {
-                vol2bird_err_printf( "Error: could not populate IRIS data into a polar volume object\n");
-                goto done;
-            }
-            
-            if (!outputInitialised){
-                RAVE_OBJECT_RELEASE(output); //may have been initialized earlier above
-                output = RAVE_OBJECT_CLONE(volume);
-                RAVE_OBJECT_RELEASE(volume);
-                outputInitialised = TRUE;
-                continue;
-            }
-            
-            for (int j=0; j<PolarVolume_getNumberOfScans(volume); j++){
-                scan = PolarVolume_getScan(volume, j);
-                PolarVolume_addScan(output, scan);
-                RAVE_OBJECT_RELEASE(scan);
-            }
-            
-            free_IRIS(&file_element_p);
-            RAVE_OBJECT_RELEASE(volume);
-        }
-    
-        if (rot == Rave_ObjectType_SCAN) {
-            scan = RAVE_OBJECT_NEW(&PolarScan_TYPE);
-            if (scan == NULL) {
-                RAVE_CRITICAL0("Error: failed to create polarscan instance");
-                goto done;
-            }
-            
-            // read iris data into rave polar volume object
-            ret = populateObject((RaveCoreObject*) scan, file_element_p);
-
-            if( ret != 0) {
-                vol2bird_err_printf( "Error: could not populate IRIS data into a polar scan object\n");
-                goto done;
-            }
-            
-            if (!outputInitialised){
-                // copy essential root metadata to volume
-                PolarVolume_setDate(output, PolarScan_getDate(scan));
-                PolarVolume_setTime(output, PolarScan_getTime(scan));
-                PolarVolume_setLatitude(output, PolarScan_getLatitude(scan));
-                PolarVolume_setLongitude(output, PolarScan_getLongitude(scan));
-                PolarVolume_setHeight(output, PolarScan_getHeight(scan));
-                PolarVolume_setSource(output, PolarScan_getSource(scan));
-                outputInitialised = TRUE;
-            }
-            
+        for (int j=0; j<PolarVolume_getNumberOfScans(volume); j++){
+            scan = PolarVolume_getScan(volume, j);
             PolarVolume_addScan(output, scan);
-            free_IRIS(&file_element_p);
             RAVE_OBJECT_RELEASE(scan);
         }
-    
+        
+        RAVE_OBJECT_RELEASE(volume);
     }
 
-    done:
-    
-        // clean up
-        if(file_element_p != NULL) {
-            free_IRIS(&file_element_p);
-        }
-        RAVE_OBJECT_RELEASE(volume);            
-        RAVE_OBJECT_RELEASE(scan);
-        
-        return output;
+    return output;
 }
 #endif
 
@@ -4950,6 +5218,8 @@ done:
 int vol2birdLoadConfig(vol2bird_t* alldata, const char* optionsFile) {
 
     alldata->misc.loadConfigSuccessful = FALSE;
+    alldata->misc.scansSegmented = FALSE;
+    alldata->misc.polarizationSelected = FALSE;
 
     const char * optsConfFilename = getenv(OPTIONS_CONF);
     if (optsConfFilename == NULL) {
@@ -5026,6 +5296,13 @@ int vol2birdLoadConfig(vol2bird_t* alldata, const char* optionsFile) {
     alldata->options.mistNetElevsOnly = cfg_getbool(*cfg, "MISTNET_ELEVS_ONLY");
     alldata->options.useMistNet = cfg_getbool(*cfg, "USE_MISTNET");
     strcpy(alldata->options.mistNetPath,cfg_getstr(*cfg,"MISTNET_PATH"));
+    alldata->options.mistNetThreads = cfg_getint(*cfg,"MISTNET_THREADS");
+    alldata->options.mistNetDimension = cfg_getint(*cfg,"MISTNET_DIMENSION");
+    alldata->options.mistNetResolution = cfg_getint(*cfg,"MISTNET_RESOLUTION");
+    alldata->options.mistNetCache = cfg_getint(*cfg,"MISTNET_CACHE");
+    strcpy(alldata->options.mistNetCacheDir,cfg_getstr(*cfg,"MISTNET_CACHE_DIR"));
+    alldata->options.sailsProfiles = cfg_getbool(*cfg, "SAILS_PROFILES");
+    alldata->options.outputSegmentation = cfg_getbool(*cfg, "OUTPUT_SEGMENTATION");
 
 
     // ------------------------------------------------------------- //
@@ -5098,28 +5375,10 @@ int get_radar_name(const char* source, char* radarName, size_t radarNameLength)
     return 0;
 }
 
-//int vol2birdSetUp(PolarVolume_t* volume, cfg_t** cfg, vol2bird_t* alldata) {
-int vol2birdSetUp(PolarVolume_t* volume, vol2bird_t* alldata) {
-    
-    alldata->misc.initializationSuccessful = FALSE;
-    
-    alldata->misc.vol2birdSuccessful = TRUE;
-
-    vol2bird_printf("Running vol2birdSetUp\n");
-
-    if (alldata->misc.loadConfigSuccessful == FALSE){
-        vol2bird_err_printf("Vol2bird configuration not loaded. Run vol2birdLoadConfig prior to vol2birdSetup\n");
-        return -1;
-    }
- 
-    int radar_name_result = get_radar_name(PolarVolume_getSource(volume), alldata->misc.radarName, sizeof(alldata->misc.radarName));
-    if (radar_name_result != 0) {
-        // handle error
-        vol2bird_err_printf("Warning: unable to extract radar name from source string\n");
-    }
+// reads the radar wavelength from the polar volume attribute, if present
+// overwriting options.radarWavelength, and sets its derived quantities
+static void setRadarWavelength(PolarVolume_t* volume, vol2bird_t* alldata) {
 
-    // reading radar wavelength from polar volume attribute
-    // if present, overwrite options.radarWavelength with the value found.
     double wavelength = PolarVolume_getWavelength(volume);
     if (wavelength > 0){
         alldata->options.radarWavelength = wavelength;
@@ -5146,6 +5405,75 @@ int vol2birdSetUp(PolarVolume_t* volume, vol2bird_t* alldata) {
             alldata->options.stdDevMinBird = STDEV_BIRD_S;
         }
     }
+}
+
+
+// checks the single- and dual-polarization precipitation filters requested
+// by the user against the radar wavelength and the segmentation method
+static void selectPolarizationMode(vol2bird_t* alldata) {
+
+    // Print warning missing rain specification
+    if(!alldata->options.singlePol && !alldata->options.dualPol){
+        vol2bird_err_printf("Warning: neither single- nor dual-polarization precipitation filter selected by user, continuing in SINGLE polarization mode\n");
+		alldata->options.singlePol = TRUE;
+    }
+
+    // Disable single pol rain filtering for S-band data when dual-pol moments are available
+    if(alldata->options.radarWavelength > 7.5 && alldata->options.singlePol && alldata->options.dualPol){
+        vol2bird_err_printf("Warning: disabling single-polarization precipitation filter for S-band data, continuing in DUAL polarization mode\n");
+		alldata->options.singlePol = FALSE;
+    }
+
+    // Print warning for S-band in single pol mode
+    if(alldata->options.radarWavelength > 7.5 && !alldata->options.dualPol){
+        vol2bird_err_printf("Warning: using experimental SINGLE polarization mode on S-band data, results may be unreliable!\n");
+    }
+
+    // Print warning for MistNet mode
+    if(alldata->options.useMistNet && (alldata->options.dualPol || alldata->options.singlePol)){
+        vol2bird_err_printf("Warning: using MistNet, disabling other segmentation methods\n");
+        alldata->options.singlePol = FALSE;
+        alldata->options.dualPol = FALSE;
+    }
+}
+
+
+// checks that the MistNet grid is larger than its bleed, such that
+// the volume can be rendered to it. Returns 0 if valid, -1 if not
+static int checkMistnetGrid(vol2bird_t* alldata) {
+
+    if(alldata->options.mistNetDimension <= MISTNET_BLEED || alldata->options.mistNetResolution <= 0){
+        vol2bird_err_printf( "Error: invalid MistNet grid of %i x %i pixels of %i m.\n", alldata->options.mistNetDimension, alldata->options.mistNetDimension, alldata->options.mistNetResolution);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+//int vol2birdSetUp(PolarVolume_t* volume, cfg_t** cfg, vol2bird_t* alldata) {
+int vol2birdSetUp(PolarVolume_t* volume, vol2bird_t* alldata) {
+    
+    alldata->misc.initializationSuccessful = FALSE;
+    
+    alldata->misc.vol2birdSuccessful = TRUE;
+
+    vol2bird_printf("Running vol2birdSetUp\n");
+
+    if (alldata->misc.loadConfigSuccessful == FALSE){
+        vol2bird_err_printf("Vol2bird configuration not loaded. Run vol2birdLoadConfig prior to vol2birdSetup\n");
+        return -1;
+    }
+ 
+    int radar_name_result = get_radar_name(PolarVolume_getSource(volume), alldata->misc.radarName, sizeof(alldata->misc.radarName));
+    if (radar_name_result != 0) {
+        // handle error
+        vol2bird_err_printf("Warning: unable to extract radar name from source string\n");
+    }
+
+    // reading radar wavelength from polar volume attribute
+    setRadarWavelength(volume, alldata);
+
     // Extract the vcp attribute if present (i.e. NEXRAD only)
     RaveAttribute_t *attr;
     long vcp;
@@ -5196,6 +5524,7 @@ int vol2birdSetUp(PolarVolume_t* volume, vol2bird_t* alldata) {
         "dealiasVrad=%i,dealiasRecycle=%i,dualPol=%i,singlePol=%i,rhohvThresMin=%f,"
         "resample=%i,resampleRscale=%f,resampleNbins=%i,resampleNrays=%i,"
         "mistNetNElevs=%i,mistNetElevsOnly=%i,useMistNet=%i,mistNetPath=%s,"
+        "mistNetDimension=%i,mistNetResolution=%i,"
     
         "areaCellMin=%f,cellClutterFractionMax=%f,"
         "chisqMin=%f,clutterValueMin=%f,dbzThresMin=%f,"
@@ -5237,6 +5566,8 @@ int vol2birdSetUp(PolarVolume_t* volume, vol2bird_t* alldata) {
         alldata->options.mistNetElevsOnly,
         alldata->options.useMistNet,
         alldata->options.mistNetPath,
+        alldata->options.mistNetDimension,
+        alldata->options.mistNetResolution,
 
         alldata->constants.areaCellMin,
         alldata->constants.cellClutterFractionMax,
@@ -5262,28 +5593,17 @@ int vol2birdSetUp(PolarVolume_t* volume, vol2bird_t* alldata) {
         return -1;
     }
 
-    // Print warning missing rain specification
-    if(!alldata->options.singlePol && !alldata->options.dualPol){
-        vol2bird_err_printf("Warning: neither single- nor dual-polarization precipitation filter selected by user, continuing in SINGLE polarization mode\n");
-		alldata->options.singlePol = TRUE;
-    }
+    // select the precipitation filters that apply to this radar
+    selectPolarizationMode(alldata);
 
-    // Disable single pol rain filtering for S-band data when dual-pol moments are available
-    if(alldata->options.radarWavelength > 7.5 && alldata->options.singlePol && alldata->options.dualPol){
-        vol2bird_err_printf("Warning: disabling single-polarization precipitation filter for S-band data, continuing in DUAL polarization mode\n");
-		alldata->options.singlePol = FALSE;
-    }
-
-    // Print warning for S-band in single pol mode
-    if(alldata->options.radarWavelength > 7.5 && !alldata->options.dualPol){
-        vol2bird_err_printf("Warning: using experimental SINGLE polarization mode on S-band data, results may be unreliable!\n");
-    }
-
-    // Print warning for MistNet mode
-    if(alldata->options.useMistNet && (alldata->options.dualPol || alldata->options.singlePol)){
-        vol2bird_err_printf("Warning: using MistNet, disabling other segmentation methods\n");
-        alldata->options.singlePol = FALSE;
-        alldata->options.dualPol = FALSE;
+    // scans segmented while the volume was received keep the polarization mode
+    // selected then, which the remaining scans follow
+    if (alldata->misc.scansSegmented && alldata->misc.polarizationSelected &&
+        (alldata->options.singlePol != alldata->misc.singlePolSelected ||
+         alldata->options.dualPol != alldata->misc.dualPolSelected)){
+        vol2bird_err_printf("Warning: keeping the polarization mode selected from the first scans received\n");
+        alldata->options.singlePol = alldata->misc.singlePolSelected;
+        alldata->options.dualPol = alldata->misc.dualPolSelected;
     }
 
     // check that we are requesting the right number of elevation scans for MistNet segmentation model
@@ -5291,6 +5611,11 @@ int vol2birdSetUp(PolarVolume_t* volume, vol2bird_t* alldata) {
         vol2bird_err_printf( "Error: MistNet segmentation model expects %i elevations, but %i are specified.\n", MISTNET_N_ELEV, alldata->options.mistNetNElevs);
         return -1;
     }
+
+    // check that the MistNet grid is larger than its bleed
+    if(alldata->options.useMistNet && checkMistnetGrid(alldata) < 0){
+        return -1;
+    }
     
     // check that MistNet segmentation model can be found on disk
     if(alldata->options.useMistNet && !isRegularFile(alldata->options.mistNetPath)){
@@ -5501,6 +5826,186 @@ int vol2birdSetUp(PolarVolume_t* volume, vol2bird_t* alldata) {
 } // vol2birdSetUp
 
 
+// runs the segmentation stages of vol2birdSetUp (vrad texture, weather cells
+// and their fringes) on the scans of a volume that is still being received,
+// and marks them such that vol2birdSetUp does not repeat them.
+// Scans are left for vol2birdSetUp when MistNet, a static clutter map or
+// resampling is used, as these need the complete volume.
+int vol2birdSegmentScans(PolarVolume_t* volume, vol2bird_t* alldata) {
+
+    if (alldata->misc.loadConfigSuccessful == FALSE){
+        vol2bird_err_printf("Vol2bird configuration not loaded. Run vol2birdLoadConfig prior to vol2birdSegmentScans\n");
+        return -1;
+    }
+
+    if (alldata->options.useMistNet || alldata->options.useClutterMap || alldata->options.resample){
+        return 0;
+    }
+
+    setRadarWavelength(volume, alldata);
+
+    // vol2birdSetUp derives the options and scan statistics anew from the
+    // complete volume, the scans received so far should not change them
+    int singlePol = alldata->options.singlePol;
+    int dualPol = alldata->options.dualPol;
+    double nyquistMin = alldata->misc.nyquistMin;
+    double nyquistMinUsed = alldata->misc.nyquistMinUsed;
+    double nyquistMax = alldata->misc.nyquistMax;
+    int nScansUsed = alldata->misc.nScansUsed;
+
+    vol2birdScanUse_t* scanUse = determineScanUse(volume, alldata);
+
+    // the polarization mode is selected once, from the first scans received,
+    // such that all scans of the volume are segmented alike
+    if (scanUse != (vol2birdScanUse_t*) NULL && !alldata->misc.polarizationSelected){
+        selectPolarizationMode(alldata);
+        alldata->misc.polarizationSelected = TRUE;
+        alldata->misc.singlePolSelected = alldata->options.singlePol;
+        alldata->misc.dualPolSelected = alldata->options.dualPol;
+    }
+    alldata->options.singlePol = alldata->misc.singlePolSelected;
+    alldata->options.dualPol = alldata->misc.dualPolSelected;
+
+    int nScans = scanUse == (vol2birdScanUse_t*) NULL ? 0 : PolarVolume_getNumberOfScans(volume);
+    int nSegmented = 0;
+    int result = 0;
+
+    for (int iScan = 0; iScan < nScans; iScan++) {
+        if (scanUse[iScan].useScan != 1) continue;
+
+        PolarScan_t* scan = PolarVolume_getScan(volume, iScan);
+
+        if (!PolarScan_hasAttribute(scan, SEGMENTED_ATTRIBUTE)){
+            if (segmentScan(scan, scanUse[iScan], iScan, nScans, alldata) < 0){
+                RAVE_OBJECT_RELEASE(scan);
+                result = -1;
+                break;
+            }
+            RaveAttribute_t* attr_segmented = RaveAttributeHelp_createLong(SEGMENTED_ATTRIBUTE, 1);
+            PolarScan_addAttribute(scan, attr_segmented);
+            RAVE_OBJECT_RELEASE(attr_segmented);
+            alldata->misc.scansSegmented = TRUE;
+            nSegmented++;
+        }
+        RAVE_OBJECT_RELEASE(scan);
+    }
+
+    free(scanUse);
+
+    alldata->options.singlePol = singlePol;
+    alldata->options.dualPol = dualPol;
+    alldata->misc.nyquistMin = nyquistMin;
+    alldata->misc.nyquistMinUsed = nyquistMinUsed;
+    alldata->misc.nyquistMax = nyquistMax;
+    alldata->misc.nScansUsed = nScansUsed;
+
+    return result < 0 ? result : nSegmented;
+}
+
+
+// removes the markers set by vol2birdSegmentScans, for shared SAILS scans and by
+// MistNet batches, such that the scans are segmented again when the volume is
+// processed anew
+void vol2birdClearSegmented(PolarVolume_t* volume) {
+
+    int nScans = PolarVolume_getNumberOfScans(volume);
+
+    for (int iScan = 0; iScan < nScans; iScan++) {
+        PolarScan_t* scan = PolarVolume_getScan(volume, iScan);
+        if (PolarScan_hasAttribute(scan, SEGMENTED_ATTRIBUTE)){
+            PolarScan_removeAttribute(scan, SEGMENTED_ATTRIBUTE);
+        }
+        if (PolarScan_hasAttribute(scan, MISTNET_SEGMENTED_ATTRIBUTE)){
+            PolarScan_removeAttribute(scan, MISTNET_SEGMENTED_ATTRIBUTE);
+        }
+        RAVE_OBJECT_RELEASE(scan);
+    }
+}
+
+#ifdef MISTNET
+// prepares a MistNet batch of up to MISTNET_BATCH_SIZE volumes ahead of
+// vol2birdSetUp: selects the model input scans as vol2birdSetUp would and
+// renders them. Run the model with vol2birdMistnetBatchRun(), add its output
+// with vol2birdMistnetBatchApply(); vol2birdSetUp then only marks the scans
+// used and does not run MistNet again. The batch references alldata, which
+// should outlive it. Returns NULL when MistNet is not used or on error.
+vol2birdMistnetBatch_t* vol2birdMistnetBatchNew(PolarVolume_t* volumes[], int nVolumes, vol2bird_t* alldata) {
+
+    if (alldata->misc.loadConfigSuccessful == FALSE){
+        vol2bird_err_printf("Vol2bird configuration not loaded. Run vol2birdLoadConfig prior to vol2birdMistnetBatchNew\n");
+        return NULL;
+    }
+
+    if (!alldata->options.useMistNet || nVolumes < 1){
+        return NULL;
+    }
+
+    // the volumes are rendered before vol2birdSetUp checks the grid
+    if (checkMistnetGrid(alldata) < 0){
+        return NULL;
+    }
+
+#ifdef VOL2BIRD_R
+    if (!check_mistnet_loaded_c()) {
+        return NULL;
+    }
+#endif
+
+    if (nVolumes > MISTNET_BATCH_SIZE){
+        nVolumes = MISTNET_BATCH_SIZE;
+    }
+
+    vol2birdScanUse_t* scanUse[MISTNET_BATCH_SIZE];
+
+    for (int iVolume = 0; iVolume < nVolumes; iVolume++) {
+        setRadarWavelength(volumes[iVolume], alldata);
+        scanUse[iVolume] = determineScanUse(volumes[iVolume], alldata);
+    }
+
+    vol2birdMistnetBatch_t* batch = mistnetBatchNew(volumes, scanUse, nVolumes, alldata);
+
+    for (int iVolume = 0; iVolume < nVolumes; iVolume++) {
+        if (scanUse[iVolume] != NULL) free(scanUse[iVolume]);
+    }
+
+    return batch;
+}
+
+// segments the volumes using MistNet ahead of vol2birdSetUp, running the model
+// on MISTNET_BATCH_SIZE volumes in one forward pass. Returns the number of
+// volumes segmented, -1 on error.
+int vol2birdSegmentVolumesUsingMistnet(PolarVolume_t* volumes[], int nVolumes, vol2bird_t* alldata) {
+    int nSegmented = 0;
+
+    if (!alldata->options.useMistNet || nVolumes < 1){
+        return 0;
+    }
+
+#ifdef VOL2BIRD_R
+    if (!check_mistnet_loaded_c()) {
+        return 0;
+    }
+#endif
+
+    for (int iVolume = 0; iVolume < nVolumes; iVolume += MISTNET_BATCH_SIZE) {
+        vol2birdMistnetBatch_t* batch = vol2birdMistnetBatchNew(volumes + iVolume, nVolumes - iVolume, alldata);
+        if (batch == NULL) {
+            return -1;
+        }
+        vol2birdMistnetBatchRun(batch);
+        int result = vol2birdMistnetBatchApply(batch);
+        vol2birdMistnetBatchFree(batch);
+        if (result < 0) {
+            return -1;
+        }
+        nSegmented += result;
+    }
+
+    return nSegmented;
+}
+#endif
+
+
 void vol2birdTearDown(vol2bird_t* alldata) {
     
     // ---------------------------------------------------------- //
@@ -5534,6 +6039,8 @@ void vol2birdTearDown(vol2bird_t* alldata) {
     // reset this variable to its initial value
     alldata->misc.initializationSuccessful = FALSE;
     alldata->misc.loadConfigSuccessful = FALSE;
+    alldata->misc.scansSegmented = FALSE;
+    alldata->misc.polarizationSelected = FALSE;
 
 } // vol2birdTearDown
 